@@ -926,7 +926,18 @@ xhci_poll_intr_queue(void *const q)
 
 	/* TODO: Reset interrupt queue if it gets halted? */
 
-	xhci_handle_events(xhci);
+	/*
+	 * Fast path: nothing completed for this queue and nothing new on
+	 * the event ring, so there is no need to touch any more memory.
+	 * Otherwise, dispatch all pending events at once: this updates
+	 * the `ready` pointers of every interrupt queue on this controller,
+	 * so polling the other devices doesn't have to walk the ring again.
+	 */
+	if (!intrq->ready) {
+		if (!xhci_events_pending(xhci))
+			return NULL;
+		xhci_handle_events(xhci);
+	}
 
 	u8 *reqdata = NULL;
 	while (!reqdata && intrq->ready) {
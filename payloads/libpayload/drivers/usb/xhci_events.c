@@ -194,6 +194,10 @@ xhci_handle_event(xhci_t *const xhci)
 	}
 }
 
+/*
+ * Drain the whole event ring in one go and only touch the dequeue
+ * pointer register once for the batch.
+ */
 void
 xhci_handle_events(xhci_t *const xhci)
 {
@@ -202,6 +206,13 @@ xhci_handle_events(xhci_t *const xhci)
 	xhci_update_event_dq(xhci);
 }
 
+/* Cheap check, if there is anything on the event ring at all */
+int
+xhci_events_pending(const xhci_t *const xhci)
+{
+	return xhci_event_ready(&xhci->er);
+}
+
 static unsigned long
 xhci_wait_for_event(const event_ring_t *const er,
 		    unsigned long *const timeout_us)
@@ -497,6 +497,7 @@ void xhci_reset_event_ring(event_ring_t *);
 void xhci_advance_event_ring(xhci_t *);
 void xhci_update_event_dq(xhci_t *);
 void xhci_handle_events(xhci_t *);
+int xhci_events_pending(const xhci_t *);
 int xhci_wait_for_command_aborted(xhci_t *, const trb_t *);
 int xhci_wait_for_command_done(xhci_t *, const trb_t *, int clear_event);
 int xhci_wait_for_transfer(xhci_t *, const int slot_id, const int ep_id);
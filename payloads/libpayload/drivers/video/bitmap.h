@@ -41,6 +41,11 @@ struct bitmap_file_header {
 
 /* Bitmap version 3 */
 
+/* Compression types */
+#define BI_RGB		0
+#define BI_RLE8		1
+#define BI_BITFIELDS	3
+
 struct bitmap_header_v3 {
 	uint32_t header_size;
 	int32_t width;
@@ -55,6 +60,13 @@ struct bitmap_header_v3 {
 	uint32_t colors_important;
 } __packed;
 
+/* Color masks following the header with BI_BITFIELDS */
+struct bitmap_masks_v3 {
+	uint32_t red;
+	uint32_t green;
+	uint32_t blue;
+} __packed;
+
 struct bitmap_palette_element_v3 {
 	uint8_t blue;
 	uint8_t green;
@@ -29,6 +29,7 @@
 
 #include <libpayload.h>
 #include <cbfs.h>
+#include <lz4.h>
 #include <sysinfo.h>
 #include "bitmap.h"
 
@@ -48,11 +49,34 @@ static struct rect screen;
 static struct cb_framebuffer *fbinfo;
 static uint8_t *fbaddr;
 
+/*
+ * Optional back buffer. While it's enabled, fbaddr points to it and all drawing
+ * goes there. The area touched since the last flush is tracked in 'dirty' and
+ * only that part is copied to the real framebuffer (fbaddr_hw).
+ */
+static uint8_t *fbaddr_hw;
+static uint8_t *gfx_buffer;
+static struct rect dirty;
+
+/* Scratch space for bitmap rendering, grown on demand */
+static uint8_t *row_buf;
+static size_t row_buf_size;
+
+struct scale_entry {
+	int32_t s0;	/* index of the left (upper) source pixel */
+	int32_t s1;	/* index of the right (lower) source pixel */
+	int32_t n;	/* numerator of the interpolation weight */
+};
+static struct scale_entry *x_table;
+static size_t x_table_size;
+
 #define LOG(x...)	printf("CBGFX: " x)
 #define PIVOT_H_MASK	(PIVOT_H_LEFT|PIVOT_H_CENTER|PIVOT_H_RIGHT)
 #define PIVOT_V_MASK	(PIVOT_V_TOP|PIVOT_V_CENTER|PIVOT_V_BOTTOM)
 #define ROUNDUP(x, y)	((((x) + ((y) - 1)) / (y)) * (y))
 #define ABS(x)		((x) < 0 ? -(x) : (x))
+#define LZ4F_MAGICNUMBER	0x184D2204
+#define LZ4F_HAS_CONTENT_SIZE	(1 << 3)
 
 static char initialized = 0;
 
@@ -122,17 +146,150 @@ static inline uint32_t calculate_color(const struct rgb_color *rgb,
 }
 
 /*
- * Plot a pixel in a framebuffer. This is called from tight loops. Keep it slim
- * and do the validation at callers' site.
+ * Store a pixel of 'bytes' bytes per pixel. 'bytes' is invariant in all loops
+ * calling this, so the compiler can hoist the switch out of them.
  */
-static inline void set_pixel(struct vector *coord, uint32_t color)
+static inline void store_pixel(uint8_t *pixel, uint32_t color, int bytes)
 {
-	const int bpp = fbinfo->bits_per_pixel;
-	const int bpl = fbinfo->bytes_per_line;
 	int i;
-	uint8_t * const pixel = fbaddr + coord->y * bpl + coord->x * bpp / 8;
-	for (i = 0; i < bpp / 8; i++)
-		pixel[i] = (color >> (i * 8));
+
+	switch (bytes) {
+	case 4:
+		*(uint32_t *)pixel = htole32(color);
+		break;
+	case 2:
+		*(uint16_t *)pixel = htole16(color);
+		break;
+	default:
+		for (i = 0; i < bytes; i++)
+			pixel[i] = (color >> (i * 8));
+		break;
+	}
+}
+
+/* Fill 'count' pixels of a row starting at 'coord' with 'color' */
+static void fill_row(const struct vector *coord, int32_t count, uint32_t color)
+{
+	const int bytes = fbinfo->bits_per_pixel / 8;
+	uint8_t *pixel = fbaddr + coord->y * fbinfo->bytes_per_line
+			+ coord->x * bytes;
+	uint32_t *word;
+	uint32_t pattern[3];
+	int32_t i, len;
+	int w, b;
+
+	switch (bytes) {
+	case 4:
+		word = (uint32_t *)pixel;
+		color = htole32(color);
+		while (count--)
+			*word++ = color;
+		return;
+	case 2:
+		if (count && ((uintptr_t)pixel & 2)) {
+			store_pixel(pixel, color, 2);
+			pixel += 2;
+			count--;
+		}
+		word = (uint32_t *)pixel;
+		pattern[0] = htole32((color & 0xffff) | (color << 16));
+		for (; count >= 2; count -= 2)
+			*word++ = pattern[0];
+		if (count)
+			store_pixel((uint8_t *)word, color, 2);
+		return;
+	case 3:
+		/* Byte-wise up to a word boundary, then 4 pixels at a time as
+		   3 words. The pattern repeats every 12 bytes, so it only
+		   depends on the byte phase within a pixel at that point. */
+		len = count * 3;
+		for (i = 0; i < len && ((uintptr_t)(pixel + i) & 3); i++)
+			pixel[i] = color >> ((i % 3) * 8);
+		for (w = 0; w < 3; w++) {
+			pattern[w] = 0;
+			for (b = 0; b < 4; b++)
+				pattern[w] |= ((color >> (((i + w * 4 + b) % 3)
+						* 8)) & 0xff) << (b * 8);
+			pattern[w] = htole32(pattern[w]);
+		}
+		word = (uint32_t *)(pixel + i);
+		for (; i + 12 <= len; i += 12) {
+			*word++ = pattern[0];
+			*word++ = pattern[1];
+			*word++ = pattern[2];
+		}
+		for (; i < len; i++)
+			pixel[i] = color >> ((i % 3) * 8);
+		return;
+	default:
+		for (; count > 0; count--, pixel += bytes)
+			store_pixel(pixel, color, bytes);
+		return;
+	}
+}
+
+/* Copy 'count' pre-formatted pixels to the row starting at 'coord' */
+static void copy_row(const struct vector *coord, const uint8_t *src,
+		     int32_t count)
+{
+	const int bytes = fbinfo->bits_per_pixel / 8;
+	uint8_t *pixel = fbaddr + coord->y * fbinfo->bytes_per_line
+			+ coord->x * bytes;
+
+	memcpy(pixel, src, count * bytes);
+}
+
+/* Add the area to the region to be copied to the framebuffer on flush */
+static void mark_dirty(const struct vector *top_left, const struct vector *size)
+{
+	int32_t x1, y1;
+
+	if (!gfx_buffer || size->width <= 0 || size->height <= 0)
+		return;
+
+	if (dirty.size.width == 0 || dirty.size.height == 0) {
+		dirty.offset = *top_left;
+		dirty.size = *size;
+		return;
+	}
+
+	x1 = MAX(dirty.offset.x + dirty.size.width, top_left->x + size->width);
+	y1 = MAX(dirty.offset.y + dirty.size.height,
+		 top_left->y + size->height);
+	dirty.offset.x = MIN(dirty.offset.x, top_left->x);
+	dirty.offset.y = MIN(dirty.offset.y, top_left->y);
+	dirty.size.width = x1 - dirty.offset.x;
+	dirty.size.height = y1 - dirty.offset.y;
+}
+
+/* Make sure row_buf can hold 'size' bytes */
+static int reserve_row_buf(size_t size)
+{
+	uint8_t *buf;
+
+	if (size <= row_buf_size)
+		return CBGFX_SUCCESS;
+	buf = realloc(row_buf, size);
+	if (!buf)
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+	row_buf = buf;
+	row_buf_size = size;
+	return CBGFX_SUCCESS;
+}
+
+/* Make sure x_table can hold 'count' entries */
+static int reserve_x_table(size_t count)
+{
+	struct scale_entry *table;
+
+	if (count <= x_table_size)
+		return CBGFX_SUCCESS;
+	table = realloc(x_table, count * sizeof(*table));
+	if (!table)
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+	x_table = table;
+	x_table_size = count;
+	return CBGFX_SUCCESS;
 }
 
 /*
@@ -151,6 +308,7 @@ static int cbgfx_init(void)
 	fbaddr = phys_to_virt((uint8_t *)(uintptr_t)(fbinfo->physical_address));
 	if (!fbaddr)
 		return CBGFX_ERROR_FRAMEBUFFER_ADDR;
+	fbaddr_hw = fbaddr;
 
 	screen.size.width = fbinfo->x_resolution;
 	screen.size.height = fbinfo->y_resolution;
@@ -204,9 +362,10 @@ int draw_box(const struct rect *box, const struct rgb_color *rgb)
 		return CBGFX_ERROR_BOUNDARY;
 	}
 
+	p.x = top_left.x;
 	for (p.y = top_left.y; p.y < t.y; p.y++)
-		for (p.x = top_left.x; p.x < t.x; p.x++)
-			set_pixel(&p, color);
+		fill_row(&p, size.width, color);
+	mark_dirty(&top_left, &size);
 
 	return CBGFX_SUCCESS;
 }
@@ -243,10 +402,11 @@ int clear_screen(const struct rgb_color *rgb)
 	    (((color >> 16) & 0xff) == (color & 0xff)))) {
 		memset(fbaddr, color & 0xff, screen.size.height * bpl);
 	} else {
+		p.x = 0;
 		for (p.y = 0; p.y < screen.size.height; p.y++)
-			for (p.x = 0; p.x < screen.size.width; p.x++)
-				set_pixel(&p, color);
+			fill_row(&p, screen.size.width, color);
 	}
+	mark_dirty(&screen.offset, &screen.size);
 
 	return CBGFX_SUCCESS;
 }
@@ -276,18 +436,17 @@ static int draw_bitmap_v3(const struct vector *top_left,
 			  uint8_t invert)
 {
 	const int bpp = header->bits_per_pixel;
+	const int bytes = fbinfo->bits_per_pixel / 8;
+	const int src_bytes = bpp / 8;
 	int32_t dir;
 	struct vector p;
+	int rv;
 
-	if (header->compression) {
-		LOG("Compressed bitmaps are not supported\n");
+	if (header->compression != BI_RGB) {
+		LOG("Unsupported compression: %d\n", header->compression);
 		return CBGFX_ERROR_BITMAP_FORMAT;
 	}
-	if (bpp >= 16) {
-		LOG("Non-palette bitmaps are not supported\n");
-		return CBGFX_ERROR_BITMAP_FORMAT;
-	}
-	if (bpp != 8) {
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
 		LOG("Unsupported bits per pixel: %d\n", bpp);
 		return CBGFX_ERROR_BITMAP_FORMAT;
 	}
@@ -296,6 +455,13 @@ static int draw_bitmap_v3(const struct vector *top_left,
 		return CBGFX_ERROR_SCALE_OUT_OF_RANGE;
 	}
 
+	rv = reserve_row_buf(dim->width * bytes);
+	if (rv)
+		return rv;
+	rv = reserve_x_table(dim->width);
+	if (rv)
+		return rv;
+
 	const int32_t y_stride = ROUNDUP(dim_org->width * bpp / 8, 4);
 	/*
 	 * header->height can be positive or negative.
@@ -323,9 +489,22 @@ static int draw_bitmap_v3(const struct vector *top_left,
 	 * have been set. Since the pixel array size is already validated in
 	 * parse_bitmap_header_v3, s0 is guranteed not to exceed pixel array
 	 * boundary.
+	 *
+	 * The horizontal source indices and weights are the same for every
+	 * row, so they're computed once up front. Each row is assembled in
+	 * row_buf in framebuffer format and then copied out in one go.
 	 */
 	struct vector s0, s1, d;
 	struct fraction tx, ty;
+	tx.d = scale->x.n;
+	for (d.x = 0; d.x < dim->width; d.x++) {
+		struct scale_entry *e = &x_table[d.x];
+		e->s0 = d.x * scale->x.d / scale->x.n;
+		e->s1 = e->s0;
+		if (e->s1 + 1 < dim_org->width)
+			e->s1++;
+		e->n = (d.x * scale->x.d) % scale->x.n;
+	}
 	for (d.y = 0; d.y < dim->height; d.y++, p.y += dir) {
 		s0.y = d.y * scale->y.d / scale->y.n;
 		s1.y = s0.y;
@@ -335,43 +514,274 @@ static int draw_bitmap_v3(const struct vector *top_left,
 		ty.n = (d.y * scale->y.d) % scale->y.n;
 		const uint8_t *data0 = pixel_array + s0.y * y_stride;
 		const uint8_t *data1 = pixel_array + s1.y * y_stride;
-		p.x = top_left->x;
-		for (d.x = 0; d.x < dim->width; d.x++, p.x++) {
-			s0.x = d.x * scale->x.d / scale->x.n;
-			s1.x = s0.x;
-			if (s1.x + 1 < dim_org->width)
-				s1.x++;
-			tx.d = scale->x.n;
-			tx.n = (d.x * scale->x.d) % scale->x.n;
-			uint8_t c00 = data0[s0.x];
-			uint8_t c10 = data0[s1.x];
-			uint8_t c01 = data1[s0.x];
-			uint8_t c11 = data1[s1.x];
-			if (c00 >= header->colors_used
-					|| c10 >= header->colors_used
-					|| c01 >= header->colors_used
-					|| c11 >= header->colors_used) {
-				LOG("Color index exceeds palette boundary\n");
-				return CBGFX_ERROR_BITMAP_DATA;
+		uint8_t *out = row_buf;
+		for (d.x = 0; d.x < dim->width; d.x++, out += bytes) {
+			const struct scale_entry *e = &x_table[d.x];
+			s0.x = e->s0;
+			s1.x = e->s1;
+			tx.n = e->n;
+			/*
+			 * True color pixels are stored as blue, green, red
+			 * (and one unused byte for 32 bpp), which is the same
+			 * layout as a palette entry.
+			 */
+			const struct bitmap_palette_element_v3 *c00, *c10,
+							       *c01, *c11;
+			if (bpp == 8) {
+				uint8_t i00 = data0[s0.x];
+				uint8_t i10 = data0[s1.x];
+				uint8_t i01 = data1[s0.x];
+				uint8_t i11 = data1[s1.x];
+				if (i00 >= header->colors_used
+						|| i10 >= header->colors_used
+						|| i01 >= header->colors_used
+						|| i11 >= header->colors_used) {
+					LOG("Color index exceeds palette boundary\n");
+					return CBGFX_ERROR_BITMAP_DATA;
+				}
+				c00 = &pal[i00];
+				c10 = &pal[i10];
+				c01 = &pal[i01];
+				c11 = &pal[i11];
+			} else {
+				c00 = (const void *)(data0 + s0.x * src_bytes);
+				c10 = (const void *)(data0 + s1.x * src_bytes);
+				c01 = (const void *)(data1 + s0.x * src_bytes);
+				c11 = (const void *)(data1 + s1.x * src_bytes);
+			}
+			/* No interpolation needed on exact source pixels */
+			if (tx.n == 0 && ty.n == 0) {
+				const struct rgb_color rgb = {
+					.red = c00->red,
+					.green = c00->green,
+					.blue = c00->blue,
+				};
+				store_pixel(out, calculate_color(&rgb, invert),
+					    bytes);
+				continue;
 			}
 			const struct rgb_color rgb = {
-				.red = bli(pal[c00].red, pal[c10].red,
-					   pal[c01].red, pal[c11].red,
+				.red = bli(c00->red, c10->red,
+					   c01->red, c11->red,
 					   &tx, &ty),
-				.green = bli(pal[c00].green, pal[c10].green,
-					     pal[c01].green, pal[c11].green,
+				.green = bli(c00->green, c10->green,
+					     c01->green, c11->green,
 					     &tx, &ty),
-				.blue = bli(pal[c00].blue, pal[c10].blue,
-					    pal[c01].blue, pal[c11].blue,
+				.blue = bli(c00->blue, c10->blue,
+					    c01->blue, c11->blue,
 					    &tx, &ty),
 			};
-			set_pixel(&p, calculate_color(&rgb, invert));
+			store_pixel(out, calculate_color(&rgb, invert), bytes);
 		}
+		p.x = top_left->x;
+		copy_row(&p, row_buf, dim->width);
 	}
+	mark_dirty(top_left, dim);
 
 	return CBGFX_SUCCESS;
 }
 
+/*
+ * Expand an RLE8 compressed pixel array into an uncompressed 8 bpp one. Pixels
+ * skipped by the encoding (delta or early end of line) are left at index 0.
+ */
+static int decode_rle8(const uint8_t *src, size_t src_size,
+		       const struct vector *dim_org, int32_t stride,
+		       uint8_t *dst)
+{
+	int32_t x = 0, y = 0;
+	size_t i = 0;
+
+	while (i + 2 <= src_size) {
+		const uint8_t count = src[i++];
+		const uint8_t value = src[i++];
+
+		if (count) {
+			/* Encoded run */
+			if (y >= dim_org->height || x + count > dim_org->width)
+				break;
+			memset(dst + y * stride + x, value, count);
+			x += count;
+			continue;
+		}
+
+		switch (value) {
+		case 0:		/* end of line */
+			x = 0;
+			y++;
+			break;
+		case 1:		/* end of bitmap */
+			return CBGFX_SUCCESS;
+		case 2:		/* delta */
+			if (i + 2 > src_size)
+				goto error;
+			x += src[i++];
+			y += src[i++];
+			break;
+		default:	/* absolute run, padded to 16 bits */
+			if (i + value > src_size || y >= dim_org->height ||
+					x + value > dim_org->width)
+				goto error;
+			memcpy(dst + y * stride + x, src + i, value);
+			x += value;
+			i += ALIGN_UP(value, 2);
+			break;
+		}
+	}
+
+error:
+	LOG("Invalid RLE8 bitmap data\n");
+	return CBGFX_ERROR_BITMAP_DATA;
+}
+
+static int draw_bitmap_rle8(const struct vector *top_left,
+			    const struct scale *scale,
+			    const struct vector *dim,
+			    const struct vector *dim_org,
+			    const struct bitmap_header_v3 *header,
+			    const struct bitmap_palette_element_v3 *pal,
+			    const uint8_t *pixel_array,
+			    uint8_t invert)
+{
+	struct bitmap_header_v3 h = *header;
+	const int32_t y_stride = ROUNDUP(dim_org->width, 4);
+	uint8_t *pixels;
+	int rv;
+
+	if (header->bits_per_pixel != 8) {
+		LOG("Unsupported bits per pixel for RLE8: %d\n",
+		    header->bits_per_pixel);
+		return CBGFX_ERROR_BITMAP_FORMAT;
+	}
+
+	pixels = calloc(dim_org->height, y_stride);
+	if (!pixels)
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+
+	rv = decode_rle8(pixel_array, header->size, dim_org, y_stride, pixels);
+	if (!rv) {
+		h.compression = BI_RGB;
+		h.size = dim_org->height * y_stride;
+		rv = draw_bitmap_v3(top_left, scale, dim, dim_org,
+				    &h, pal, pixels, invert);
+	}
+
+	free(pixels);
+	return rv;
+}
+
+static int render_bitmap(const struct vector *top_left,
+			 const struct scale *scale,
+			 const struct vector *dim,
+			 const struct vector *dim_org,
+			 const struct bitmap_header_v3 *header,
+			 const struct bitmap_palette_element_v3 *pal,
+			 const uint8_t *pixel_array,
+			 uint8_t invert)
+{
+	if (header->compression == BI_RLE8)
+		return draw_bitmap_rle8(top_left, scale, dim, dim_org,
+					header, pal, pixel_array, invert);
+	return draw_bitmap_v3(top_left, scale, dim, dim_org,
+			      header, pal, pixel_array, invert);
+}
+
+static int is_lz4_bitmap(const void *bitmap, size_t size)
+{
+	return size >= sizeof(uint32_t) && le32dec(bitmap) == LZ4F_MAGICNUMBER;
+}
+
+#if IS_ENABLED(CONFIG_LP_LZ4)
+/* Read the content size an LZ4 wrapped bitmap frame has to record */
+static int get_lz4_content_size(const uint8_t *in, size_t size,
+				uint64_t *content_size)
+{
+	/* magic, flags, block descriptor, content size */
+	if (size < 6 + sizeof(uint64_t) || !(in[4] & LZ4F_HAS_CONTENT_SIZE)) {
+		LOG("LZ4 bitmap must record its content size\n");
+		return CBGFX_ERROR_BITMAP_FORMAT;
+	}
+	*content_size = le32dec(in + 6) | (uint64_t)le32dec(in + 10) << 32;
+	if (*content_size == 0 || *content_size > 1 * GiB) {
+		LOG("Invalid LZ4 bitmap content size\n");
+		return CBGFX_ERROR_BITMAP_DATA;
+	}
+	return CBGFX_SUCCESS;
+}
+#endif
+
+/*
+ * If the bitmap is wrapped in an LZ4 frame, decompress it into a new buffer and
+ * point 'bitmap' and 'size' there. The frame has to record the content size.
+ * The caller has to free '*buffer' when done with the bitmap.
+ */
+static int unwrap_bitmap(const void **bitmap, size_t *size, void **buffer)
+{
+	const uint8_t *in = *bitmap;
+
+	*buffer = NULL;
+	if (!is_lz4_bitmap(in, *size))
+		return CBGFX_SUCCESS;
+
+#if IS_ENABLED(CONFIG_LP_LZ4)
+	uint64_t content_size;
+	int rv = get_lz4_content_size(in, *size, &content_size);
+	if (rv)
+		return rv;
+
+	*buffer = malloc(content_size);
+	if (!*buffer)
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+
+	if (ulz4fn(in, *size, *buffer, content_size) != content_size) {
+		LOG("Failed to decompress LZ4 bitmap\n");
+		free(*buffer);
+		*buffer = NULL;
+		return CBGFX_ERROR_BITMAP_DATA;
+	}
+
+	*bitmap = *buffer;
+	*size = content_size;
+	return CBGFX_SUCCESS;
+#else
+	LOG("LZ4 compressed bitmaps are not supported\n");
+	return CBGFX_ERROR_BITMAP_FORMAT;
+#endif
+}
+
+/*
+ * Like unwrap_bitmap(), but only decompress the start of the bitmap into 'head',
+ * which is enough to parse the headers. 'size' becomes the size of the whole
+ * decompressed bitmap.
+ */
+static int unwrap_bitmap_head(const void **bitmap, size_t *size,
+			      uint8_t *head, size_t head_size)
+{
+	const uint8_t *in = *bitmap;
+
+	if (!is_lz4_bitmap(in, *size))
+		return CBGFX_SUCCESS;
+
+#if IS_ENABLED(CONFIG_LP_LZ4)
+	uint64_t content_size;
+	int rv = get_lz4_content_size(in, *size, &content_size);
+	if (rv)
+		return rv;
+	head_size = MIN(head_size, content_size);
+	if (ulz4fn_head(in, *size, head, head_size) != head_size) {
+		LOG("Failed to decompress LZ4 bitmap header\n");
+		return CBGFX_ERROR_BITMAP_DATA;
+	}
+
+	*bitmap = head;
+	*size = content_size;
+	return CBGFX_SUCCESS;
+#else
+	LOG("LZ4 compressed bitmaps are not supported\n");
+	return CBGFX_ERROR_BITMAP_FORMAT;
+#endif
+}
+
 static int get_bitmap_file_header(const void *bitmap, size_t size,
 				  struct bitmap_file_header *file_header)
 {
@@ -418,6 +828,10 @@ static int parse_bitmap_header_v3(
 	size_t palette_offset = header_offset + header_size;
 	size_t file_size = file_header.file_size;
 
+	if (header_offset + header_size > file_size) {
+		LOG("Invalid bitmap data\n");
+		return CBGFX_ERROR_BITMAP_DATA;
+	}
 	h = (struct bitmap_header_v3 *)(bitmap + header_offset);
 	header->header_size = le32toh(h->header_size);
 	if (header->header_size != header_size) {
@@ -445,6 +859,25 @@ static int parse_bitmap_header_v3(
 		LOG("Bitmap pixel data exceeds buffer boundary\n");
 		return CBGFX_ERROR_BITMAP_DATA;
 	}
+	if (header->compression == BI_BITFIELDS) {
+		const struct bitmap_masks_v3 *masks;
+
+		if (palette_offset + sizeof(*masks) > pixel_offset) {
+			LOG("Bitmap color masks exceed palette boundary\n");
+			return CBGFX_ERROR_BITMAP_DATA;
+		}
+		masks = (struct bitmap_masks_v3 *)(bitmap + palette_offset);
+		/* With the standard masks, the pixels are laid out as BI_RGB */
+		if (header->bits_per_pixel != 32 ||
+		    le32toh(masks->red) != 0xff0000 ||
+		    le32toh(masks->green) != 0xff00 ||
+		    le32toh(masks->blue) != 0xff) {
+			LOG("Unsupported bitmap color masks\n");
+			return CBGFX_ERROR_BITMAP_FORMAT;
+		}
+		header->compression = BI_RGB;
+		palette_offset += sizeof(*masks);
+	}
 	if (palette_offset + palette_size > pixel_offset) {
 		LOG("Bitmap palette data exceeds palette boundary\n");
 		return CBGFX_ERROR_BITMAP_DATA;
@@ -453,7 +886,7 @@ static int parse_bitmap_header_v3(
 			palette_offset);
 
 	size_t pixel_size = header->size;
-	if (pixel_size != dim_org->height *
+	if (header->compression == BI_RGB && pixel_size != dim_org->height *
 		ROUNDUP(dim_org->width * header->bits_per_pixel / 8, 4)) {
 		LOG("Bitmap pixel array size does not match expected size\n");
 		return CBGFX_ERROR_BITMAP_DATA;
@@ -555,9 +988,9 @@ static int check_boundary(const struct vector *top_left,
 	return CBGFX_SUCCESS;
 }
 
-int draw_bitmap(const void *bitmap, size_t size,
-		const struct scale *pos_rel, const struct scale *dim_rel,
-		uint32_t flags)
+static int draw_bitmap_unwrapped(const void *bitmap, size_t size,
+				 const struct scale *pos_rel,
+				 const struct scale *dim_rel, uint32_t flags)
 {
 	struct bitmap_header_v3 header;
 	const struct bitmap_palette_element_v3 *palette;
@@ -599,12 +1032,31 @@ int draw_bitmap(const void *bitmap, size_t size,
 		return rv;
 	}
 
-	return draw_bitmap_v3(&top_left, &scale, &dim, &dim_org,
-			      &header, palette, pixel_array, invert);
+	return render_bitmap(&top_left, &scale, &dim, &dim_org,
+			     &header, palette, pixel_array, invert);
 }
 
-int draw_bitmap_direct(const void *bitmap, size_t size,
-		       const struct vector *top_left)
+int draw_bitmap(const void *bitmap, size_t size,
+		const struct scale *pos_rel, const struct scale *dim_rel,
+		uint32_t flags)
+{
+	void *buffer;
+	int rv;
+
+	if (cbgfx_init())
+		return CBGFX_ERROR_INIT;
+
+	rv = unwrap_bitmap(&bitmap, &size, &buffer);
+	if (rv)
+		return rv;
+
+	rv = draw_bitmap_unwrapped(bitmap, size, pos_rel, dim_rel, flags);
+	free(buffer);
+	return rv;
+}
+
+static int draw_bitmap_direct_unwrapped(const void *bitmap, size_t size,
+					const struct vector *top_left)
 {
 	struct bitmap_header_v3 header;
 	const struct bitmap_palette_element_v3 *palette;
@@ -634,8 +1086,26 @@ int draw_bitmap_direct(const void *bitmap, size_t size,
 		return rv;
 	}
 
-	return draw_bitmap_v3(top_left, &scale, &dim, &dim,
-			      &header, palette, pixel_array, 0);
+	return render_bitmap(top_left, &scale, &dim, &dim,
+			     &header, palette, pixel_array, 0);
+}
+
+int draw_bitmap_direct(const void *bitmap, size_t size,
+		       const struct vector *top_left)
+{
+	void *buffer;
+	int rv;
+
+	if (cbgfx_init())
+		return CBGFX_ERROR_INIT;
+
+	rv = unwrap_bitmap(&bitmap, &size, &buffer);
+	if (rv)
+		return rv;
+
+	rv = draw_bitmap_direct_unwrapped(bitmap, size, top_left);
+	free(buffer);
+	return rv;
 }
 
 int get_bitmap_dimension(const void *bitmap, size_t sz, struct scale *dim_rel)
@@ -644,11 +1114,18 @@ int get_bitmap_dimension(const void *bitmap, size_t sz, struct scale *dim_rel)
 	const struct bitmap_palette_element_v3 *palette;
 	const uint8_t *pixel_array;
 	struct vector dim, dim_org;
+	uint8_t head[sizeof(struct bitmap_file_header) +
+		     sizeof(struct bitmap_header_v3) +
+		     sizeof(struct bitmap_masks_v3)];
 	int rv;
 
 	if (cbgfx_init())
 		return CBGFX_ERROR_INIT;
 
+	rv = unwrap_bitmap_head(&bitmap, &sz, head, sizeof(head));
+	if (rv)
+		return rv;
+
 	/* Only v3 is supported now */
 	rv = parse_bitmap_header_v3(bitmap, sz,
 				    &header, &palette, &pixel_array, &dim_org);
@@ -668,3 +1145,60 @@ int get_bitmap_dimension(const void *bitmap, size_t sz, struct scale *dim_rel)
 
 	return CBGFX_SUCCESS;
 }
+
+int enable_graphics_buffer(void)
+{
+	if (gfx_buffer)
+		return CBGFX_SUCCESS;
+
+	if (cbgfx_init())
+		return CBGFX_ERROR_INIT;
+
+	size_t buffer_size = fbinfo->y_resolution * fbinfo->bytes_per_line;
+	gfx_buffer = malloc(buffer_size);
+	if (!gfx_buffer) {
+		LOG("%s: Failed to create graphics buffer (%zu bytes).\n",
+		    __func__, buffer_size);
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+	}
+
+	/* Start with what's on screen, so partial flushes stay consistent */
+	memcpy(gfx_buffer, fbaddr_hw, buffer_size);
+	fbaddr = gfx_buffer;
+	dirty.size = vzero;
+
+	return CBGFX_SUCCESS;
+}
+
+int flush_graphics_buffer(void)
+{
+	const int bytes = fbinfo ? fbinfo->bits_per_pixel / 8 : 0;
+	int32_t y;
+
+	if (!gfx_buffer)
+		return CBGFX_ERROR_GRAPHICS_BUFFER;
+
+	if (dirty.size.width > 0 && dirty.size.height > 0) {
+		const size_t offset = dirty.offset.x * bytes;
+		const size_t len = dirty.size.width * bytes;
+		for (y = dirty.offset.y;
+		     y < dirty.offset.y + dirty.size.height; y++) {
+			const size_t line = y * fbinfo->bytes_per_line + offset;
+			memcpy(fbaddr_hw + line, gfx_buffer + line, len);
+		}
+	}
+	dirty.size = vzero;
+
+	return CBGFX_SUCCESS;
+}
+
+void disable_graphics_buffer(void)
+{
+	if (!gfx_buffer)
+		return;
+
+	flush_graphics_buffer();
+	free(gfx_buffer);
+	gfx_buffer = NULL;
+	fbaddr = fbaddr_hw;
+}
@@ -57,6 +57,8 @@
 #define CBGFX_ERROR_FRAMEBUFFER_ADDR	0x15
 /* portrait screen not supported */
 #define CBGFX_ERROR_PORTRAIT_SCREEN	0x16
+/* cannot use or allocate buffer */
+#define CBGFX_ERROR_GRAPHICS_BUFFER	0x17
 
 struct fraction {
 	int32_t n;
@@ -124,6 +126,13 @@ int clear_canvas(const struct rgb_color *rgb);
  */
 int clear_screen(const struct rgb_color *rgb);
 
+/*
+ * Bitmaps passed to the functions below can be 8 bpp palettized (uncompressed
+ * or RLE8) or 24/32 bpp true color. 32 bpp ones may also use BI_BITFIELDS with
+ * the standard masks. The whole file may also be wrapped in an LZ4 frame which
+ * records the content size (requires CONFIG_LP_LZ4).
+ */
+
 /**
  * Draw a bitmap image using position and size relative to the canvas
  *
@@ -192,3 +201,26 @@ int draw_bitmap_direct(const void *bitmap, size_t size,
  * in the original size are returned.
  */
 int get_bitmap_dimension(const void *bitmap, size_t sz, struct scale *dim_rel);
+
+/**
+ * Setup a buffer for the drawing functions to render into
+ *
+ * All subsequent drawing goes to the buffer instead of the framebuffer, and
+ * nothing shows up on screen until flush_graphics_buffer() is called. Only
+ * the area drawn since the last flush is copied out.
+ *
+ * @return CBGFX_* error codes
+ */
+int enable_graphics_buffer(void);
+
+/**
+ * Copy the area drawn since the last flush from the buffer to the framebuffer
+ *
+ * @return CBGFX_* error codes
+ */
+int flush_graphics_buffer(void);
+
+/**
+ * Flush and release the buffer, and draw to the framebuffer directly again
+ */
+void disable_graphics_buffer(void);
@@ -44,6 +44,12 @@
  */
 size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn);
 
+/* Decompresses only the first dstn bytes of an LZ4F image from src to dst, e.g.
+ * to read a file header without room for the whole content. Returns the amount
+ * of decompressed bytes, which is less than dstn only if the content is shorter,
+ * or 0 on error. Like ulz4fn(), it doesn't read more than srcn bytes. */
+size_t ulz4fn_head(const void *src, size_t srcn, void *dst, size_t dstn);
+
 /* Same as ulz4fn() but does not perform any bounds checks. */
 size_t ulz4f(const void *src, void *dst);
 
@@ -112,33 +112,43 @@ struct lz4_block_header {
 	/* + uint32_t block_checksum iff has_block_checksum is set */
 } __packed;
 
-size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
+/* Checks the frame header and returns the first block, or NULL on error. */
+static const void *lz4_frame_blocks(const void *src, size_t srcn,
+				    int *has_block_checksum)
 {
+	const struct lz4_frame_header *h = src;
 	const void *in = src;
+
+	if (srcn < sizeof(*h) + sizeof(uint64_t) + sizeof(uint8_t))
+		return NULL;	/* input overrun */
+
+	/* We assume there's always only a single, standard frame. */
+	if (le32toh(h->magic) != LZ4F_MAGICNUMBER || h->version != 1)
+		return NULL;	/* unknown format */
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return NULL;	/* reserved must be zero */
+	if (!h->independent_blocks)
+		return NULL;	/* we don't support block dependency */
+	*has_block_checksum = h->has_block_checksum;
+
+	in += sizeof(*h);
+	if (h->has_content_size)
+		in += sizeof(uint64_t);
+	in += sizeof(uint8_t);
+	return in;
+}
+
+size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	const void *in;
 	void *out = dst;
 	size_t out_size = 0;
 	int has_block_checksum;
 
-	{ /* With in-place decompression the header may become invalid later. */
-		const struct lz4_frame_header *h = in;
-
-		if (srcn < sizeof(*h) + sizeof(uint64_t) + sizeof(uint8_t))
-			return 0;	/* input overrun */
-
-		/* We assume there's always only a single, standard frame. */
-		if (le32toh(h->magic) != LZ4F_MAGICNUMBER || h->version != 1)
-			return 0;	/* unknown format */
-		if (h->reserved0 || h->reserved1 || h->reserved2)
-			return 0;	/* reserved must be zero */
-		if (!h->independent_blocks)
-			return 0;	/* we don't support block dependency */
-		has_block_checksum = h->has_block_checksum;
-
-		in += sizeof(*h);
-		if (h->has_content_size)
-			in += sizeof(uint64_t);
-		in += sizeof(uint8_t);
-	}
+	/* With in-place decompression the header may become invalid later. */
+	in = lz4_frame_blocks(src, srcn, &has_block_checksum);
+	if (!in)
+		return 0;
 
 	while (1) {
 		struct lz4_block_header b = { .raw = le32toh(*(uint32_t *)in) };
@@ -178,6 +188,108 @@ size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
 	return out_size;
 }
 
+/* Reads a length continued in 255 bytes, returns -1 on input overrun. */
+static int lz4_read_length(const uint8_t **in, const uint8_t *end,
+			   size_t *length)
+{
+	uint8_t s;
+
+	do {
+		if (*in >= end)
+			return -1;
+		s = *(*in)++;
+		*length += s;
+	} while (s == 255);
+	return 0;
+}
+
+/*
+ * Decodes one LZ4 block byte by byte until 'dstn' bytes are written. Unlike
+ * LZ4_decompress_generic() this never needs room for the whole block.
+ * Returns the number of bytes written, or -1 on error.
+ */
+static ssize_t lz4_block_head(const uint8_t *in, size_t srcn,
+			      uint8_t *dst, size_t dstn)
+{
+	const uint8_t *end = in + srcn;
+	uint8_t *out = dst;
+	size_t length, offset, copy;
+	unsigned int token;
+
+	while (in < end && out < dst + dstn) {
+		token = *in++;
+		length = token >> ML_BITS;
+		if (length == RUN_MASK && lz4_read_length(&in, end, &length))
+			return -1;
+		if (length > (size_t)(end - in))
+			return -1;	/* input overrun */
+		copy = MIN(length, (size_t)(dst + dstn - out));
+		memcpy(out, in, copy);
+		out += copy;
+		in += length;
+		if (in == end || out == dst + dstn)
+			break;		/* last literals or enough output */
+
+		if (end - in < 2)
+			return -1;
+		offset = LZ4_readLE16(in);
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - dst))
+			return -1;	/* match before the block */
+		length = token & ML_MASK;
+		if (length == ML_MASK && lz4_read_length(&in, end, &length))
+			return -1;
+		for (length += MINMATCH; length && out < dst + dstn; length--) {
+			*out = *(out - offset);
+			out++;
+		}
+	}
+	return out - dst;
+}
+
+size_t ulz4fn_head(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	const void *in;
+	void *out = dst;
+	int has_block_checksum;
+	ssize_t ret;
+
+	in = lz4_frame_blocks(src, srcn, &has_block_checksum);
+	if (!in)
+		return 0;
+
+	while (out < dst + dstn) {
+		struct lz4_block_header b;
+
+		if ((size_t)(in - src) + sizeof(b) > srcn)
+			return 0;		/* input overrun */
+		b.raw = le32toh(*(uint32_t *)in);
+		in += sizeof(b);
+
+		if ((size_t)(in - src) + b.size > srcn)
+			return 0;		/* input overrun */
+		if (!b.size)
+			break;			/* content is shorter */
+
+		if (b.not_compressed) {
+			ret = MIN((uint32_t)b.size, dst + dstn - out);
+			memcpy(out, in, ret);
+		} else {
+			ret = lz4_block_head(in, b.size, out,
+					     dst + dstn - out);
+			if (ret < 0)
+				return 0;	/* decompression error */
+		}
+		out += ret;
+
+		in += b.size;
+		if (has_block_checksum)
+			in += sizeof(uint32_t);
+	}
+
+	return out - dst;
+}
+
 size_t ulz4f(const void *src, void *dst)
 {
 	/* LZ4 uses signed size parameters, so can't just use ((u32)-1) here. */
@@ -1058,6 +1058,64 @@ static acpi_rsdp_t *valid_rsdp(acpi_rsdp_t *rsdp)
 	return rsdp;
 }
 
+/*
+ * The RSDP is the first table written to the high tables area in CBMEM. That
+ * copy is found without scanning the F segment, which the OS may also have
+ * reused.
+ */
+static acpi_rsdp_t *acpi_find_rsdp_cbmem(void)
+{
+	const struct cbmem_entry *entry = cbmem_entry_find(CBMEM_ID_ACPI);
+	uintptr_t p, end;
+	acpi_rsdp_t *rsdp;
+
+	if (entry == NULL)
+		return NULL;
+
+	p = ALIGN_UP((uintptr_t)cbmem_entry_start(entry), 16);
+	end = MIN(p + 4 * KiB, (uintptr_t)cbmem_entry_start(entry) +
+		  cbmem_entry_size(entry));
+
+	for (; p + sizeof(*rsdp) <= end; p += 16) {
+		rsdp = valid_rsdp((acpi_rsdp_t *)p);
+		if (rsdp)
+			return rsdp;
+	}
+
+	return NULL;
+}
+
+/*
+ * Check that rsdt looks like the RSDT coreboot wrote before reading all of
+ * it. With the RSDP from CBMEM, it has to lie in the same CBMEM entry.
+ */
+static int valid_rsdt(acpi_rsdt_t *rsdt, const struct cbmem_entry *entry)
+{
+	uintptr_t start = (uintptr_t)rsdt;
+	u32 length = rsdt->header.length;
+
+	if (strncmp(rsdt->header.signature, "RSDT", 4) != 0) {
+		printk(BIOS_ERR, "RSDT signature mismatch, no S3 resume.\n");
+		return 0;
+	}
+
+	if (length < sizeof(acpi_header_t) || length > sizeof(acpi_rsdt_t)) {
+		printk(BIOS_ERR, "RSDT length %u is invalid, no S3 resume.\n",
+		       length);
+		return 0;
+	}
+
+	if (entry != NULL &&
+	    (start < (uintptr_t)cbmem_entry_start(entry) ||
+	     start + length > (uintptr_t)cbmem_entry_start(entry) +
+	     cbmem_entry_size(entry))) {
+		printk(BIOS_ERR, "RSDT is outside of CBMEM, no S3 resume.\n");
+		return 0;
+	}
+
+	return 1;
+}
+
 void *acpi_find_wakeup_vector(void)
 {
 	char *p, *end;
@@ -1065,6 +1123,7 @@ void *acpi_find_wakeup_vector(void)
 	acpi_facs_t *facs;
 	acpi_fadt_t *fadt = NULL;
 	acpi_rsdp_t *rsdp = NULL;
+	const struct cbmem_entry *entry = NULL;
 	void *wake_vec;
 	int i;
 
@@ -1073,12 +1132,13 @@ void *acpi_find_wakeup_vector(void)
 
 	printk(BIOS_DEBUG, "Trying to find the wakeup vector...\n");
 
-	/* Find RSDP. */
-	for (p = (char *)0xe0000; p < (char *)0xfffff; p += 16) {
+	/* Find RSDP, preferably the one in CBMEM. */
+	rsdp = acpi_find_rsdp_cbmem();
+	if (rsdp != NULL)
+		entry = cbmem_entry_find(CBMEM_ID_ACPI);
+	for (p = (char *)0xe0000; rsdp == NULL && p < (char *)0xfffff;
+	     p += 16)
 		rsdp = valid_rsdp((acpi_rsdp_t *)p);
-		if (rsdp)
-			break;
-	}
 
 	if (rsdp == NULL)
 		return NULL;
@@ -1086,6 +1146,18 @@ void *acpi_find_wakeup_vector(void)
 	printk(BIOS_DEBUG, "RSDP found at %p\n", rsdp);
 	rsdt = (acpi_rsdt_t *)(uintptr_t)rsdp->rsdt_address;
 
+	/*
+	 * The tables written on the way into suspend are reused as they are,
+	 * so make sure the ones needed to resume are still intact.
+	 */
+	if (!valid_rsdt(rsdt, entry))
+		return NULL;
+
+	if (acpi_checksum((void *)rsdt, rsdt->header.length) != 0) {
+		printk(BIOS_ERR, "RSDT checksum mismatch, no S3 resume.\n");
+		return NULL;
+	}
+
 	end = (char *)rsdt + rsdt->header.length;
 	printk(BIOS_DEBUG, "RSDT found at %p ends at %p\n", rsdt, end);
 
@@ -1099,10 +1171,15 @@ void *acpi_find_wakeup_vector(void)
 	if (fadt == NULL)
 		return NULL;
 
+	if (acpi_checksum((void *)fadt, fadt->header.length) != 0) {
+		printk(BIOS_ERR, "FADT checksum mismatch, no S3 resume.\n");
+		return NULL;
+	}
+
 	printk(BIOS_DEBUG, "FADT found at %p\n", fadt);
 	facs = (acpi_facs_t *)(uintptr_t)fadt->firmware_ctrl;
 
-	if (facs == NULL) {
+	if (facs == NULL || strncmp(facs->signature, "FACS", 4)) {
 		printk(BIOS_DEBUG, "No FACS found, wake up from S3 not "
 		       "possible.\n");
 		return NULL;
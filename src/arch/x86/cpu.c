@@ -197,6 +197,7 @@ static void identify_cpu(struct device *cpu)
 			break;
 		}
 	}
+	dev_index_update(cpu);
 }
 
 struct cpu_driver *find_cpu_driver(struct device *cpu)
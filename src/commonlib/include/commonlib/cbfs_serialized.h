@@ -157,6 +157,7 @@ struct cbfs_file_attribute {
 #define CBFS_FILE_ATTR_TAG_HASH 0x68736148
 #define CBFS_FILE_ATTR_TAG_POSITION 0x42435350  /* PSCB */
 #define CBFS_FILE_ATTR_TAG_ALIGNMENT 0x42434c41 /* ALCB */
+#define CBFS_FILE_ATTR_TAG_PRELINK 0x42434c50 /* PLCB */
 
 struct cbfs_file_attr_compression {
 	uint32_t tag;
@@ -186,6 +187,13 @@ struct cbfs_file_attr_align {
 	uint32_t alignment;
 } __packed;
 
+/* An rmodule stage that was relocated at build time to run at base. */
+struct cbfs_file_attr_prelink {
+	uint32_t tag;
+	uint32_t len;
+	uint32_t base;
+} __packed;
+
 /*
  * ROMCC does not understand uint64_t, so we hide future definitions as they are
  * unlikely to be ever needed from ROMCC
@@ -235,6 +235,7 @@ static void asmlinkage ap_init(unsigned int cpu)
 
 	/* Fix up APIC id with reality. */
 	info->cpu->path.apic.apic_id = lapicid();
+	dev_index_update(info->cpu);
 
 	printk(BIOS_INFO, "AP: slot %d apic_id %x.\n", cpu,
 		info->cpu->path.apic.apic_id);
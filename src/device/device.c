@@ -43,6 +43,7 @@
 #include <device/device.h>
 #include <device/pci_def.h>
 #include <device/pci_ids.h>
+#include <memrange.h>
 #include <stdlib.h>
 #include <string.h>
 #include <smp/spinlock.h>
@@ -150,6 +151,7 @@ static device_t __alloc_dev(struct bus *parent, struct device_path *path)
 	 */
 	last_dev->next = dev;
 	last_dev = dev;
+	dev_index_add(dev);
 
 	return dev;
 }
@@ -197,6 +199,31 @@ static resource_t round(resource_t val, unsigned long pow)
 	return val;
 }
 
+/**
+ * Move an I/O base past the addresses that legacy devices decode.
+ *
+ * @param base The candidate base.
+ * @return The first usable base at or above it.
+ */
+static resource_t io_resource_base(resource_t base)
+{
+	/*
+	 * Don't allow potential aliases over the legacy PCI expansion card
+	 * addresses. The legacy PCI decodes only 10 bits, uses 0x100 - 0x3ff.
+	 * Therefore, only 0x00 - 0xff can be used out of each 0x400 block of
+	 * I/O space.
+	 */
+	if ((base & 0x300) != 0)
+		base = (base & ~0x3ff) + 0x400;
+	/*
+	 * Don't allow allocations in the VGA I/O range.
+	 * PCI has special cases for that.
+	 */
+	else if ((base >= 0x3b0) && (base <= 0x3df))
+		base = 0x3e0;
+	return base;
+}
+
 static const char * resource2str(struct resource *res)
 {
 	if (res->flags & IORESOURCE_IO)
@@ -420,25 +447,8 @@ static void compute_resources(struct bus *bus, struct resource *bridge,
 			       dev_path(dev), resource->index, resource->limit);
 		}
 
-		if (resource->flags & IORESOURCE_IO) {
-			/*
-			 * Don't allow potential aliases over the legacy PCI
-			 * expansion card addresses. The legacy PCI decodes
-			 * only 10 bits, uses 0x100 - 0x3ff. Therefore, only
-			 * 0x00 - 0xff can be used out of each 0x400 block of
-			 * I/O space.
-			 */
-			if ((base & 0x300) != 0) {
-				base = (base & ~0x3ff) + 0x400;
-			}
-			/*
-			 * Don't allow allocations in the VGA I/O range.
-			 * PCI has special cases for that.
-			 */
-			else if ((base >= 0x3b0) && (base <= 0x3df)) {
-				base = 0x3e0;
-			}
-		}
+		if (resource->flags & IORESOURCE_IO)
+			base = io_resource_base(base);
 		/* Base must be aligned. */
 		base = round(base, resource->align);
 		resource->base = base;
@@ -513,25 +523,8 @@ static void allocate_resources(struct bus *bus, struct resource *bridge,
 			continue;
 		}
 
-		if (resource->flags & IORESOURCE_IO) {
-			/*
-			 * Don't allow potential aliases over the legacy PCI
-			 * expansion card addresses. The legacy PCI decodes
-			 * only 10 bits, uses 0x100 - 0x3ff. Therefore, only
-			 * 0x00 - 0xff can be used out of each 0x400 block of
-			 * I/O space.
-			 */
-			if ((base & 0x300) != 0) {
-				base = (base & ~0x3ff) + 0x400;
-			}
-			/*
-			 * Don't allow allocations in the VGA I/O range.
-			 * PCI has special cases for that.
-			 */
-			else if ((base >= 0x3b0) && (base <= 0x3df)) {
-				base = 0x3e0;
-			}
-		}
+		if (resource->flags & IORESOURCE_IO)
+			base = io_resource_base(base);
 
 		if ((round(base, resource->align) + resource->size - 1) <=
 		    resource->limit) {
@@ -754,6 +747,558 @@ static void avoid_fixed_resources(struct device *dev)
 	}
 }
 
+/*
+ * The sorted allocator.
+ *
+ * Instead of searching the bus for the next largest resource for every
+ * placement, the resources of each bus are collected once into a slice of
+ * an array, which is sorted by alignment and size. Bridge windows are sized
+ * bottom-up from the slices of the buses behind them. Below the domains the
+ * resources are then packed into the bridge windows as before, but the
+ * resources directly below a domain are placed individually from free range
+ * lists of the domain windows, with the fixed resources punched out: I/O
+ * bottom-up, memory top-down, and prefetchable memory that may live above
+ * 4 GiB from the part of the windows above 4 GiB first.
+ */
+
+#define FOUR_GIB	(1ULL << 32)
+
+struct alloc_entry {
+	struct device *dev;
+	struct resource *res;
+	/* Bus behind a bridge resource, and the slice of its resources. */
+	struct bus *link;
+	uint16_t first_child;
+	uint16_t num_children;
+	/* Collection order, to keep the sort stable. */
+	uint16_t seq;
+};
+
+static struct alloc_entry *alloc_entries;
+static size_t alloc_count, alloc_max;
+
+static int alloc_entry_is(const struct alloc_entry *e,
+			  unsigned long type_mask, unsigned long type)
+{
+	return (e->res->flags & type_mask) == type;
+}
+
+/* Larger alignment first, then larger size, then collection order. */
+static int alloc_entry_before(const struct alloc_entry *a,
+			      const struct alloc_entry *b)
+{
+	if (a->res->align != b->res->align)
+		return a->res->align > b->res->align;
+	if (a->res->size != b->res->size)
+		return a->res->size > b->res->size;
+	return a->seq < b->seq;
+}
+
+static void sift_down(struct alloc_entry *e, size_t root, size_t num)
+{
+	struct alloc_entry tmp;
+	size_t child;
+
+	while ((child = 2 * root + 1) < num) {
+		if (child + 1 < num && alloc_entry_before(&e[child],
+							  &e[child + 1]))
+			child++;
+		if (!alloc_entry_before(&e[root], &e[child]))
+			return;
+		tmp = e[root];
+		e[root] = e[child];
+		e[child] = tmp;
+		root = child;
+	}
+}
+
+/* Heapsort, the heap keeps the entry that goes last on top. */
+static void sort_alloc_entries(struct alloc_entry *e, size_t num)
+{
+	struct alloc_entry tmp;
+	size_t i;
+
+	for (i = num / 2; i-- > 0;)
+		sift_down(e, i, num);
+	for (i = num; i-- > 1;) {
+		tmp = e[0];
+		e[0] = e[i];
+		e[i] = tmp;
+		sift_down(e, 0, i);
+	}
+}
+
+/*
+ * Append the resources of the devices on a bus, looking through subtractive
+ * resources like search_bus_resources() does.
+ */
+static void collect_bus_resources(struct bus *bus, unsigned long only_type)
+{
+	struct device *dev;
+	struct resource *res;
+
+	for (dev = bus->children; dev; dev = dev->sibling) {
+		if (!dev->enabled)
+			continue;
+
+		for (res = dev->resource_list; res; res = res->next) {
+			unsigned long type = res->flags & IORESOURCE_TYPE_MASK;
+			struct alloc_entry *e;
+
+			if (res->flags & IORESOURCE_FIXED)
+				continue;
+			if (type != IORESOURCE_IO && type != IORESOURCE_MEM)
+				continue;
+			if (only_type && type != only_type)
+				continue;
+
+			if (res->flags & IORESOURCE_SUBTRACTIVE) {
+				struct bus *subbus;
+
+				for (subbus = dev->link_list; subbus;
+				     subbus = subbus->next)
+					if (subbus->link_num ==
+					    IOINDEX_SUBTRACTIVE_LINK(res->index))
+						break;
+				if (subbus)
+					collect_bus_resources(subbus, type);
+				continue;
+			}
+
+			if (alloc_count == alloc_max) {
+				printk(BIOS_ERR, "%s: too many resources\n",
+				       __func__);
+				return;
+			}
+			e = &alloc_entries[alloc_count];
+			e->dev = dev;
+			e->res = res;
+			e->link = NULL;
+			e->first_child = 0;
+			e->num_children = 0;
+			e->seq = alloc_count;
+			alloc_count++;
+		}
+	}
+}
+
+/* Compute the size of a bridge resource from the sorted slice behind it. */
+static void size_bridge_resource(struct alloc_entry *e)
+{
+	struct resource *bridge = e->res;
+	unsigned long type_mask = IORESOURCE_TYPE_MASK | IORESOURCE_PREFETCH;
+	unsigned long type = bridge->flags & type_mask;
+	resource_t base = round(bridge->base, bridge->align);
+	size_t i;
+
+	for (i = e->first_child; i < e->first_child + e->num_children; i++) {
+		struct alloc_entry *child = &alloc_entries[i];
+		struct resource *resource = child->res;
+
+		if (!alloc_entry_is(child, type_mask, type) || !resource->size)
+			continue;
+
+		/* Propagate the resource alignment and limit to the bridge. */
+		if (resource->align > bridge->align)
+			bridge->align = resource->align;
+		if (bridge->limit > resource->limit)
+			bridge->limit = resource->limit;
+
+		/* Warn if it looks like APICs aren't declared. */
+		if ((resource->limit == 0xffffffff) &&
+		    (resource->flags & IORESOURCE_ASSIGNED)) {
+			printk(BIOS_ERR,
+			       "Resource limit looks wrong! (no APIC?)\n");
+			printk(BIOS_ERR, "%s %02lx limit %08llx\n",
+			       dev_path(child->dev), resource->index,
+			       resource->limit);
+		}
+
+		if (resource->flags & IORESOURCE_IO)
+			base = io_resource_base(base);
+		base = round(base, resource->align);
+		resource->base = base;
+		base += resource->size;
+	}
+
+	bridge->size = round(base, bridge->gran) -
+		       round(bridge->base, bridge->align);
+
+	printk(BIOS_SPEW, "%s %s: size: %llx align: %d gran: %d limit: %llx"
+	       " done\n", dev_path(e->dev), resource2str(bridge),
+	       bridge->size, bridge->align, bridge->gran, bridge->limit);
+}
+
+/*
+ * Collect the resources of a bus into a slice, size the bridges on it from
+ * the buses behind them and sort the slice.
+ */
+static void compute_bus_resources(struct bus *bus, size_t *first,
+				  size_t *num)
+{
+	size_t start = alloc_count;
+	size_t i, j;
+
+	collect_bus_resources(bus, 0);
+	*first = start;
+	*num = alloc_count - start;
+
+	for (i = start; i < start + *num; i++) {
+		struct alloc_entry *e = &alloc_entries[i];
+		size_t child_first, child_num;
+
+		if (!(e->res->flags & IORESOURCE_BRIDGE))
+			continue;
+
+		for (e->link = e->dev->link_list; e->link;
+		     e->link = e->link->next)
+			if (e->link->link_num == IOINDEX_LINK(e->res->index))
+				break;
+		if (!e->link) {
+			printk(BIOS_ERR, "link %ld not found on %s\n",
+			       IOINDEX_LINK(e->res->index), dev_path(e->dev));
+			continue;
+		}
+
+		/* The I/O and memory windows of a bridge share the bus. */
+		for (j = start; j < i; j++)
+			if (alloc_entries[j].link == e->link)
+				break;
+		if (j < i) {
+			e->first_child = alloc_entries[j].first_child;
+			e->num_children = alloc_entries[j].num_children;
+		} else {
+			compute_bus_resources(e->link, &child_first,
+					      &child_num);
+			e->first_child = child_first;
+			e->num_children = child_num;
+		}
+		size_bridge_resource(e);
+	}
+
+	sort_alloc_entries(&alloc_entries[start], *num);
+}
+
+static void assign_resource(struct alloc_entry *e, resource_t base)
+{
+	struct resource *resource = e->res;
+
+	resource->base = base;
+	resource->limit = resource->base + resource->size - 1;
+	resource->flags |= IORESOURCE_ASSIGNED;
+	resource->flags &= ~IORESOURCE_STORED;
+
+	printk(BIOS_SPEW, "%s %02lx *  [0x%llx - 0x%llx] %s\n",
+	       dev_path(e->dev), resource->index, resource->base,
+	       resource->base + resource->size - 1, resource2str(resource));
+}
+
+static void resource_did_not_fit(struct alloc_entry *e)
+{
+	printk(BIOS_ERR, "!! Resource didn't fit !!\n");
+	printk(BIOS_ERR, "   %s %02lx size %llx align %d limit %llx %s\n",
+	       dev_path(e->dev), e->res->index, e->res->size, e->res->align,
+	       e->res->limit, resource2str(e->res));
+}
+
+static void place_bridge_resources(struct alloc_entry *e);
+
+/* Pack the resources of a slice into a bridge window, like the original. */
+static void place_slice_in_bridge(struct resource *bridge, size_t first,
+				  size_t num, unsigned long type_mask,
+				  unsigned long type)
+{
+	resource_t base = bridge->base;
+	size_t i;
+
+	for (i = first; i < first + num; i++) {
+		struct alloc_entry *e = &alloc_entries[i];
+		struct resource *resource = e->res;
+
+		if (!alloc_entry_is(e, type_mask, type))
+			continue;
+
+		/* Propagate the bridge limit to the resource register. */
+		if (resource->limit > bridge->limit)
+			resource->limit = bridge->limit;
+
+		/* Size 0 resources can be skipped. */
+		if (!resource->size) {
+			/* Set the base to limit so it doesn't confuse tolm. */
+			resource->base = resource->limit;
+			resource->flags |= IORESOURCE_ASSIGNED;
+			continue;
+		}
+
+		if (resource->flags & IORESOURCE_IO)
+			base = io_resource_base(base);
+
+		if ((round(base, resource->align) + resource->size - 1) <=
+		    resource->limit) {
+			base = round(base, resource->align);
+			assign_resource(e, base);
+			base += resource->size;
+		} else {
+			resource_did_not_fit(e);
+		}
+	}
+
+	bridge->flags |= IORESOURCE_ASSIGNED;
+
+	for (i = first; i < first + num; i++)
+		if (alloc_entry_is(&alloc_entries[i], type_mask, type))
+			place_bridge_resources(&alloc_entries[i]);
+}
+
+static void place_bridge_resources(struct alloc_entry *e)
+{
+	unsigned long type_mask = IORESOURCE_TYPE_MASK | IORESOURCE_PREFETCH;
+
+	/* Leave the buses behind windows that didn't fit unassigned. */
+	if (!(e->res->flags & IORESOURCE_BRIDGE) || !e->link ||
+	    !(e->res->flags & IORESOURCE_ASSIGNED))
+		return;
+
+	place_slice_in_bridge(e->res, e->first_child, e->num_children,
+			      type_mask, e->res->flags & type_mask);
+}
+
+struct domain_ranges {
+	struct memranges io;
+	struct memranges mem_below_4g;
+	struct memranges mem_above_4g;
+};
+
+static void add_window(struct memranges *ranges, resource_t begin,
+		       resource_t end, struct resource *window)
+{
+	/* end is inclusive, so that a window up to 2^64 - 1 works. */
+	if (begin <= end)
+		memranges_insert(ranges, begin, end - begin + 1,
+				 (unsigned long)window);
+}
+
+static void punch_fixed_resources(struct domain_ranges *ranges,
+				  struct device *dev)
+{
+	struct resource *res;
+	struct device *child;
+	struct bus *link;
+
+	for (res = dev->resource_list; res; res = res->next) {
+		if (!(res->flags & IORESOURCE_FIXED) || !res->size)
+			continue;
+
+		if (resource_is(res, IORESOURCE_IO)) {
+			memranges_create_hole(&ranges->io, res->base,
+					      res->size);
+		} else if (resource_is(res, IORESOURCE_MEM)) {
+			memranges_create_hole(&ranges->mem_below_4g, res->base,
+					      res->size);
+			memranges_create_hole(&ranges->mem_above_4g, res->base,
+					      res->size);
+		}
+	}
+
+	for (link = dev->link_list; link; link = link->next)
+		for (child = link->children; child; child = child->sibling)
+			if (child->enabled)
+				punch_fixed_resources(ranges, child);
+}
+
+/* Lowest aligned base in the ranges, for I/O. */
+static int find_lowest_fit(struct memranges *ranges, struct resource *res,
+			   resource_t *base)
+{
+	struct range_entry *r;
+
+	memranges_each_entry(r, ranges) {
+		resource_t end = MIN(range_entry_end(r) - 1, res->limit);
+		resource_t b = round(io_resource_base(range_entry_base(r)),
+				     res->align);
+
+		if (b >= range_entry_base(r) && b <= end &&
+		    end - b >= res->size - 1) {
+			*base = b;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Highest aligned base in the ranges, for memory. */
+static int find_highest_fit(struct memranges *ranges, struct resource *res,
+			    resource_t *base)
+{
+	resource_t mask = (1ULL << res->align) - 1;
+	struct range_entry *r;
+	int found = 0;
+
+	memranges_each_entry(r, ranges) {
+		resource_t end = MIN(range_entry_end(r) - 1, res->limit);
+		resource_t b;
+
+		if (end < range_entry_base(r) ||
+		    end - range_entry_base(r) < res->size - 1)
+			continue;
+		b = (end - (res->size - 1)) & ~mask;
+		if (b < range_entry_base(r))
+			continue;
+		if (!found || b > *base)
+			*base = b;
+		found = 1;
+	}
+	return found;
+}
+
+static void place_domain_resource(struct domain_ranges *ranges,
+				  struct alloc_entry *e)
+{
+	struct resource *res = e->res;
+	struct memranges *used;
+	resource_t base;
+	int found;
+
+	if (!res->size) {
+		res->base = res->limit;
+		res->flags |= IORESOURCE_ASSIGNED;
+		return;
+	}
+
+	if (res->flags & IORESOURCE_IO) {
+		used = &ranges->io;
+		found = find_lowest_fit(used, res, &base);
+	} else {
+		used = &ranges->mem_above_4g;
+		found = 0;
+		if ((res->flags & IORESOURCE_PREFETCH) &&
+		    res->limit >= FOUR_GIB)
+			found = find_highest_fit(used, res, &base);
+		if (!found) {
+			used = &ranges->mem_below_4g;
+			found = find_highest_fit(used, res, &base);
+		}
+	}
+
+	if (!found) {
+		resource_did_not_fit(e);
+		return;
+	}
+
+	assign_resource(e, base);
+	memranges_create_hole(used, base, res->size);
+}
+
+/* Make the domain windows cover what was placed in them, like before. */
+static void update_domain_window(struct resource *window, size_t first,
+				 size_t num)
+{
+	resource_t begin = window->limit, end = window->base;
+	size_t i;
+
+	for (i = first; i < first + num; i++) {
+		struct resource *res = alloc_entries[i].res;
+
+		if (!res->size || !(res->flags & IORESOURCE_ASSIGNED) ||
+		    (res->flags & IORESOURCE_TYPE_MASK) !=
+		    (window->flags & IORESOURCE_TYPE_MASK) ||
+		    res->base < window->base || res->limit > window->limit)
+			continue;
+		begin = MIN(begin, res->base);
+		end = MAX(end, res->limit);
+	}
+
+	if (begin <= end) {
+		window->base = begin;
+		window->size = end - begin + 1;
+	} else {
+		window->size = 0;
+	}
+	window->flags |= IORESOURCE_ASSIGNED;
+}
+
+static void place_domain_resources(struct device *domain, size_t first,
+				   size_t num)
+{
+	struct domain_ranges ranges;
+	struct resource *res;
+	size_t i;
+
+	/* Resources can be smaller than a page, so keep byte granularity. */
+	memranges_init_empty_with_alignment(&ranges.io, NULL, 0, 0);
+	memranges_init_empty_with_alignment(&ranges.mem_below_4g, NULL, 0, 0);
+	memranges_init_empty_with_alignment(&ranges.mem_above_4g, NULL, 0, 0);
+
+	for (res = domain->resource_list; res; res = res->next) {
+		if (res->flags & IORESOURCE_FIXED)
+			continue;
+		if (res->flags & IORESOURCE_IO) {
+			add_window(&ranges.io, res->base, res->limit, res);
+		} else if (res->flags & IORESOURCE_MEM) {
+			if (res->base < FOUR_GIB)
+				add_window(&ranges.mem_below_4g, res->base,
+					   MIN(res->limit, FOUR_GIB - 1), res);
+			if (res->limit >= FOUR_GIB)
+				add_window(&ranges.mem_above_4g,
+					   MAX(res->base, FOUR_GIB),
+					   res->limit, res);
+		}
+	}
+
+	punch_fixed_resources(&ranges, domain);
+
+	for (i = first; i < first + num; i++)
+		place_domain_resource(&ranges, &alloc_entries[i]);
+
+	for (res = domain->resource_list; res; res = res->next)
+		if (!(res->flags & IORESOURCE_FIXED) &&
+		    (res->flags & (IORESOURCE_IO | IORESOURCE_MEM)))
+			update_domain_window(res, first, num);
+
+	for (i = first; i < first + num; i++)
+		place_bridge_resources(&alloc_entries[i]);
+
+	memranges_teardown(&ranges.io);
+	memranges_teardown(&ranges.mem_below_4g);
+	memranges_teardown(&ranges.mem_above_4g);
+}
+
+/**
+ * Allocate the resources of all domains with the sorted allocator.
+ *
+ * @param root The root device.
+ * @return 0 on success, -1 if the original allocator has to be used.
+ */
+static int allocate_sorted_resources(struct device *root)
+{
+	struct device *dev;
+	struct resource *res;
+	size_t first, num;
+
+	/* Every resource is collected at most once. */
+	alloc_max = 0;
+	for (dev = all_devices; dev; dev = dev->next)
+		for (res = dev->resource_list; res; res = res->next)
+			alloc_max++;
+	if (alloc_max > 0xffff) {
+		printk(BIOS_ERR, "%s: %zu resources, using the original "
+		       "allocator\n", __func__, alloc_max);
+		return -1;
+	}
+	alloc_entries = malloc(alloc_max * sizeof(*alloc_entries));
+	alloc_count = 0;
+
+	for (dev = root->link_list->children; dev; dev = dev->sibling) {
+		if (dev->path.type != DEVICE_PATH_DOMAIN || !dev->link_list)
+			continue;
+		post_log_path(dev);
+		compute_bus_resources(dev->link_list, &first, &num);
+		place_domain_resources(dev, first, num);
+	}
+
+	return 0;
+}
+
 device_t vga_pri = 0;
 static void set_vga_bridge_bits(void)
 {
@@ -1004,44 +1549,16 @@ void dev_enumerate(void)
 }
 
 /**
- * Configure devices on the devices tree.
+ * Compute and allocate the resources of all domains with the original
+ * allocator.
  *
- * Starting at the root of the device tree, travel it recursively in two
- * passes. In the first pass, we compute and allocate resources (ranges)
- * required by each device. In the second pass, the resources ranges are
- * relocated to their final position and stored to the hardware.
- *
- * I/O resources grow upward. MEM resources grow downward.
- *
- * Since the assignment is hierarchical we set the values into the dev_root
- * struct.
+ * @param root The root device.
  */
-void dev_configure(void)
+static void allocate_domain_resources(struct device *root)
 {
 	struct resource *res;
-	struct device *root;
 	struct device *child;
 
-	set_vga_bridge_bits();
-
-	printk(BIOS_INFO, "Allocating resources...\n");
-
-	root = &dev_root;
-
-	/*
-	 * Each domain should create resources which contain the entire address
-	 * space for IO, MEM, and PREFMEM resources in the domain. The
-	 * allocation of device resources will be done from this address space.
-	 */
-
-	/* Read the resources for the entire tree. */
-
-	printk(BIOS_INFO, "Reading resources...\n");
-	read_resources(root->link_list);
-	printk(BIOS_INFO, "Done reading resources.\n");
-
-	print_resource_tree(root, BIOS_SPEW, "After reading.");
-
 	/* Compute resources for all domains. */
 	for (child = root->link_list->children; child; child = child->sibling) {
 		if (!(child->path.type == DEVICE_PATH_DOMAIN))
@@ -1089,6 +1606,51 @@ void dev_configure(void)
 			}
 		}
 	}
+}
+
+/**
+ * Configure devices on the devices tree.
+ *
+ * Starting at the root of the device tree, travel it recursively in two
+ * passes. In the first pass, we compute and allocate resources (ranges)
+ * required by each device. In the second pass, the resources ranges are
+ * relocated to their final position and stored to the hardware.
+ *
+ * I/O resources grow upward. MEM resources grow downward.
+ *
+ * Since the assignment is hierarchical we set the values into the dev_root
+ * struct.
+ */
+void dev_configure(void)
+{
+	struct device *root;
+
+	set_vga_bridge_bits();
+
+	printk(BIOS_INFO, "Allocating resources...\n");
+
+	root = &dev_root;
+
+	/*
+	 * Each domain should create resources which contain the entire address
+	 * space for IO, MEM, and PREFMEM resources in the domain. The
+	 * allocation of device resources will be done from this address space.
+	 */
+
+	/* Read the resources for the entire tree. */
+
+	printk(BIOS_INFO, "Reading resources...\n");
+	read_resources(root->link_list);
+	printk(BIOS_INFO, "Done reading resources.\n");
+
+	print_resource_tree(root, BIOS_SPEW, "After reading.");
+
+	if (IS_ENABLED(CONFIG_RESOURCE_ALLOCATOR_SORTED) &&
+	    allocate_sorted_resources(root) == 0)
+		printk(BIOS_INFO, "Setting resources...\n");
+	else
+		allocate_domain_resources(root);
+
 	assign_resources(root->link_list);
 	printk(BIOS_INFO, "Done setting resources.\n");
 	print_resource_tree(root, BIOS_SPEW, "After assigning values.");
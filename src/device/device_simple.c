@@ -26,6 +26,32 @@
 /** Linked list of ALL devices */
 DEVTREE_CONST struct device * DEVTREE_CONST all_devices = &dev_root;
 
+/**
+ * Find the first entry with the given key in a sorted lookup table.
+ *
+ * @param table Lookup table generated by sconfig.
+ * @param count Number of entries in the table.
+ * @param key The key to look for.
+ * @return Index of the first matching entry, or count if there is none.
+ */
+static size_t dev_index_lookup(const struct device_index_entry *table,
+			       size_t count, u32 key)
+{
+	size_t lo = 0, hi = count;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (table[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < count && table[lo].key == key)
+		return lo;
+	return count;
+}
+
 /**
  * Given a PCI bus and a devfn number, find the device structure.
  *
@@ -36,18 +62,15 @@ DEVTREE_CONST struct device * DEVTREE_CONST all_devices = &dev_root;
 DEVTREE_CONST struct device *dev_find_slot(unsigned int bus,
 						unsigned int devfn)
 {
-	DEVTREE_CONST struct device *dev, *result;
+	size_t i;
 
-	result = 0;
-	for (dev = all_devices; dev; dev = dev->next) {
-		if ((dev->path.type == DEVICE_PATH_PCI) &&
-		    (dev->bus->secondary == bus) &&
-		    (dev->path.pci.devfn == devfn)) {
-			result = dev;
-			break;
-		}
+	/* Entries sharing a devfn are in list order, the bus tells them apart. */
+	for (i = dev_index_lookup(dev_index_pci, dev_index_pci_count, devfn);
+	     i < dev_index_pci_count && dev_index_pci[i].key == devfn; i++) {
+		if (dev_index_pci[i].dev->bus->secondary == bus)
+			return dev_index_pci[i].dev;
 	}
-	return result;
+	return 0;
 }
 
 /**
@@ -107,14 +130,11 @@ DEVTREE_CONST struct device *dev_find_slot_on_smbus(unsigned int bus,
  */
 DEVTREE_CONST struct device *dev_find_slot_pnp(u16 port, u16 device)
 {
-	DEVTREE_CONST struct device *dev;
+	size_t i;
 
-	for (dev = all_devices; dev; dev = dev->next) {
-		if ((dev->path.type == DEVICE_PATH_PNP) &&
-		    (dev->path.pnp.port == port) &&
-		    (dev->path.pnp.device == device)) {
-			return dev;
-		}
-	}
+	i = dev_index_lookup(dev_index_pnp, dev_index_pnp_count,
+			     (u32)port << 16 | device);
+	if (i < dev_index_pnp_count)
+		return dev_index_pnp[i].dev;
 	return 0;
 }
@@ -23,8 +23,189 @@
 #include <device/path.h>
 #include <device/pci_def.h>
 #include <device/resource.h>
+#include <smp/spinlock.h>
 #include <string.h>
 
+/*
+ * Lookup index for the dev_find_* functions. Devices are chained into
+ * two hash tables, one keyed by path (PCI devfn, PnP port/device and
+ * APIC id) and one keyed by vendor/device id. Chains are kept in
+ * all_devices order, so the first match is the device a walk of the
+ * list would have found. PCI bus numbers are assigned during enumeration
+ * and are therefore not part of the key but compared on lookup.
+ *
+ * The index is built on first use. alloc_dev() adds new devices, code
+ * that changes the path or id of a device afterwards must call
+ * dev_index_update().
+ */
+#define DEV_INDEX_BITS	8
+#define DEV_INDEX_SIZE	(1 << DEV_INDEX_BITS)
+
+struct dev_index {
+	struct device *first[DEV_INDEX_SIZE];
+	struct device *last[DEV_INDEX_SIZE];
+	size_t link;		/* offset of the chain link in struct device */
+};
+
+static struct dev_index dev_path_index = {
+	.link = offsetof(struct device, path_link),
+};
+static struct dev_index dev_id_index = {
+	.link = offsetof(struct device, id_link),
+};
+static unsigned int dev_index_last_pos;
+static int dev_index_ready;
+
+DECLARE_SPIN_LOCK(dev_index_lock)
+
+static struct device_index_link *dev_index_link_of(struct dev_index *index,
+						    struct device *dev)
+{
+	return (struct device_index_link *)((char *)dev + index->link);
+}
+
+static void dev_index_insert(struct dev_index *index, int bucket,
+			     struct device *dev)
+{
+	struct device_index_link *link = dev_index_link_of(index, dev);
+	struct device *prev = index->last[bucket];
+
+	/* New devices go to the end, only updated ones need to walk back. */
+	while (prev && prev->list_pos > dev->list_pos)
+		prev = dev_index_link_of(index, prev)->prev;
+
+	link->bucket = bucket;
+	link->prev = prev;
+	if (prev)
+		link->next = dev_index_link_of(index, prev)->next;
+	else
+		link->next = index->first[bucket];
+
+	if (link->next)
+		dev_index_link_of(index, link->next)->prev = dev;
+	else
+		index->last[bucket] = dev;
+	if (prev)
+		dev_index_link_of(index, prev)->next = dev;
+	else
+		index->first[bucket] = dev;
+}
+
+static void dev_index_remove(struct dev_index *index, struct device *dev)
+{
+	struct device_index_link *link = dev_index_link_of(index, dev);
+
+	if (!link->prev && index->first[link->bucket] != dev)
+		return;		/* not in the index */
+
+	if (link->prev)
+		dev_index_link_of(index, link->prev)->next = link->next;
+	else
+		index->first[link->bucket] = link->next;
+	if (link->next)
+		dev_index_link_of(index, link->next)->prev = link->prev;
+	else
+		index->last[link->bucket] = link->prev;
+	link->next = link->prev = NULL;
+}
+
+static int dev_index_hash(u32 key)
+{
+	return (key * 0x9e3779b1) >> (32 - DEV_INDEX_BITS);
+}
+
+static int dev_path_bucket(enum device_path_type type, u32 key)
+{
+	switch (type) {
+	case DEVICE_PATH_PCI:
+		return dev_index_hash(key);
+	case DEVICE_PATH_PNP:
+		return dev_index_hash(key ^ 0x50000000);
+	case DEVICE_PATH_APIC:
+		return dev_index_hash(key ^ 0xa0000000);
+	default:
+		return -1;
+	}
+}
+
+static int dev_path_bucket_of(struct device *dev)
+{
+	switch (dev->path.type) {
+	case DEVICE_PATH_PCI:
+		return dev_path_bucket(DEVICE_PATH_PCI, dev->path.pci.devfn);
+	case DEVICE_PATH_PNP:
+		return dev_path_bucket(DEVICE_PATH_PNP,
+			(u32)dev->path.pnp.port << 16 | dev->path.pnp.device);
+	case DEVICE_PATH_APIC:
+		return dev_path_bucket(DEVICE_PATH_APIC,
+			dev->path.apic.apic_id);
+	default:
+		return -1;
+	}
+}
+
+static int dev_id_bucket(u16 vendor, u16 device)
+{
+	return dev_index_hash((u32)device << 16 | vendor);
+}
+
+static void __dev_index_link(struct device *dev)
+{
+	int bucket = dev_path_bucket_of(dev);
+
+	if (bucket >= 0)
+		dev_index_insert(&dev_path_index, bucket, dev);
+	dev_index_insert(&dev_id_index, dev_id_bucket(dev->vendor, dev->device),
+			 dev);
+}
+
+/* Take the index lock, building the index on first use. */
+static void dev_index_acquire(void)
+{
+	struct device *dev;
+
+	spin_lock(&dev_index_lock);
+	if (dev_index_ready)
+		return;
+
+	for (dev = all_devices; dev; dev = dev->next) {
+		dev->list_pos = ++dev_index_last_pos;
+		__dev_index_link(dev);
+	}
+	dev_index_ready = 1;
+}
+
+/**
+ * Add a device that was just appended to all_devices to the lookup index.
+ *
+ * @param dev Pointer to the new device structure.
+ */
+void dev_index_add(struct device *dev)
+{
+	spin_lock(&dev_index_lock);
+	if (dev_index_ready) {
+		dev->list_pos = ++dev_index_last_pos;
+		__dev_index_link(dev);
+	}
+	spin_unlock(&dev_index_lock);
+}
+
+/**
+ * Rehash a device after its path or vendor/device id has changed.
+ *
+ * @param dev Pointer to the device structure.
+ */
+void dev_index_update(struct device *dev)
+{
+	spin_lock(&dev_index_lock);
+	if (dev_index_ready) {
+		dev_index_remove(&dev_path_index, dev);
+		dev_index_remove(&dev_id_index, dev);
+		__dev_index_link(dev);
+	}
+	spin_unlock(&dev_index_lock);
+}
+
 /**
  * See if a device structure exists for path.
  *
@@ -52,18 +233,18 @@ device_t find_dev_path(struct bus *parent, struct device_path *path)
  */
 struct device *dev_find_slot(unsigned int bus, unsigned int devfn)
 {
-	struct device *dev, *result;
+	struct device *dev;
 
-	result = 0;
-	for (dev = all_devices; dev; dev = dev->next) {
+	dev_index_acquire();
+	dev = dev_path_index.first[dev_path_bucket(DEVICE_PATH_PCI, devfn)];
+	for (; dev; dev = dev->path_link.next) {
 		if ((dev->path.type == DEVICE_PATH_PCI) &&
 		    (dev->bus->secondary == bus) &&
-		    (dev->path.pci.devfn == devfn)) {
-			result = dev;
+		    (dev->path.pci.devfn == devfn))
 			break;
-		}
 	}
-	return result;
+	spin_unlock(&dev_index_lock);
+	return dev;
 }
 
 /**
@@ -100,14 +281,17 @@ struct device *dev_find_slot_pnp(u16 port, u16 device)
 {
 	struct device *dev;
 
-	for (dev = all_devices; dev; dev = dev->next) {
+	dev_index_acquire();
+	dev = dev_path_index.first[dev_path_bucket(DEVICE_PATH_PNP,
+					    (u32)port << 16 | device)];
+	for (; dev; dev = dev->path_link.next) {
 		if ((dev->path.type == DEVICE_PATH_PNP) &&
 		    (dev->path.pnp.port == port) &&
-		    (dev->path.pnp.device == device)) {
-			return dev;
-		}
+		    (dev->path.pnp.device == device))
+			break;
 	}
-	return 0;
+	spin_unlock(&dev_index_lock);
+	return dev;
 }
 
 /**
@@ -118,16 +302,17 @@ struct device *dev_find_slot_pnp(u16 port, u16 device)
  */
 device_t dev_find_lapic(unsigned apic_id)
 {
-	device_t dev, result = NULL;
+	device_t dev;
 
-	for (dev = all_devices; dev; dev = dev->next) {
+	dev_index_acquire();
+	dev = dev_path_index.first[dev_path_bucket(DEVICE_PATH_APIC, apic_id)];
+	for (; dev; dev = dev->path_link.next) {
 		if (dev->path.type == DEVICE_PATH_APIC &&
-		    dev->path.apic.apic_id == apic_id) {
-			result = dev;
+		    dev->path.apic.apic_id == apic_id)
 			break;
-		}
 	}
-	return result;
+	spin_unlock(&dev_index_lock);
+	return dev;
 }
 
 /**
@@ -167,15 +352,22 @@ device_t dev_find_path(device_t prev_match, enum device_path_type path_type)
  */
 struct device *dev_find_device(u16 vendor, u16 device, struct device *from)
 {
-	if (!from)
-		from = all_devices;
-	else
-		from = from->next;
-
-	while (from && (from->vendor != vendor || from->device != device))
-		from = from->next;
+	struct device *dev;
 
-	return from;
+	dev_index_acquire();
+	/* Continue from the previous match if it is in the same chain. */
+	if (from && from->vendor == vendor && from->device == device)
+		dev = from->id_link.next;
+	else
+		dev = dev_id_index.first[dev_id_bucket(vendor, device)];
+	for (; dev; dev = dev->id_link.next) {
+		if (from && dev->list_pos <= from->list_pos)
+			continue;
+		if (dev->vendor == vendor && dev->device == device)
+			break;
+	}
+	spin_unlock(&dev_index_lock);
+	return dev;
 }
 
 /**
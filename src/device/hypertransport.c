@@ -383,6 +383,7 @@ static unsigned int do_hypertransport_scan_chain(struct bus *bus, unsigned min_d
 		static_count = 1;
 		for (func = dev; func; func = func->sibling) {
 			func->path.pci.devfn += (next_unitid << 3);
+			dev_index_update(func);
 			static_count = (func->path.pci.devfn >> 3)
 				        - (dev->path.pci.devfn >> 3) + 1;
 			last_func = func;
@@ -435,6 +436,7 @@ end_of_chain:
 		for (func = real_last_dev; func; func = func->sibling) {
 			func->path.pci.devfn -= ((real_last_unitid
 				- CONFIG_HT_CHAIN_END_UNITID_BASE) << 3);
+			dev_index_update(func);
 			last_func = func;
 		}
 
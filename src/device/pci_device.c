@@ -1050,6 +1050,7 @@ struct device *pci_probe_dev(struct device *dev, struct bus *bus,
 	dev->vendor = id & 0xffff;
 	dev->device = (id >> 16) & 0xffff;
 	dev->hdr_type = hdr_type;
+	dev_index_update(dev);
 
 	/* Class code, the upper 3 bytes of PCI_CLASS_REVISION. */
 	dev->class = class >> 8;
@@ -1105,6 +1106,7 @@ void pci_scan_bus(struct bus *bus, unsigned min_devfn,
 {
 	unsigned int devfn;
 	struct device *old_devices;
+	const uint32_t *present;
 
 	printk(BIOS_DEBUG, "PCI: pci_scan_bus for bus %02x\n", bus->secondary);
 
@@ -1122,6 +1124,12 @@ void pci_scan_bus(struct bus *bus, unsigned min_devfn,
 
 	post_code(0x24);
 
+	/*
+	 * If the functions found on the last boot are all still there, only
+	 * probe those and the static devices.
+	 */
+	present = pci_topology_lookup(bus, min_devfn, max_devfn);
+
 	/*
 	 * Probe all devices/functions on this bus with some optimization for
 	 * non-existence and single function devices.
@@ -1129,6 +1137,13 @@ void pci_scan_bus(struct bus *bus, unsigned min_devfn,
 	for (devfn = min_devfn; devfn <= max_devfn; devfn++) {
 		struct device *dev;
 
+		if (present) {
+			dev = pci_scan_get_dev(&old_devices, devfn);
+			if (dev || present[devfn / 32] & (1u << (devfn % 32)))
+				pci_probe_dev(dev, bus, devfn);
+			continue;
+		}
+
 		/* First thing setup the device structure. */
 		dev = pci_scan_get_dev(&old_devices, devfn);
 
@@ -1148,6 +1163,8 @@ void pci_scan_bus(struct bus *bus, unsigned min_devfn,
 
 	post_code(0x25);
 
+	pci_topology_record(bus, min_devfn, max_devfn);
+
 	/*
 	 * Warn if any leftover static devices are are found.
 	 * There's probably a problem in devicetree.cb.
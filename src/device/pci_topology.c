@@ -0,0 +1,360 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Cache of the PCI topology found by pci_scan_bus() on the previous boot.
+ *
+ * For every scanned bus the cache records which functions were present and
+ * their vendor/device IDs. If the hardware fingerprint of this boot matches
+ * the cached one, pci_scan_bus() only probes the functions that were there
+ * last time (plus the static devicetree devices) instead of walking all 256
+ * devfns. The IDs of the cached functions are read back before the bus is
+ * populated; on any difference the cache is dropped for the rest of the
+ * boot and the bus is scanned in full. The topology found on this boot is
+ * placed into CBMEM and written back to the flash region file when it
+ * changed.
+ */
+
+#include <bootstate.h>
+#include <cbmem.h>
+#include <commonlib/helpers.h>
+#include <console/console.h>
+#include <device/device.h>
+#include <device/pci.h>
+#include <fmap.h>
+#include <ip_checksum.h>
+#include <region_file.h>
+#include <string.h>
+#include <version.h>
+
+#define PCI_TOPOLOGY_SIGNATURE	0x4f545043	/* CPTO */
+#define PCI_TOPOLOGY_VERSION	1
+#define PCI_TOPOLOGY_SIZE	4096
+#define NO_PARENT		0xffff
+
+struct pci_topology_header {
+	uint32_t signature;
+	uint32_t fingerprint;
+	uint16_t version;
+	uint16_t size;		/* including this header */
+	uint16_t checksum;	/* of the bus records */
+	uint16_t buses;
+};
+
+struct pci_topology_bus {
+	uint16_t parent;	/* devfn of the bridge, NO_PARENT otherwise */
+	uint8_t secondary;
+	uint8_t min_devfn;
+	uint8_t max_devfn;
+	uint8_t reserved;
+	uint16_t functions;	/* number of IDs following */
+	uint32_t present[256 / 32];
+	uint32_t id[0];		/* vendor/device IDs in devfn order */
+};
+
+enum {
+	TOPOLOGY_UNKNOWN,	/* not loaded yet */
+	TOPOLOGY_VALID,
+	TOPOLOGY_INVALID,	/* missing, or didn't match this boot */
+};
+
+static int cached_state = TOPOLOGY_UNKNOWN;
+static uint32_t fingerprint;
+static uint8_t cached[PCI_TOPOLOGY_SIZE] __aligned(4);
+static uint8_t found[PCI_TOPOLOGY_SIZE] __aligned(4);
+static size_t found_size = sizeof(struct pci_topology_header);
+static int found_overflow;
+
+/*
+ * Mainboards can mix in anything else that changes which functions show up,
+ * e.g. a SKU ID or presence detect straps of connectors.
+ */
+uint32_t __attribute__((weak)) pci_topology_board_fingerprint(void)
+{
+	return 0;
+}
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+/*
+ * Everything besides the hardware that decides what gets enumerated: the
+ * build and the static devices enabled in the devicetree.
+ */
+static uint32_t compute_fingerprint(void)
+{
+	uint32_t hash = 2166136261;
+	uint32_t board = pci_topology_board_fingerprint();
+	struct device *dev;
+
+	hash = fnv1a(hash, coreboot_build, strlen(coreboot_build));
+	hash = fnv1a(hash, &board, sizeof(board));
+	for (dev = all_devices; dev; dev = dev->next) {
+		uint8_t state[2];
+
+		if (dev->path.type != DEVICE_PATH_PCI)
+			continue;
+		state[0] = dev->path.pci.devfn;
+		state[1] = dev->enabled;
+		hash = fnv1a(hash, state, sizeof(state));
+	}
+	return hash;
+}
+
+static size_t bus_size(const struct pci_topology_bus *b)
+{
+	return sizeof(*b) + b->functions * sizeof(b->id[0]);
+}
+
+static int topology_valid(const uint8_t *buf, size_t size)
+{
+	const struct pci_topology_header *hdr = (const void *)buf;
+	size_t offset = sizeof(*hdr);
+	int i;
+
+	if (size < sizeof(*hdr) || hdr->signature != PCI_TOPOLOGY_SIGNATURE ||
+	    hdr->version != PCI_TOPOLOGY_VERSION || hdr->size > size ||
+	    hdr->size < sizeof(*hdr))
+		return 0;
+	if (compute_ip_checksum(buf + sizeof(*hdr), hdr->size - sizeof(*hdr))
+	    != hdr->checksum)
+		return 0;
+
+	/* Make sure the bus records stay inside the data. */
+	for (i = 0; i < hdr->buses; i++) {
+		const struct pci_topology_bus *b = (const void *)(buf + offset);
+
+		if (offset + sizeof(*b) > hdr->size ||
+		    offset + bus_size(b) > hdr->size)
+			return 0;
+		offset += bus_size(b);
+	}
+	return 1;
+}
+
+static int locate_region_file(struct region_file *file)
+{
+	struct region_device rdev;
+
+	if (fmap_locate_area_as_rdev_rw(CONFIG_PCI_TOPOLOGY_CACHE_REGION,
+					&rdev) < 0) {
+		printk(BIOS_DEBUG, "PCI: No '%s' region for topology cache\n",
+		       CONFIG_PCI_TOPOLOGY_CACHE_REGION);
+		return -1;
+	}
+	if (region_file_init(file, &rdev) < 0) {
+		printk(BIOS_ERR, "PCI: Region file invalid in '%s'\n",
+		       CONFIG_PCI_TOPOLOGY_CACHE_REGION);
+		return -1;
+	}
+	return 0;
+}
+
+static void load_topology(void)
+{
+	const struct pci_topology_header *hdr = (const void *)cached;
+	struct region_file file;
+	struct region_device rdev;
+	size_t size;
+
+	cached_state = TOPOLOGY_INVALID;
+	fingerprint = compute_fingerprint();
+
+	if (locate_region_file(&file) < 0 || region_file_data(&file, &rdev) < 0)
+		return;
+
+	size = MIN(region_device_sz(&rdev), sizeof(cached));
+	if (rdev_readat(&rdev, cached, 0, size) != size ||
+	    !topology_valid(cached, size)) {
+		printk(BIOS_DEBUG, "PCI: No valid topology cache\n");
+		return;
+	}
+	if (hdr->fingerprint != fingerprint) {
+		printk(BIOS_DEBUG, "PCI: Topology cache fingerprint mismatch\n");
+		return;
+	}
+
+	printk(BIOS_DEBUG, "PCI: Using topology cache, %d buses\n", hdr->buses);
+	cached_state = TOPOLOGY_VALID;
+}
+
+static uint16_t bus_parent(struct bus *bus)
+{
+	if (bus->dev && bus->dev->path.type == DEVICE_PATH_PCI)
+		return bus->dev->path.pci.devfn;
+	return NO_PARENT;
+}
+
+static struct pci_topology_bus *find_bus(uint8_t *buf, struct bus *bus,
+				unsigned int min_devfn, unsigned int max_devfn)
+{
+	const struct pci_topology_header *hdr = (const void *)buf;
+	size_t offset = sizeof(*hdr);
+	int i;
+
+	for (i = 0; i < hdr->buses; i++) {
+		struct pci_topology_bus *b = (void *)(buf + offset);
+
+		if (b->secondary == bus->secondary &&
+		    b->parent == bus_parent(bus) &&
+		    b->min_devfn == min_devfn && b->max_devfn == max_devfn)
+			return b;
+		offset += bus_size(b);
+	}
+	return NULL;
+}
+
+static inline int devfn_present(const uint32_t *present, unsigned int devfn)
+{
+	return !!(present[devfn / 32] & (1u << (devfn % 32)));
+}
+
+static uint32_t read_id(struct bus *bus, unsigned int devfn)
+{
+	struct device dummy;
+
+	dummy.bus = bus;
+	dummy.path.type = DEVICE_PATH_PCI;
+	dummy.path.pci.devfn = devfn;
+	return pci_read_config32(&dummy, PCI_VENDOR_ID);
+}
+
+const uint32_t *pci_topology_lookup(struct bus *bus, unsigned int min_devfn,
+				    unsigned int max_devfn)
+{
+	const struct pci_topology_bus *b;
+	unsigned int devfn;
+	int i = 0;
+
+	if (cached_state == TOPOLOGY_UNKNOWN)
+		load_topology();
+	if (cached_state != TOPOLOGY_VALID)
+		return NULL;
+
+	b = find_bus(cached, bus, min_devfn, max_devfn);
+	if (!b) {
+		printk(BIOS_DEBUG, "PCI: Bus %02x not in topology cache\n",
+		       bus->secondary);
+		cached_state = TOPOLOGY_INVALID;
+		return NULL;
+	}
+
+	/*
+	 * An empty bus costs no more to scan in full, and that is where a new
+	 * card would show up.
+	 */
+	if (!b->functions)
+		return NULL;
+
+	for (devfn = min_devfn; devfn <= max_devfn; devfn++) {
+		if (!devfn_present(b->present, devfn))
+			continue;
+		if (read_id(bus, devfn) != b->id[i++]) {
+			printk(BIOS_INFO, "PCI: %02x:%02x.%01x changed, "
+			       "dropping topology cache\n", bus->secondary,
+			       PCI_SLOT(devfn), PCI_FUNC(devfn));
+			cached_state = TOPOLOGY_INVALID;
+			return NULL;
+		}
+	}
+
+	return b->present;
+}
+
+void pci_topology_record(struct bus *bus, unsigned int min_devfn,
+			 unsigned int max_devfn)
+{
+	struct pci_topology_header *hdr = (void *)found;
+	struct pci_topology_bus *b;
+	struct device *dev;
+	int functions = 0;
+
+	if (found_overflow || find_bus(found, bus, min_devfn, max_devfn))
+		return;
+
+	for (dev = bus->children; dev; dev = dev->sibling)
+		if (dev->path.type == DEVICE_PATH_PCI && dev->vendor &&
+		    dev->vendor != 0xffff)
+			functions++;
+
+	b = (void *)(found + found_size);
+	if (found_size + sizeof(*b) + functions * sizeof(b->id[0]) >
+	    sizeof(found)) {
+		printk(BIOS_WARNING, "PCI: Topology cache full\n");
+		found_overflow = 1;
+		return;
+	}
+
+	memset(b, 0, sizeof(*b));
+	b->parent = bus_parent(bus);
+	b->secondary = bus->secondary;
+	b->min_devfn = min_devfn;
+	b->max_devfn = max_devfn;
+
+	/* Children are in devfn order after pci_scan_bus(). */
+	for (dev = bus->children; dev; dev = dev->sibling) {
+		unsigned int devfn = dev->path.pci.devfn;
+
+		if (dev->path.type != DEVICE_PATH_PCI || !dev->vendor ||
+		    dev->vendor == 0xffff)
+			continue;
+		b->present[devfn / 32] |= 1u << (devfn % 32);
+		b->id[b->functions++] = dev->vendor | dev->device << 16;
+	}
+
+	found_size += bus_size(b);
+	hdr->buses++;
+}
+
+static void update_topology_cache(void *unused)
+{
+	struct pci_topology_header *hdr = (void *)found;
+	const struct pci_topology_header *old = (const void *)cached;
+	struct region_file file;
+	void *cbmem;
+
+	if (found_overflow || !hdr->buses)
+		return;
+
+	hdr->signature = PCI_TOPOLOGY_SIGNATURE;
+	hdr->version = PCI_TOPOLOGY_VERSION;
+	hdr->fingerprint = fingerprint;
+	hdr->size = found_size;
+	hdr->checksum = compute_ip_checksum(found + sizeof(*hdr),
+					    found_size - sizeof(*hdr));
+
+	cbmem = cbmem_add(CBMEM_ID_PCI_TOPOLOGY, found_size);
+	if (cbmem)
+		memcpy(cbmem, found, found_size);
+
+	if (cached_state == TOPOLOGY_VALID && old->size == found_size &&
+	    !memcmp(cached, found, found_size))
+		return;
+
+	printk(BIOS_DEBUG, "PCI: Topology cache needs update\n");
+	if (locate_region_file(&file) < 0)
+		return;
+	if (region_file_update_data(&file, found, found_size) < 0)
+		printk(BIOS_ERR, "PCI: Failed to update topology cache\n");
+}
+
+BOOT_STATE_INIT_ENTRY(BS_DEV_ENUMERATE, BS_ON_EXIT, update_topology_cache,
+		      NULL);
@@ -0,0 +1,413 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Serial Flash Discoverable Parameters (JESD216)
+ *
+ * Flash parts with SFDP describe their read commands, address modes, erase
+ * sizes and page size in a table read with CMD_READ_SFDP. The Basic Flash
+ * Parameter Table (BFPT) is parsed for the fast read commands using two or
+ * four data lines, and the 4-byte Address Instruction Table (4BAIT) for the
+ * stateless 4-byte address opcodes needed above 16 MiB. The best read
+ * command both the flash and the controller can do is then used by
+ * spi_flash_read(). Parts that aren't in any of the vendor tables can be
+ * driven entirely from SFDP.
+ */
+
+#include <commonlib/helpers.h>
+#include <console/console.h>
+#include <endian.h>
+#include <spi_flash.h>
+#include <spi-generic.h>
+#include <string.h>
+
+#include "spi_flash_internal.h"
+
+#define CMD_READ_SFDP		0x5a
+#define SFDP_SIGNATURE		0x50444653	/* SFDP */
+#define SFDP_MAX_HEADERS	8
+
+#define SFDP_ID_BFPT		0xff00
+#define SFDP_ID_4BAIT		0xff84
+
+/* BFPT DWORD 1 */
+#define BFPT1_FAST_READ_1_1_2	(1 << 16)
+#define BFPT1_ADDR_MASK		(3 << 17)
+#define  BFPT1_ADDR_3B		(0 << 17)
+#define  BFPT1_ADDR_3B_4B	(1 << 17)
+#define  BFPT1_ADDR_4B		(2 << 17)
+#define BFPT1_FAST_READ_1_2_2	(1 << 20)
+#define BFPT1_FAST_READ_1_4_4	(1 << 21)
+#define BFPT1_FAST_READ_1_1_4	(1 << 22)
+/* BFPT DWORD 2 */
+#define BFPT2_DENSITY_POW2	(1UL << 31)
+/* BFPT DWORD 11, JESD216A and later */
+#define BFPT11_PAGE_SHIFT(x)	(((x) >> 4) & 0xf)
+
+#define BFPT_DWORDS		11
+
+/* 4BAIT DWORD 1 */
+#define FOURBAIT_FAST_READ	(1 << 1)
+#define FOURBAIT_READ_1_1_2	(1 << 2)
+#define FOURBAIT_READ_1_2_2	(1 << 3)
+#define FOURBAIT_READ_1_1_4	(1 << 4)
+#define FOURBAIT_READ_1_4_4	(1 << 5)
+
+#define FOURBAIT_DWORDS		1
+
+#define CMD_READ_ARRAY_FAST_4B	0x0c
+
+#define SIZE_16M		(16 * MiB)
+
+struct sfdp_param_header {
+	u8 id_lsb;
+	u8 minor;
+	u8 major;
+	u8 length;		/* in DWORDs */
+	u8 pointer[3];
+	u8 id_msb;
+};
+
+static int sfdp_read(const struct spi_slave *spi, u32 offset, void *buf,
+		     size_t len)
+{
+	u8 cmd[5];
+
+	cmd[0] = CMD_READ_SFDP;
+	cmd[1] = offset >> 16;
+	cmd[2] = offset >> 8;
+	cmd[3] = offset;
+	cmd[4] = 0;		/* 8 dummy cycles */
+
+	return spi_flash_cmd_read(spi, cmd, sizeof(cmd), buf, len);
+}
+
+/* Read up to dwords of a parameter table, zero the ones it doesn't have. */
+static int sfdp_read_table(const struct spi_slave *spi,
+			   const struct sfdp_param_header *ph, u32 *table,
+			   size_t dwords)
+{
+	u32 pointer = ph->pointer[0] | ph->pointer[1] << 8 |
+		ph->pointer[2] << 16;
+	size_t i;
+
+	memset(table, 0, dwords * sizeof(*table));
+	if (dwords > ph->length)
+		dwords = ph->length;
+	if (sfdp_read(spi, pointer, table, dwords * sizeof(*table)))
+		return -1;
+
+	/* SFDP is little endian. */
+	for (i = 0; i < dwords; i++)
+		table[i] = le32toh(table[i]);
+	return 0;
+}
+
+static void sfdp_read_cmd(struct spi_flash_sfdp *sfdp, int mode, u32 dword,
+			  int shift)
+{
+	struct spi_flash_read_cmd *rc = &sfdp->read_cmds[mode];
+	u32 fields = dword >> shift;
+
+	rc->opcode = (fields >> 8) & 0xff;
+	rc->io_mode = mode;
+	rc->addr_len = 3;
+	/* Dummy clocks plus mode clocks */
+	rc->dummy_cycles = (fields & 0x1f) + ((fields >> 5) & 0x7);
+	if (rc->opcode)
+		sfdp->read_modes |= SPI_FLASH_IO_MODE(mode);
+}
+
+static int sfdp_parse_bfpt(struct spi_flash_sfdp *sfdp, const u32 *bfpt)
+{
+	int i;
+
+	if (bfpt[1] & BFPT2_DENSITY_POW2) {
+		u32 shift = bfpt[1] & ~BFPT2_DENSITY_POW2;
+
+		/* 2^N bits, anything at or above 2^35 doesn't fit u32. */
+		if (shift < 3 || shift >= 35)
+			return -1;
+		sfdp->size = 1U << (shift - 3);
+	} else {
+		/* N - 1 bits */
+		sfdp->size = (bfpt[1] >> 3) + 1;
+	}
+
+	switch (bfpt[0] & BFPT1_ADDR_MASK) {
+	case BFPT1_ADDR_3B_4B:
+		sfdp->addr_modes = SFDP_ADDR_3B | SFDP_ADDR_4B;
+		break;
+	case BFPT1_ADDR_4B:
+		sfdp->addr_modes = SFDP_ADDR_4B;
+		break;
+	default:
+		sfdp->addr_modes = SFDP_ADDR_3B;
+		break;
+	}
+
+	/* Fast read is required by JESD216 and not described by it. */
+	sfdp->read_cmds[SPI_FLASH_IO_1_1_1].opcode = CMD_READ_ARRAY_FAST;
+	sfdp->read_cmds[SPI_FLASH_IO_1_1_1].io_mode = SPI_FLASH_IO_1_1_1;
+	sfdp->read_cmds[SPI_FLASH_IO_1_1_1].addr_len = 3;
+	sfdp->read_cmds[SPI_FLASH_IO_1_1_1].dummy_cycles = 8;
+	sfdp->read_modes = SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_1);
+
+	if (bfpt[0] & BFPT1_FAST_READ_1_4_4)
+		sfdp_read_cmd(sfdp, SPI_FLASH_IO_1_4_4, bfpt[2], 0);
+	if (bfpt[0] & BFPT1_FAST_READ_1_1_4)
+		sfdp_read_cmd(sfdp, SPI_FLASH_IO_1_1_4, bfpt[2], 16);
+	if (bfpt[0] & BFPT1_FAST_READ_1_1_2)
+		sfdp_read_cmd(sfdp, SPI_FLASH_IO_1_1_2, bfpt[3], 0);
+	if (bfpt[0] & BFPT1_FAST_READ_1_2_2)
+		sfdp_read_cmd(sfdp, SPI_FLASH_IO_1_2_2, bfpt[3], 16);
+
+	/* Erase types 1 and 2 in DWORD 8, 3 and 4 in DWORD 9 */
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++) {
+		u32 fields = bfpt[7 + i / 2] >> (16 * (i % 2));
+
+		sfdp->erase_types[i].size_shift = fields & 0xff;
+		sfdp->erase_types[i].opcode = (fields >> 8) & 0xff;
+		/* Sizes below a 256 byte page or above 2 GiB are bogus. */
+		if (sfdp->erase_types[i].size_shift < 8 ||
+		    sfdp->erase_types[i].size_shift > 31)
+			sfdp->erase_types[i].size_shift = 0;
+	}
+
+	sfdp->page_size = 256;
+	if (BFPT11_PAGE_SHIFT(bfpt[10]))
+		sfdp->page_size = 1 << BFPT11_PAGE_SHIFT(bfpt[10]);
+
+	return 0;
+}
+
+static void sfdp_parse_4bait(struct spi_flash_sfdp *sfdp, const u32 *fourbait)
+{
+	static const struct {
+		u8 mode;
+		u8 opcode;
+		u16 bit;
+	} reads[] = {
+		{ SPI_FLASH_IO_1_1_1, CMD_READ_ARRAY_FAST_4B, FOURBAIT_FAST_READ },
+		{ SPI_FLASH_IO_1_1_2, 0x3c, FOURBAIT_READ_1_1_2 },
+		{ SPI_FLASH_IO_1_2_2, 0xbc, FOURBAIT_READ_1_2_2 },
+		{ SPI_FLASH_IO_1_1_4, 0x6c, FOURBAIT_READ_1_1_4 },
+		{ SPI_FLASH_IO_1_4_4, 0xec, FOURBAIT_READ_1_4_4 },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(reads); i++)
+		if (fourbait[0] & reads[i].bit)
+			sfdp->read_opcodes_4b[reads[i].mode] = reads[i].opcode;
+}
+
+int spi_flash_sfdp_parse(const struct spi_slave *spi,
+			 struct spi_flash_sfdp *sfdp)
+{
+	struct sfdp_param_header ph;
+	u32 header[2];
+	u32 bfpt[BFPT_DWORDS];
+	u32 fourbait[FOURBAIT_DWORDS];
+	int headers, i;
+	int found_bfpt = 0;
+
+	memset(sfdp, 0, sizeof(*sfdp));
+
+	if (sfdp_read(spi, 0, header, sizeof(header)) ||
+	    le32toh(header[0]) != SFDP_SIGNATURE)
+		return -1;
+
+	/* The number of parameter headers is 0 based. */
+	headers = MIN(((le32toh(header[1]) >> 16) & 0xff) + 1,
+		      SFDP_MAX_HEADERS);
+
+	for (i = 0; i < headers; i++) {
+		u16 id;
+
+		if (sfdp_read(spi, sizeof(header) + i * sizeof(ph), &ph,
+			      sizeof(ph)))
+			return -1;
+
+		id = ph.id_msb << 8 | ph.id_lsb;
+		if (id == SFDP_ID_BFPT && !found_bfpt) {
+			/* JESD216 requires at least 9 DWORDs. */
+			if (ph.length < 9 ||
+			    sfdp_read_table(spi, &ph, bfpt, ARRAY_SIZE(bfpt)) ||
+			    sfdp_parse_bfpt(sfdp, bfpt))
+				return -1;
+			found_bfpt = 1;
+		} else if (id == SFDP_ID_4BAIT && ph.length >= FOURBAIT_DWORDS) {
+			if (sfdp_read_table(spi, &ph, fourbait,
+					    ARRAY_SIZE(fourbait)))
+				return -1;
+			sfdp_parse_4bait(sfdp, fourbait);
+		}
+	}
+
+	return found_bfpt ? 0 : -1;
+}
+
+/* Pick the fastest read command both the flash and the controller know. */
+static void sfdp_pick_read_cmd(struct spi_flash *flash,
+			       const struct spi_flash_sfdp *sfdp)
+{
+	static const u8 preferred[] = {
+		SPI_FLASH_IO_1_4_4, SPI_FLASH_IO_1_1_4,
+		SPI_FLASH_IO_1_2_2, SPI_FLASH_IO_1_1_2,
+		SPI_FLASH_IO_1_1_1,
+	};
+	const struct spi_ctrlr *ctrlr = flash->spi.ctrlr;
+	u32 modes = SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_1);
+	int i;
+
+	if (ctrlr && ctrlr->flash_read)
+		modes |= ctrlr->flash_read_modes;
+	modes &= sfdp->read_modes;
+
+	for (i = 0; i < ARRAY_SIZE(preferred); i++) {
+		int mode = preferred[i];
+
+		if (!(modes & SPI_FLASH_IO_MODE(mode)))
+			continue;
+
+		flash->read_cmd = sfdp->read_cmds[mode];
+		if (sfdp->addr_modes == SFDP_ADDR_4B) {
+			flash->read_cmd.addr_len = 4;
+		} else if (flash->size > SIZE_16M &&
+			   sfdp->read_opcodes_4b[mode]) {
+			/* Reach above 16 MiB without switching address mode. */
+			flash->read_cmd.opcode = sfdp->read_opcodes_4b[mode];
+			flash->read_cmd.addr_len = 4;
+		}
+		break;
+	}
+}
+
+void spi_flash_sfdp_apply(struct spi_flash *flash,
+			  const struct spi_flash_sfdp *sfdp)
+{
+	static const char *const io_modes[] = {
+		[SPI_FLASH_IO_1_1_1] = "1-1-1",
+		[SPI_FLASH_IO_1_1_2] = "1-1-2",
+		[SPI_FLASH_IO_1_2_2] = "1-2-2",
+		[SPI_FLASH_IO_1_1_4] = "1-1-4",
+		[SPI_FLASH_IO_1_4_4] = "1-4-4",
+	};
+	int i;
+
+	if (!IS_ENABLED(CONFIG_SPI_FLASH_NO_FAST_READ))
+		sfdp_pick_read_cmd(flash, sfdp);
+
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++)
+		flash->erase_types[i] = sfdp->erase_types[i];
+
+	if (flash->read_cmd.opcode)
+		printk(BIOS_DEBUG, "SF: SFDP read opcode %02x %s, %d-byte "
+		       "address, %d dummy cycles\n", flash->read_cmd.opcode,
+		       io_modes[flash->read_cmd.io_mode],
+		       flash->read_cmd.addr_len, flash->read_cmd.dummy_cycles);
+}
+
+void spi_flash_sfdp_setup(const struct spi_slave *spi, struct spi_flash *flash)
+{
+	struct spi_flash_sfdp sfdp;
+
+	if (spi_flash_sfdp_parse(spi, &sfdp)) {
+		printk(BIOS_DEBUG, "SF: No SFDP\n");
+		return;
+	}
+	spi_flash_sfdp_apply(flash, &sfdp);
+}
+
+int spi_flash_sfdp_read(const struct spi_flash *flash, u32 offset, size_t len,
+			void *buf)
+{
+	const struct spi_flash_read_cmd *rc = &flash->read_cmd;
+	const struct spi_slave *spi = &flash->spi;
+	u8 cmd[1 + 4 + 4];
+	size_t cmd_len = 0;
+	int ret;
+
+	if (rc->io_mode != SPI_FLASH_IO_1_1_1) {
+		if (spi_claim_bus(spi))
+			return -1;
+		ret = spi->ctrlr->flash_read(spi, rc, offset, len, buf);
+		spi_release_bus(spi);
+		return ret;
+	}
+
+	cmd[cmd_len++] = rc->opcode;
+	if (rc->addr_len == 4)
+		cmd[cmd_len++] = offset >> 24;
+	cmd[cmd_len++] = offset >> 16;
+	cmd[cmd_len++] = offset >> 8;
+	cmd[cmd_len++] = offset;
+	/* Clock the dummy cycles with zero bytes on a single line. */
+	memset(&cmd[cmd_len], 0, DIV_ROUND_UP(rc->dummy_cycles, 8));
+	cmd_len += DIV_ROUND_UP(rc->dummy_cycles, 8);
+
+	return spi_flash_cmd_read(spi, cmd, cmd_len, buf, len);
+}
+
+/* spi_flash_read() uses the SFDP read command instead, if there is one. */
+static const struct spi_flash_ops spi_flash_ops = {
+	.write = spi_flash_cmd_write_page_program,
+	.erase = spi_flash_cmd_erase,
+	.status = spi_flash_cmd_status,
+#if IS_ENABLED(CONFIG_SPI_FLASH_NO_FAST_READ)
+	.read = spi_flash_cmd_read_slow,
+#else
+	.read = spi_flash_cmd_read_fast,
+#endif
+};
+
+int spi_flash_probe_sfdp(const struct spi_slave *spi, u8 *idcode,
+			 struct spi_flash *flash)
+{
+	struct spi_flash_sfdp sfdp;
+	int i, smallest = -1;
+
+	if (spi_flash_sfdp_parse(spi, &sfdp))
+		return -1;
+
+	/* Writes and erases use 3-byte addresses. */
+	if (!(sfdp.addr_modes & SFDP_ADDR_3B) || sfdp.size > SIZE_16M) {
+		printk(BIOS_WARNING, "SF: SFDP part needs 4-byte addresses\n");
+		return -1;
+	}
+
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++) {
+		if (!sfdp.erase_types[i].size_shift)
+			continue;
+		if (smallest < 0 || sfdp.erase_types[i].size_shift <
+		    sfdp.erase_types[smallest].size_shift)
+			smallest = i;
+	}
+	if (smallest < 0)
+		return -1;
+
+	memcpy(&flash->spi, spi, sizeof(*spi));
+	flash->name = "SFDP";
+	flash->size = sfdp.size;
+	flash->page_size = sfdp.page_size;
+	flash->sector_size = 1 << sfdp.erase_types[smallest].size_shift;
+	flash->erase_cmd = sfdp.erase_types[smallest].opcode;
+	flash->status_cmd = CMD_READ_STATUS;
+	flash->ops = &spi_flash_ops;
+
+	spi_flash_sfdp_apply(flash, &sfdp);
+
+	printk(BIOS_INFO, "SF: SFDP part %02x %02x%02x\n", idcode[0],
+	       idcode[1], idcode[2]);
+	return 0;
+}
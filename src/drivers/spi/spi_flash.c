@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <boot_device.h>
 #include <cbfs.h>
+#include <console/console.h>
 #include <cpu/x86/smm.h>
 #include <delay.h>
 #include <rules.h>
@@ -70,8 +71,8 @@ int spi_flash_cmd(const struct spi_slave *spi, u8 cmd, void *response, size_t le
 	return ret;
 }
 
-static int spi_flash_cmd_read(const struct spi_slave *spi, const u8 *cmd,
-			      size_t cmd_len, void *data, size_t data_len)
+int spi_flash_cmd_read(const struct spi_slave *spi, const u8 *cmd,
+		       size_t cmd_len, void *data, size_t data_len)
 {
 	int ret = do_spi_flash_cmd(spi, cmd, cmd_len, data, data_len);
 	if (ret) {
@@ -141,10 +142,12 @@ int spi_flash_cmd_poll_bit(const struct spi_flash *flash, unsigned long timeout,
 	const struct spi_slave *spi = &flash->spi;
 	int ret;
 	u8 status;
-	struct mono_time current, end;
+	long delay;
+	struct mono_time start, current, end;
 
-	timer_monotonic_get(&current);
-	end = current;
+	timer_monotonic_get(&start);
+	current = start;
+	end = start;
 	mono_time_add_msecs(&end, timeout);
 
 	do {
@@ -153,6 +156,17 @@ int spi_flash_cmd_poll_bit(const struct spi_flash *flash, unsigned long timeout,
 			return -1;
 		if ((status & poll_bit) == 0)
 			return 0;
+
+		/*
+		 * Back off in proportion to the time waited so far: a page
+		 * program is still seen done within a few percent of its
+		 * time, while a block erase doesn't keep the bus busy with
+		 * thousands of status reads.
+		 */
+		delay = mono_time_diff_microseconds(&start, &current) /
+			SPI_FLASH_POLL_BACKOFF;
+		if (delay > 0)
+			udelay(delay);
 		timer_monotonic_get(&current);
 	} while (!mono_time_after(&current, &end));
 
@@ -167,10 +181,61 @@ int spi_flash_cmd_wait_ready(const struct spi_flash *flash,
 		CMD_READ_STATUS, STATUS_WIP);
 }
 
+/*
+ * Pick the largest erase command whose size is aligned at offset and fits
+ * below end. The sector erase of the flash always does.
+ */
+static void spi_flash_pick_erase(const struct spi_flash *flash, u32 offset,
+				 u32 end, u8 *opcode, u32 *size)
+{
+	const struct spi_flash_erase_type *type;
+	u32 type_size;
+	int i;
+
+	*opcode = flash->erase_cmd;
+	*size = flash->sector_size;
+
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++) {
+		type = &flash->erase_types[i];
+		if (!type->size_shift || type->size_shift > 31)
+			continue;
+
+		type_size = 1U << type->size_shift;
+		if (type_size <= *size || offset % type_size ||
+		    end - offset < type_size)
+			continue;
+
+		*opcode = type->opcode;
+		*size = type_size;
+	}
+}
+
+/* Check if the range reads as erased, stopping at the first other byte. */
+static int spi_flash_is_erased(const struct spi_flash *flash, u32 offset,
+			       size_t len)
+{
+	u8 buf[SPI_FLASH_ERASED_CHECK_CHUNK];
+	size_t chunk, i;
+
+	while (len) {
+		chunk = min(len, sizeof(buf));
+		if (spi_flash_read(flash, offset, chunk, buf))
+			return 0;
+		for (i = 0; i < chunk; i++)
+			if (buf[i] != 0xff)
+				return 0;
+		offset += chunk;
+		len -= chunk;
+	}
+
+	return 1;
+}
+
 int spi_flash_cmd_erase(const struct spi_flash *flash, u32 offset, size_t len)
 {
 	u32 start, end, erase_size;
-	int ret;
+	size_t skipped = 0;
+	int ret = 0;
 	u8 cmd[4];
 
 	erase_size = flash->sector_size;
@@ -179,11 +244,19 @@ int spi_flash_cmd_erase(const struct spi_flash *flash, u32 offset, size_t len)
 		return -1;
 	}
 
-	cmd[0] = flash->erase_cmd;
 	start = offset;
 	end = start + len;
 
 	while (offset < end) {
+		spi_flash_pick_erase(flash, offset, end, &cmd[0], &erase_size);
+
+		/* Reading is much faster than erasing, and doesn't wear. */
+		if (spi_flash_is_erased(flash, offset, erase_size)) {
+			offset += erase_size;
+			skipped += erase_size;
+			continue;
+		}
+
 		spi_flash_addr(offset, cmd);
 		offset += erase_size;
 
@@ -199,12 +272,14 @@ int spi_flash_cmd_erase(const struct spi_flash *flash, u32 offset, size_t len)
 		if (ret)
 			goto out;
 
-		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PAGE_ERASE_TIMEOUT);
+		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PAGE_ERASE_TIMEOUT *
+					       (erase_size / flash->sector_size));
 		if (ret)
 			goto out;
 	}
 
-	printk(BIOS_DEBUG, "SF: Successfully erased %zu bytes @ %#x\n", len, start);
+	printk(BIOS_DEBUG, "SF: Successfully erased %zu bytes @ %#x, %zu bytes "
+	       "were erased already\n", len, start, skipped);
 
 out:
 	return ret;
@@ -215,6 +290,40 @@ int spi_flash_cmd_status(const struct spi_flash *flash, u8 *reg)
 	return spi_flash_cmd(&flash->spi, flash->status_cmd, reg, sizeof(*reg));
 }
 
+int spi_flash_cmd_write_page_program(const struct spi_flash *flash, u32 offset,
+				     size_t len, const void *buf)
+{
+	size_t actual, chunk_len;
+	u8 cmd[4];
+	int ret;
+
+	for (actual = 0; actual < len; actual += chunk_len) {
+		chunk_len = min(len - actual,
+				flash->page_size - offset % flash->page_size);
+		chunk_len = spi_crop_chunk(&flash->spi, sizeof(cmd), chunk_len);
+
+		cmd[0] = CMD_PAGE_PROGRAM;
+		spi_flash_addr(offset, cmd);
+
+		ret = spi_flash_cmd(&flash->spi, CMD_WRITE_ENABLE, NULL, 0);
+		if (ret)
+			return ret;
+
+		ret = spi_flash_cmd_write(&flash->spi, cmd, sizeof(cmd),
+					  (const u8 *)buf + actual, chunk_len);
+		if (ret)
+			return ret;
+
+		ret = spi_flash_cmd_wait_ready(flash, SPI_FLASH_PROG_TIMEOUT);
+		if (ret)
+			return ret;
+
+		offset += chunk_len;
+	}
+
+	return 0;
+}
+
 /*
  * The following table holds all device probe functions
  *
@@ -312,10 +421,17 @@ int spi_flash_generic_probe(const struct spi_slave *spi,
 	for (i = 0; i < ARRAY_SIZE(flashes); ++i)
 		if (flashes[i].shift == shift && flashes[i].idcode == *idp) {
 			/* we have a match, call probe */
-			if (flashes[i].probe(spi, idp, flash) == 0)
+			if (flashes[i].probe(spi, idp, flash) == 0) {
+				if (IS_ENABLED(CONFIG_SPI_FLASH_SFDP))
+					spi_flash_sfdp_setup(spi, flash);
 				return 0;
+			}
 		}
 
+	/* No match, see if the part describes itself. */
+	if (IS_ENABLED(CONFIG_SPI_FLASH_SFDP))
+		return spi_flash_probe_sfdp(spi, idp, flash);
+
 	/* No match, return error. */
 	return -1;
 }
@@ -325,6 +441,8 @@ int spi_flash_probe(unsigned int bus, unsigned int cs, struct spi_flash *flash)
 	struct spi_slave spi;
 	int ret = -1;
 
+	memset(flash, 0, sizeof(*flash));
+
 	if (spi_setup_slave(bus, cs, &spi)) {
 		printk(BIOS_WARNING, "SF: Failed to set up slave\n");
 		return -1;
@@ -352,6 +470,9 @@ int spi_flash_probe(unsigned int bus, unsigned int cs, struct spi_flash *flash)
 int spi_flash_read(const struct spi_flash *flash, u32 offset, size_t len,
 		void *buf)
 {
+	if (IS_ENABLED(CONFIG_SPI_FLASH_SFDP) && flash->read_cmd.opcode)
+		return spi_flash_sfdp_read(flash, offset, len, buf);
+
 	return flash->ops->read(flash, offset, len, buf);
 }
 
@@ -16,6 +16,12 @@
 #define SPI_FLASH_PAGE_ERASE_TIMEOUT	(5 * CONFIG_SYS_HZ)
 #define SPI_FLASH_SECTOR_ERASE_TIMEOUT	(10 * CONFIG_SYS_HZ)
 
+/* Status polls wait 1/SPI_FLASH_POLL_BACKOFF of the time waited so far. */
+#define SPI_FLASH_POLL_BACKOFF		16
+
+/* Bytes read at a time when checking if a block needs to be erased */
+#define SPI_FLASH_ERASED_CHECK_CHUNK	256
+
 /* Common commands */
 #define CMD_READ_ID			0x9f
 
@@ -25,6 +31,7 @@
 
 #define CMD_READ_STATUS			0x05
 #define CMD_WRITE_ENABLE		0x06
+#define CMD_PAGE_PROGRAM		0x02
 
 #define CMD_BLOCK_ERASE			0xD8
 
@@ -40,6 +47,10 @@ int spi_flash_cmd_read_fast(const struct spi_flash *flash, u32 offset,
 int spi_flash_cmd_read_slow(const struct spi_flash *flash, u32 offset,
 		size_t len, void *data);
 
+/* Send a multi-byte command to the device and read the response */
+int spi_flash_cmd_read(const struct spi_slave *spi, const u8 *cmd,
+		       size_t cmd_len, void *data, size_t data_len);
+
 /*
  * Send a multi-byte command to the device followed by (optional)
  * data. Used for programming the flash array, etc.
@@ -57,12 +68,50 @@ int spi_flash_cmd_poll_bit(const struct spi_flash *flash, unsigned long timeout,
  */
 int spi_flash_cmd_wait_ready(const struct spi_flash *flash, unsigned long timeout);
 
-/* Erase sectors. */
+/*
+ * Erase sectors, using the larger erase types of the flash where the range
+ * allows and skipping blocks that are erased already.
+ */
 int spi_flash_cmd_erase(const struct spi_flash *flash, u32 offset, size_t len);
 
 /* Read status register. */
 int spi_flash_cmd_status(const struct spi_flash *flash, u8 *reg);
 
+/* Program pages with CMD_PAGE_PROGRAM, in chunks of up to flash->page_size. */
+int spi_flash_cmd_write_page_program(const struct spi_flash *flash, u32 offset,
+				     size_t len, const void *buf);
+
+/* Serial Flash Discoverable Parameters, see sfdp.c */
+#define SFDP_ADDR_3B	(1 << 0)
+#define SFDP_ADDR_4B	(1 << 1)
+
+struct spi_flash_sfdp {
+	u32 size;
+	u32 page_size;
+	u8 addr_modes;		/* SFDP_ADDR_* */
+	u32 read_modes;		/* SPI_FLASH_IO_MODE() of read_cmds */
+	struct spi_flash_read_cmd read_cmds[SPI_FLASH_IO_MODES];
+	/* From the 4-byte address instruction table, 0 if not supported */
+	u8 read_opcodes_4b[SPI_FLASH_IO_MODES];
+	struct spi_flash_erase_type erase_types[SPI_FLASH_ERASE_TYPES];
+};
+
+/* Read and decode the SFDP tables of the device. */
+int spi_flash_sfdp_parse(const struct spi_slave *spi,
+			 struct spi_flash_sfdp *sfdp);
+
+/*
+ * Set the read command and the erase types of an already probed flash from
+ * its SFDP tables, taking the read modes of the controller into account.
+ */
+void spi_flash_sfdp_apply(struct spi_flash *flash,
+			  const struct spi_flash_sfdp *sfdp);
+void spi_flash_sfdp_setup(const struct spi_slave *spi, struct spi_flash *flash);
+
+/* Read using flash->read_cmd. */
+int spi_flash_sfdp_read(const struct spi_flash *flash, u32 offset, size_t len,
+			void *buf);
+
 /* Manufacturer-specific probe functions */
 int spi_flash_probe_spansion(const struct spi_slave *spi, u8 *idcode,
 			     struct spi_flash *flash);
@@ -85,4 +134,8 @@ int spi_flash_probe_gigadevice(const struct spi_slave *spi, u8 *idcode,
 int spi_flash_probe_adesto(const struct spi_slave *spi, u8 *idcode,
 			   struct spi_flash *flash);
 
+/* Probe for any part with SFDP, as the last resort */
+int spi_flash_probe_sfdp(const struct spi_slave *spi, u8 *idcode,
+			 struct spi_flash *flash);
+
 #endif /* SPI_FLASH_INTERNAL_H */
@@ -5,6 +5,7 @@
  */
 
 #include <console/console.h>
+#include <lib.h>
 #include <stdlib.h>
 #include <spi_flash.h>
 #include <spi-generic.h>
@@ -221,6 +222,9 @@ int spi_flash_probe_winbond(const struct spi_slave *spi, u8 *idcode,
 	flash->size = flash->sector_size * params->sectors_per_block *
 			params->nr_blocks;
 	flash->erase_cmd = CMD_W25_SE;
+	flash->erase_types[0].opcode = CMD_W25_BE;
+	flash->erase_types[0].size_shift =
+		log2(flash->sector_size * params->sectors_per_block);
 	flash->status_cmd = CMD_W25_RDSR;
 
 	flash->ops = &spi_flash_ops;
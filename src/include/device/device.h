@@ -104,6 +104,12 @@ struct bus {
  * combination:
  */
 
+struct device_index_link {
+	struct device *next;
+	struct device *prev;
+	int bucket;
+};
+
 struct pci_irq_info {
 	unsigned int	ioapic_irq_pin;
 	unsigned int	ioapic_src_pin;
@@ -144,6 +150,11 @@ struct device {
 #if !DEVTREE_EARLY
 	struct chip_operations *chip_ops;
 	const char *name;
+
+	/* Lookup index, maintained by device_util.c */
+	struct device_index_link path_link;
+	struct device_index_link id_link;
+	unsigned int list_pos;		/* position in all_devices */
 #endif
 	DEVTREE_CONST void *chip_info;
 };
@@ -204,6 +215,8 @@ device_t dev_find_slot(unsigned int bus, unsigned int devfn);
 device_t dev_find_slot_on_smbus(unsigned int bus, unsigned int addr);
 device_t dev_find_slot_pnp(u16 port, u16 device);
 device_t dev_find_lapic(unsigned int apic_id);
+void dev_index_add(struct device *dev);
+void dev_index_update(struct device *dev);
 int dev_count_cpu(void);
 
 device_t add_cpu_device(struct bus *cpu_bus, unsigned int apic_id, int enabled);
@@ -272,6 +285,20 @@ u32 find_pci_tolm(struct bus *bus);
 
 #else /* vv __SIMPLE_DEVICE__ vv */
 
+/*
+ * Static lookup tables generated by sconfig, sorted by key. The PCI table
+ * is keyed by devfn, the PnP table by (port << 16 | device).
+ */
+struct device_index_entry {
+	u32 key;
+	DEVTREE_CONST struct device *dev;
+};
+
+extern const struct device_index_entry dev_index_pci[];
+extern const size_t dev_index_pci_count;
+extern const struct device_index_entry dev_index_pnp[];
+extern const size_t dev_index_pnp_count;
+
 DEVTREE_CONST struct device *dev_find_slot(unsigned int bus,
 						unsigned int devfn);
 DEVTREE_CONST struct device *dev_find_next_pci_device(
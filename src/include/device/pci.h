@@ -87,6 +87,29 @@ void pci_scan_bridge(struct device *bus);
 void pci_scan_bus(struct bus *bus, unsigned int min_devfn,
 	unsigned int max_devfn);
 
+#if IS_ENABLED(CONFIG_PCI_TOPOLOGY_CACHE)
+/*
+ * Return the bitmap of functions present on the bus on the last boot, after
+ * checking that they are still the same devices, or NULL if the bus has to
+ * be scanned in full.
+ */
+const uint32_t *pci_topology_lookup(struct bus *bus, unsigned int min_devfn,
+				    unsigned int max_devfn);
+/* Record the functions found by pci_scan_bus() for the next boot. */
+void pci_topology_record(struct bus *bus, unsigned int min_devfn,
+			 unsigned int max_devfn);
+/* Board specific input to the fingerprint of the cached topology. */
+uint32_t pci_topology_board_fingerprint(void);
+#else
+static inline const uint32_t *pci_topology_lookup(struct bus *bus,
+			unsigned int min_devfn, unsigned int max_devfn)
+{
+	return NULL;
+}
+static inline void pci_topology_record(struct bus *bus,
+			unsigned int min_devfn, unsigned int max_devfn) {}
+#endif
+
 uint8_t pci_moving_config8(struct device *dev, unsigned int reg);
 uint16_t pci_moving_config16(struct device *dev, unsigned int reg);
 uint32_t pci_moving_config32(struct device *dev, unsigned int reg);
@@ -23,6 +23,12 @@
 /* Defined in src/lib/lzma.c. Returns decompressed size or 0 on error. */
 size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn);
 
+/* Same as ulzman() but with caller provided decoder state, so that it can be
+ * run on several CPUs at once. */
+#define LZMA_SCRATCHPAD_SIZE 15980
+size_t ulzman_scratchpad(const void *src, size_t srcn, void *dst, size_t dstn,
+			 void *scratchpad, size_t scratchpad_size);
+
 /* Defined in src/lib/ramtest.c */
 void ram_check(unsigned long start, unsigned long stop);
 int ram_check_nodie(unsigned long start, unsigned long stop);
@@ -24,6 +24,11 @@ struct memranges {
 	/* coreboot doesn't have a free() function. Therefore, keep a cache of
 	 * free'd entries.  */
 	struct range_entry *free_list;
+	/* Index of the entries, see memrange.c. */
+	struct range_entry *root;
+	unsigned int seed;
+	/* Alignment (log 2) of the begin and end of the ranges. */
+	unsigned char align;
 };
 
 /* Each region within a memranges structure is represented by a
@@ -35,6 +40,10 @@ struct range_entry {
 	resource_t end;
 	unsigned long tag;
 	struct range_entry *next;
+	/* Index of the entries, see memrange.c. */
+	struct range_entry *left;
+	struct range_entry *right;
+	unsigned int prio;
 };
 
 /* Initialize a range_entry with inclusive beginning address and exclusive
@@ -47,6 +56,8 @@ static inline void range_entry_init(struct range_entry *re,
 	re->end = excl_end - 1;
 	re->tag = tag;
 	re->next = NULL;
+	re->left = NULL;
+	re->right = NULL;
 }
 
 /* Return inclusive base address of memory range. */
@@ -87,10 +98,16 @@ static inline void range_entry_update_tag(struct range_entry *r,
 	for (r = (ranges)->entries; r != NULL; r = r->next)
 
 /* Initialize memranges structure providing an optional array of range_entry
- * to use as the free list. */
+ * to use as the free list. The ranges are aligned to 4KiB. */
 void memranges_init_empty(struct memranges *ranges, struct range_entry *free,
 			  size_t num_free);
 
+/* Same as memranges_init_empty(), but aligning the ranges to 2^align bytes
+ * instead, e.g. 0 for I/O ports. */
+void memranges_init_empty_with_alignment(struct memranges *ranges,
+					 struct range_entry *free,
+					 size_t num_free, unsigned char align);
+
 /* Initialize and fill a memranges structure according to the
  * mask and match type for all memory resources. Tag each entry with the
  * specified type. */
@@ -95,6 +95,7 @@ struct spi_cfg {
 #define SPI_CTRLR_DEFAULT_MAX_XFER_SIZE	(UINT32_MAX)
 
 struct spi_flash;
+struct spi_flash_read_cmd;
 
 /*-----------------------------------------------------------------------
  * Representation of a SPI controller.
@@ -115,6 +116,11 @@ struct spi_flash;
  *
  * flash_probe:	Specialized probe function provided by SPI flash
  *			controllers.
+ * Following members are provided by controllers that can read the flash
+ * array using more than one data line:
+ * flash_read_modes:	Mask of SPI_FLASH_IO_MODE() supported by flash_read.
+ * flash_read:		Send the read command with the offset, clock the
+ *			dummy cycles and read len bytes into buf.
  */
 struct spi_ctrlr {
 	int (*claim_bus)(const struct spi_slave *slave);
@@ -128,6 +134,10 @@ struct spi_ctrlr {
 	bool deduct_cmd_len;
 	int (*flash_probe)(const struct spi_slave *slave,
 				struct spi_flash *flash);
+	uint32_t flash_read_modes;
+	int (*flash_read)(const struct spi_slave *slave,
+			const struct spi_flash_read_cmd *cmd, uint32_t offset,
+			size_t len, void *buf);
 };
 
 /*-----------------------------------------------------------------------
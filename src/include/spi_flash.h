@@ -26,6 +26,44 @@
 
 struct spi_flash;
 
+/*
+ * Line usage of the read commands: number of I/O lines used for the opcode,
+ * the address and the data.
+ */
+enum spi_flash_io_mode {
+	SPI_FLASH_IO_1_1_1,
+	SPI_FLASH_IO_1_1_2,
+	SPI_FLASH_IO_1_2_2,
+	SPI_FLASH_IO_1_1_4,
+	SPI_FLASH_IO_1_4_4,
+	SPI_FLASH_IO_MODES
+};
+
+#define SPI_FLASH_IO_MODE(mode)	(1 << (mode))
+
+/*
+ * Read command of a flash:
+ * opcode:	Opcode of the command.
+ * io_mode:	One of enum spi_flash_io_mode.
+ * addr_len:	3 or 4 address bytes.
+ * dummy_cycles: Clocks between the address and the data, including the
+ *		mode bits. They are driven as 0, i.e. without continuous read.
+ */
+struct spi_flash_read_cmd {
+	u8 opcode;
+	u8 io_mode;
+	u8 addr_len;
+	u8 dummy_cycles;
+};
+
+/* Erase command of a flash, for 1 << size_shift bytes. */
+struct spi_flash_erase_type {
+	u8 opcode;
+	u8 size_shift;
+};
+
+#define SPI_FLASH_ERASE_TYPES	4
+
 /*
  * Representation of SPI flash operations:
  * read:	Flash read operation.
@@ -51,6 +89,13 @@ struct spi_flash {
 	u8 erase_cmd;
 	u8 status_cmd;
 	const struct spi_flash_ops *ops;
+	/*
+	 * Found through SFDP, see sfdp.c. The read command is used by
+	 * spi_flash_read() if its opcode isn't 0, erase types with a
+	 * size_shift of 0 are unused.
+	 */
+	struct spi_flash_read_cmd read_cmd;
+	struct spi_flash_erase_type erase_types[SPI_FLASH_ERASE_TYPES];
 };
 
 void lb_spi_flash(struct lb_header *header);
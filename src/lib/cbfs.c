@@ -25,6 +25,7 @@
 #include <symbols.h>
 #include <timestamp.h>
 #include <fmap.h>
+#include <security/vboot/body_cache.h>
 #include "fmap_config.h"
 
 #define ERROR(x...) printk(BIOS_ERR, "CBFS: " x)
@@ -44,6 +45,10 @@ int cbfs_boot_locate(struct cbfsf *fh, const char *name, uint32_t *type)
 	if (cbfs_boot_region_properties(&props))
 		return -1;
 
+	/* Use the copy of the region vboot verified and kept in memory. */
+	if (!vboot_body_cache_rdev(&props, &rdev))
+		return cbfs_locate(fh, &rdev, name, type);
+
 	/* All boot CBFS operations are performed using the RO devie. */
 	boot_dev = boot_device_ro();
 
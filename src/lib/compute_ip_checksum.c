@@ -1,34 +1,130 @@
 #include <stdint.h>
 #include <ip_checksum.h>
 
-unsigned long compute_ip_checksum(const void *addr, unsigned long length)
+/*
+ * The checksum is the one's complement of the one's complement sum of the
+ * buffer as native endian 16-bit words, with an odd trailing byte padded
+ * with zero. Since 2^16 == 1 (mod 0xffff), wider words can be summed into
+ * a 64-bit accumulator and the carries folded back in once at the end.
+ * The sum is also independent of byte order except for a byte swap, which
+ * is used to handle buffers starting at an odd address.
+ */
+
+typedef uint16_t __attribute__((may_alias)) alias_u16;
+typedef uint32_t __attribute__((may_alias)) alias_u32;
+
+/* Sum of a single byte at position 'pos' (0 or 1) within a 16-bit word. */
+static unsigned long byte_word(uint8_t byte, int pos)
 {
-	const uint8_t *ptr;
-	volatile union {
+	union {
 		uint8_t  byte[2];
 		uint16_t word;
 	} value;
-	unsigned long sum;
-	unsigned long i;
-	/* In the most straight forward way possible,
-	 * compute an ip style checksum.
+
+	value.byte[pos] = byte;
+	value.byte[pos ^ 1] = 0;
+	return value.word;
+}
+
+#if IS_ENABLED(CONFIG_SSE2)
+typedef int v4si __attribute__((vector_size(16)));
+
+/*
+ * Sum 16-byte blocks at 16-byte aligned 'p'. The low and high words of each
+ * 32-bit lane are added separately into 32-bit lanes, which are flushed to
+ * the 64-bit sum before they can overflow.
+ */
+__attribute__((target("sse2")))
+static uint64_t sum_blocks_sse2(const uint8_t *p, unsigned long blocks)
+{
+	const v4si low_mask = { 0xffff, 0xffff, 0xffff, 0xffff };
+	uint64_t sum = 0;
+
+	while (blocks) {
+		unsigned long n = blocks < 0x8000 ? blocks : 0x8000;
+		v4si acc = { 0 };
+
+		blocks -= n;
+		while (n--) {
+			v4si v = *(const v4si *)p;
+
+			acc += v & low_mask;
+			acc += __builtin_ia32_psrldi128(v, 16);
+			p += 16;
+		}
+		sum += (uint32_t)acc[0] + (uint64_t)(uint32_t)acc[1] +
+			(uint32_t)acc[2] + (uint32_t)acc[3];
+	}
+
+	return sum;
+}
+#endif
+
+unsigned long compute_ip_checksum(const void *addr, unsigned long length)
+{
+	const uint8_t *ptr = addr;
+	uint64_t sum = 0;
+	int swap = 0;
+
+	/*
+	 * Starting at an odd address, the first byte is the low one of its
+	 * word and every following word is shifted by one byte. Sum the rest
+	 * aligned, with the first byte in the high position, and swap the
+	 * bytes of the result.
 	 */
-	sum = 0;
-	ptr = addr;
-	for (i = 0; i < length; i++) {
-		unsigned long v;
-		v = ptr[i];
-		if (i & 1)
-			v <<= 8;
-		/* Add the new value */
-		sum += v;
-		/* Wrap around the carry */
-		if (sum > 0xFFFF)
-			sum = (sum + (sum >> 16)) & 0xFFFF;
-	}
-	value.byte[0] = sum & 0xff;
-	value.byte[1] = (sum >> 8) & 0xff;
-	return (~value.word) & 0xFFFF;
+	if (length && ((uintptr_t)ptr & 1)) {
+		sum = byte_word(*ptr, 1);
+		ptr++;
+		length--;
+		swap = 1;
+	}
+
+	if (length >= 2 && ((uintptr_t)ptr & 2)) {
+		sum += *(const alias_u16 *)ptr;
+		ptr += 2;
+		length -= 2;
+	}
+
+#if IS_ENABLED(CONFIG_SSE2)
+	while (length >= 4 && ((uintptr_t)ptr & 15)) {
+		sum += *(const alias_u32 *)ptr;
+		ptr += 4;
+		length -= 4;
+	}
+	if (length >= 16) {
+		sum += sum_blocks_sse2(ptr, length / 16);
+		ptr += length & ~15UL;
+		length &= 15;
+	}
+#endif
+
+	while (length >= 16) {
+		const alias_u32 *p = (const alias_u32 *)ptr;
+
+		sum += (uint64_t)p[0] + p[1] + p[2] + p[3];
+		ptr += 16;
+		length -= 16;
+	}
+	while (length >= 4) {
+		sum += *(const alias_u32 *)ptr;
+		ptr += 4;
+		length -= 4;
+	}
+	if (length >= 2) {
+		sum += *(const alias_u16 *)ptr;
+		ptr += 2;
+		length -= 2;
+	}
+	if (length)
+		sum += byte_word(*ptr, 0);
+
+	/* Wrap around the carries */
+	while (sum > 0xFFFF)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	if (swap)
+		sum = ((sum >> 8) | (sum << 8)) & 0xFFFF;
+
+	return (~sum) & 0xFFFF;
 }
 
 unsigned long add_ip_checksums(unsigned long offset, unsigned long sum,
@@ -100,6 +100,9 @@ static void initcol __P((PREC[][64]));
 static void col221111 __P((int *, unsigned char *, int));
 static void col221111_16 __P((int *, unsigned char *, int));
 static void col221111_32 __P((int *, unsigned char *, int));
+static void col111111 __P((int *, unsigned char *, int));
+static void col111111_16 __P((int *, unsigned char *, int));
+static void col111111_32 __P((int *, unsigned char *, int));
 
 /*********************************/
 
@@ -284,7 +287,9 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 {
 	int i, j, m, tac, tdc;
 	int mcusx, mcusy, mx, my;
+	int imgw, imgh, mcuw, mcuh, nblocks, bpp;
 	int max[6];
+	void (*col)(int *, unsigned char *, int);
 
 	if (!decdata || !buf || !pic)
 		return -1;
@@ -299,9 +304,11 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 	i = getbyte();
 	if (i != 8)
 		return ERR_NOT_8BIT;
-	if (((getword() + 15) & ~15) != height)
+	imgh = getword();
+	if (((imgh + 15) & ~15) != height)
 		return ERR_HEIGHT_MISMATCH;
-	if (((getword() + 15) & ~15) != width)
+	imgw = getword();
+	if (((imgw + 15) & ~15) != width)
 		return ERR_WIDTH_MISMATCH;
 	if ((height & 15) || (width & 15))
 		return ERR_BAD_WIDTH_OR_HEIGHT;
@@ -354,12 +361,43 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 	if (dscans[0].cid != 1 || dscans[1].cid != 2 || dscans[2].cid != 3)
 		return ERR_NOT_YCBCR_221111;
 
-	if (dscans[0].hv != 0x22 || dscans[1].hv != 0x11
-		|| dscans[2].hv != 0x11)
+	if (dscans[1].hv != 0x11 || dscans[2].hv != 0x11)
 		return ERR_NOT_YCBCR_221111;
 
-	mcusx = width >> 4;
-	mcusy = height >> 4;
+	/*
+	 * Supported are 4:2:0 (2x2 luma blocks per chroma block, a 16x16
+	 * MCU) and 4:4:4 (one block per component, an 8x8 MCU).
+	 */
+	switch (dscans[0].hv) {
+	case 0x22:
+		mcuw = mcuh = 16;
+		nblocks = 6;
+		break;
+	case 0x11:
+		mcuw = mcuh = 8;
+		nblocks = 3;
+		break;
+	default:
+		return ERR_NOT_YCBCR_221111;
+	}
+
+	switch (depth) {
+	case 32:
+		col = nblocks == 6 ? col221111_32 : col111111_32;
+		break;
+	case 24:
+		col = nblocks == 6 ? col221111 : col111111;
+		break;
+	case 16:
+		col = nblocks == 6 ? col221111_16 : col111111_16;
+		break;
+	default:
+		return ERR_DEPTH_MISMATCH;
+	}
+	bpp = depth / 8;
+
+	mcusx = (imgw + mcuw - 1) / mcuw;
+	mcusy = (imgh + mcuh - 1) / mcuh;
 
 
 	idctqtab(quant[dscans[0].tq], decdata->dquant[0]);
@@ -377,48 +415,31 @@ int jpeg_decode(unsigned char *buf, unsigned char *pic,
 
 	dec_initscans();
 
-	dscans[0].next = 6 - 4;
-	dscans[1].next = 6 - 4 - 1;
-	dscans[2].next = 6 - 4 - 1 - 1;	/* 411 encoding */
+	/* when to switch to the next scan, counted down from nblocks */
+	dscans[0].next = 2;
+	dscans[1].next = 1;
+	dscans[2].next = 0;
 	for (my = 0; my < mcusy; my++) {
 		for (mx = 0; mx < mcusx; mx++) {
 			if (info.dri && !--info.nm)
 				if (dec_checkmarker())
 					return ERR_WRONG_MARKER;
 
-			decode_mcus(&glob_in, decdata->dcts, 6, dscans, max);
-			idct(decdata->dcts, decdata->out, decdata->dquant[0],
-				IFIX(128.5), max[0]);
-			idct(decdata->dcts + 64, decdata->out + 64,
-				decdata->dquant[0], IFIX(128.5), max[1]);
-			idct(decdata->dcts + 128, decdata->out + 128,
-				decdata->dquant[0], IFIX(128.5), max[2]);
-			idct(decdata->dcts + 192, decdata->out + 192,
-				decdata->dquant[0], IFIX(128.5), max[3]);
-			idct(decdata->dcts + 256, decdata->out + 256,
-				decdata->dquant[1], IFIX(0.5), max[4]);
-			idct(decdata->dcts + 320, decdata->out + 320,
-				decdata->dquant[2], IFIX(0.5), max[5]);
-
-			switch (depth) {
-			case 32:
-				col221111_32(decdata->out, pic
-					+ (my * 16 * mcusx + mx) * 16 * 4,
-					mcusx * 16 * 4);
-				break;
-			case 24:
-				col221111(decdata->out, pic
-					+ (my * 16 * mcusx + mx) * 16 * 3,
-					mcusx * 16 * 3);
-				break;
-			case 16:
-				col221111_16(decdata->out, pic
-					+ (my * 16 * mcusx + mx) * (16 * 2),
-					mcusx * (16 * 2));
-				break;
-			default:
-				return ERR_DEPTH_MISMATCH;
-			}
+			decode_mcus(&glob_in, decdata->dcts, nblocks, dscans,
+				max);
+			for (i = 0; i < nblocks - 2; i++)
+				idct(decdata->dcts + i * 64,
+					decdata->out + i * 64,
+					decdata->dquant[0], IFIX(128.5),
+					max[i]);
+			idct(decdata->dcts + i * 64, decdata->out + i * 64,
+				decdata->dquant[1], IFIX(0.5), max[i]);
+			i++;
+			idct(decdata->dcts + i * 64, decdata->out + i * 64,
+				decdata->dquant[2], IFIX(0.5), max[i]);
+
+			col(decdata->out, pic + (my * mcuh * width + mx * mcuw)
+				* bpp, width * bpp);
 		}
 	}
 
@@ -733,7 +754,14 @@ void idct(int *in, int *out, PREC *lquant, PREC off, int max)
 		t3 = in[j] * lquant[j];
 		j = *zig2p++;
 		t6 = in[j] * lquant[j];
-		IDCT;
+		/*
+		 * Most columns have no AC coefficients left after quantization.
+		 * Then all outputs equal the DC input, skip the butterflies.
+		 */
+		if ((t1 | t2 | t3 | t4 | t5 | t6 | t7) == 0)
+			t1 = t2 = t3 = t4 = t5 = t6 = t7 = t0;
+		else
+			IDCT;
 		tmpp[0 * 8] = t0;
 		tmpp[1 * 8] = t1;
 		tmpp[2 * 8] = t2;
@@ -946,6 +974,106 @@ static void initcol(PREC q[][64])
 	PIC_32(xin / 4 * 8 + 1, (xin & 3) * 2 + 1, pic1, xin * 2 + 1)	\
 )
 
+#if IS_ENABLED(CONFIG_SSE2)
+/*
+ * SSE2 versions of PIC_16 and PIC_32 for 8 pixels of one row. 'outc' points to
+ * the Cb samples, the Cr samples follow 64 entries later. With 'sub' set, each
+ * chroma sample covers two horizontally adjacent pixels (4 samples are used),
+ * otherwise there's one sample per pixel.
+ *
+ * These give the same results as the scalar code: the saturating packs clamp
+ * exactly like CLAMP() does. The 16 bpp one stores the little endian RGB565
+ * layout, which is the only one an SSE2 capable CPU uses.
+ */
+typedef int v4si __attribute__((vector_size(16)));
+typedef int v4si_u __attribute__((vector_size(16), aligned(1)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef short v8hi_u __attribute__((vector_size(16), aligned(1)));
+typedef unsigned short v8hu __attribute__((vector_size(16)));
+typedef char v16qi __attribute__((vector_size(16)));
+
+/* Y + Cr, Y - Cg and Y + Cb of 8 pixels, not clamped yet */
+__attribute__((target("sse2")))
+static inline void rgb8_sse2(const int *outy, const int *outc, int sub,
+			     v8hi *r, v8hi *g, v8hi *b)
+{
+	const v4si c128 = { 128, 128, 128, 128 };
+	v4si y0 = *(const v4si_u *)(outy + 0);
+	v4si y1 = *(const v4si_u *)(outy + 4);
+	v4si cb0, cb1, cr0, cr1, cg0, cg1;
+
+	if (sub) {
+		const v4si cb = *(const v4si_u *)(outc + 0);
+		const v4si cr = *(const v4si_u *)(outc + 64);
+		const v4si lo = { 0, 0, 1, 1 }, hi = { 2, 2, 3, 3 };
+		cb0 = __builtin_shuffle(cb, lo);
+		cb1 = __builtin_shuffle(cb, hi);
+		cr0 = __builtin_shuffle(cr, lo);
+		cr1 = __builtin_shuffle(cr, hi);
+	} else {
+		cb0 = *(const v4si_u *)(outc + 0);
+		cb1 = *(const v4si_u *)(outc + 4);
+		cr0 = *(const v4si_u *)(outc + 64);
+		cr1 = *(const v4si_u *)(outc + 68);
+	}
+
+	/* cg = (50 * cb + 130 * cr + 128) >> 8, without a 32 bit multiply */
+	cg0 = ((cb0 << 5) + (cb0 << 4) + (cb0 << 1)
+		+ (cr0 << 7) + (cr0 << 1) + c128) >> 8;
+	cg1 = ((cb1 << 5) + (cb1 << 4) + (cb1 << 1)
+		+ (cr1 << 7) + (cr1 << 1) + c128) >> 8;
+
+	*r = __builtin_ia32_packssdw128(y0 + cr0, y1 + cr1);
+	*g = __builtin_ia32_packssdw128(y0 - cg0, y1 - cg1);
+	*b = __builtin_ia32_packssdw128(y0 + cb0, y1 + cb1);
+}
+
+__attribute__((target("sse2")))
+static void pic8_32_sse2(const int *outy, const int *outc, int sub,
+			 unsigned char *p)
+{
+	v8hi r, g, b, rg, bz;
+	v16qi rb, gz, zero = { 0 };
+
+	rgb8_sse2(outy, outc, sub, &r, &g, &b);
+
+	/* R0..R7 B0..B7 and G0..G7 0..0, then interleave to RGB0 */
+	rb = (v16qi)__builtin_ia32_packuswb128(r, b);
+	gz = (v16qi)__builtin_ia32_packuswb128(g, (v8hi)zero);
+	rg = (v8hi)__builtin_ia32_punpcklbw128(rb, gz);
+	bz = (v8hi)__builtin_ia32_punpckhbw128(rb, gz);
+	*(v8hi_u *)(p + 0) = __builtin_ia32_punpcklwd128(rg, bz);
+	*(v8hi_u *)(p + 16) = __builtin_ia32_punpckhwd128(rg, bz);
+}
+
+/* 'even' and 'odd' are the dither adds of the even and odd pixels */
+__attribute__((target("sse2")))
+static void pic8_16_sse2(const int *outy, const int *outc, int sub,
+			 int even, int odd, unsigned char *p)
+{
+	const v8hi add = { even, odd, even, odd, even, odd, even, odd };
+	const v8hi one = { 1, 1, 1, 1, 1, 1, 1, 1 };
+	v8hi r, g, b;
+	v8hu r8, g8, b8;
+	v16qi rb, gz, zero = { 0 };
+
+	rgb8_sse2(outy, outc, sub, &r, &g, &b);
+	r = __builtin_ia32_paddsw128(r, add + add + one);
+	g = __builtin_ia32_paddsw128(g, add);
+	b = __builtin_ia32_paddsw128(b, add + add + one);
+
+	/* Clamp to 0..255 and widen again */
+	rb = (v16qi)__builtin_ia32_packuswb128(r, b);
+	gz = (v16qi)__builtin_ia32_packuswb128(g, (v8hi)zero);
+	r8 = (v8hu)__builtin_ia32_punpcklbw128(rb, zero);
+	b8 = (v8hu)__builtin_ia32_punpckhbw128(rb, zero);
+	g8 = (v8hu)__builtin_ia32_punpcklbw128(gz, zero);
+
+	*(v8hi_u *)p = (v8hi)(((r8 & 0xf8) << 8) | ((g8 & 0xfc) << 3)
+			      | (b8 >> 3));
+}
+#endif
+
 static void col221111(int *out, unsigned char *pic, int width)
 {
 	int i, j, k;
@@ -972,10 +1100,13 @@ static void col221111(int *out, unsigned char *pic, int width)
 
 static void col221111_16(int *out, unsigned char *pic, int width)
 {
-	int i, j, k;
+	int i, j;
 	unsigned char *pic0, *pic1;
 	int *outy, *outc;
+#if !IS_ENABLED(CONFIG_SSE2)
+	int k;
 	int cr, cg, cb, y;
+#endif
 
 	pic0 = pic;
 	pic1 = pic + width;
@@ -983,8 +1114,15 @@ static void col221111_16(int *out, unsigned char *pic, int width)
 	outc = out + 64 * 4;
 	for (i = 2; i > 0; i--) {
 		for (j = 4; j > 0; j--) {
+#if IS_ENABLED(CONFIG_SSE2)
+			pic8_16_sse2(outy, outc, 1, 3, 0, pic0);
+			pic8_16_sse2(outy + 64, outc + 4, 1, 3, 0, pic0 + 16);
+			pic8_16_sse2(outy + 8, outc, 1, 1, 2, pic1);
+			pic8_16_sse2(outy + 72, outc + 4, 1, 1, 2, pic1 + 16);
+#else
 			for (k = 0; k < 8; k++)
 				PIC221111_16(k);
+#endif
 			outc += 8;
 			outy += 16;
 			pic0 += 2 * width;
@@ -996,10 +1134,13 @@ static void col221111_16(int *out, unsigned char *pic, int width)
 
 static void col221111_32(int *out, unsigned char *pic, int width)
 {
-	int i, j, k;
+	int i, j;
 	unsigned char *pic0, *pic1;
 	int *outy, *outc;
+#if !IS_ENABLED(CONFIG_SSE2)
+	int k;
 	int cr, cg, cb, y;
+#endif
 
 	pic0 = pic;
 	pic1 = pic + width;
@@ -1007,8 +1148,15 @@ static void col221111_32(int *out, unsigned char *pic, int width)
 	outc = out + 64 * 4;
 	for (i = 2; i > 0; i--) {
 		for (j = 4; j > 0; j--) {
+#if IS_ENABLED(CONFIG_SSE2)
+			pic8_32_sse2(outy, outc, 1, pic0);
+			pic8_32_sse2(outy + 64, outc + 4, 1, pic0 + 32);
+			pic8_32_sse2(outy + 8, outc, 1, pic1);
+			pic8_32_sse2(outy + 72, outc + 4, 1, pic1 + 32);
+#else
 			for (k = 0; k < 8; k++)
 				PIC221111_32(k);
+#endif
 			outc += 8;
 			outy += 16;
 			pic0 += 2 * width;
@@ -1017,3 +1165,108 @@ static void col221111_32(int *out, unsigned char *pic, int width)
 		outy += 64 * 2 - 16 * 4;
 	}
 }
+
+/* 4:4:4: one chroma sample per pixel, 8x8 pixel MCU */
+
+#define PIC111111(xin)				\
+(						\
+	CBCRCG(0, xin),				\
+	PIC(0, xin, pic0, xin)			\
+)
+
+#define PIC111111_16(xin, add)			\
+(						\
+	CBCRCG(0, xin),				\
+	PIC_16(0, xin, pic0, xin, add)		\
+)
+
+#define PIC111111_32(xin)			\
+(						\
+	CBCRCG(0, xin),				\
+	PIC_32(0, xin, pic0, xin)		\
+)
+
+static void col111111(int *out, unsigned char *pic, int width)
+{
+	int i, k;
+	unsigned char *pic0;
+	int *outy, *outc;
+	int cr, cg, cb, y;
+
+	pic0 = pic;
+	outy = out;
+	outc = out + 64;
+	for (i = 8; i > 0; i--) {
+		for (k = 0; k < 8; k++)
+			PIC111111(k);
+		outy += 8;
+		outc += 8;
+		pic0 += width;
+	}
+}
+
+static void col111111_16(int *out, unsigned char *pic, int width)
+{
+	int i;
+	unsigned char *pic0;
+	int *outy, *outc;
+#if !IS_ENABLED(CONFIG_SSE2)
+	int k;
+	int cr, cg, cb, y;
+#endif
+
+	pic0 = pic;
+	outy = out;
+	outc = out + 64;
+	for (i = 8; i > 0; i -= 2) {
+		/* Same 2x2 ordered dither pattern as col221111_16() */
+#if IS_ENABLED(CONFIG_SSE2)
+		pic8_16_sse2(outy, outc, 0, 3, 0, pic0);
+#else
+		for (k = 0; k < 8; k += 2) {
+			PIC111111_16(k, 3);
+			PIC111111_16(k + 1, 0);
+		}
+#endif
+		outy += 8;
+		outc += 8;
+		pic0 += width;
+#if IS_ENABLED(CONFIG_SSE2)
+		pic8_16_sse2(outy, outc, 0, 1, 2, pic0);
+#else
+		for (k = 0; k < 8; k += 2) {
+			PIC111111_16(k, 1);
+			PIC111111_16(k + 1, 2);
+		}
+#endif
+		outy += 8;
+		outc += 8;
+		pic0 += width;
+	}
+}
+
+static void col111111_32(int *out, unsigned char *pic, int width)
+{
+	int i;
+	unsigned char *pic0;
+	int *outy, *outc;
+#if !IS_ENABLED(CONFIG_SSE2)
+	int k;
+	int cr, cg, cb, y;
+#endif
+
+	pic0 = pic;
+	outy = out;
+	outc = out + 64;
+	for (i = 8; i > 0; i--) {
+#if IS_ENABLED(CONFIG_SSE2)
+		pic8_32_sse2(outy, outc, 0, pic0);
+#else
+		for (k = 0; k < 8; k++)
+			PIC111111_32(k);
+#endif
+		outy += 8;
+		outc += 8;
+		pic0 += width;
+	}
+}
@@ -17,7 +17,8 @@
 
 #include "lzmadecode.h"
 
-size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
+size_t ulzman_scratchpad(const void *src, size_t srcn, void *dst, size_t dstn,
+			 void *scratchpad, size_t scratchpad_size)
 {
 	unsigned char properties[LZMA_PROPERTIES_SIZE];
 	const int data_offset = LZMA_PROPERTIES_SIZE + 8;
@@ -27,7 +28,6 @@ size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
 	int res;
 	CLzmaDecoderState state;
 	SizeT mallocneeds;
-	MAYBE_STATIC unsigned char scratchpad[15980];
 	const unsigned char *cp;
 
 	memcpy(properties, src, LZMA_PROPERTIES_SIZE);
@@ -43,7 +43,7 @@ size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
 		return 0;
 	}
 	mallocneeds = (LzmaGetNumProbs(&state.Properties) * sizeof(CProb));
-	if (mallocneeds > 15980) {
+	if (mallocneeds > scratchpad_size) {
 		printk(BIOS_WARNING, "lzma: Decoder scratchpad too small!\n");
 		return 0;
 	}
@@ -56,3 +56,11 @@ size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
 	}
 	return outProcessed;
 }
+
+size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	MAYBE_STATIC unsigned char scratchpad[LZMA_SCRATCHPAD_SIZE];
+
+	return ulzman_scratchpad(src, srcn, dst, dstn, scratchpad,
+				 sizeof(scratchpad));
+}
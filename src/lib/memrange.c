@@ -13,9 +13,23 @@
  * GNU General Public License for more details.
  */
 #include <stdlib.h>
+#include <commonlib/helpers.h>
 #include <console/console.h>
 #include <memrange.h>
 
+/*
+ * The entries are kept in a list sorted by address, which is what callers
+ * iterate over, and in a treap keyed by the begin address of the entries.
+ * The treap finds the first entry affected by an operation and the entry
+ * preceding it in O(log n), so that building a map from many resources
+ * doesn't walk the whole list for every insert. Since the entries never
+ * overlap, clipping the begin or end of an entry doesn't change its place
+ * in either.
+ */
+
+/* Entries allocated at once when the free list runs out. */
+#define MEMRANGES_POOL_CHUNK	16
+
 static inline void range_entry_link(struct range_entry **prev_ptr,
 				    struct range_entry *r)
 {
@@ -30,16 +44,126 @@ static inline void range_entry_unlink(struct range_entry **prev_ptr,
 	r->next = NULL;
 }
 
+static struct range_entry *tree_rotate_right(struct range_entry *r)
+{
+	struct range_entry *l = r->left;
+
+	r->left = l->right;
+	l->right = r;
+	return l;
+}
+
+static struct range_entry *tree_rotate_left(struct range_entry *r)
+{
+	struct range_entry *n = r->right;
+
+	r->right = n->left;
+	n->left = r;
+	return n;
+}
+
+static struct range_entry *tree_insert(struct range_entry *root,
+				       struct range_entry *r)
+{
+	if (root == NULL)
+		return r;
+
+	if (r->begin < root->begin) {
+		root->left = tree_insert(root->left, r);
+		if (root->left->prio > root->prio)
+			root = tree_rotate_right(root);
+	} else {
+		root->right = tree_insert(root->right, r);
+		if (root->right->prio > root->prio)
+			root = tree_rotate_left(root);
+	}
+	return root;
+}
+
+static struct range_entry *tree_join(struct range_entry *a,
+				     struct range_entry *b)
+{
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (a->prio > b->prio) {
+		a->right = tree_join(a->right, b);
+		return a;
+	}
+	b->left = tree_join(a, b->left);
+	return b;
+}
+
+static struct range_entry *tree_remove(struct range_entry *root,
+				       struct range_entry *r)
+{
+	if (root == r)
+		return tree_join(r->left, r->right);
+
+	if (r->begin < root->begin)
+		root->left = tree_remove(root->left, r);
+	else
+		root->right = tree_remove(root->right, r);
+	return root;
+}
+
+/* First entry ending at or after addr, NULL if there is none. */
+static struct range_entry *tree_find(const struct memranges *ranges,
+				     resource_t addr)
+{
+	struct range_entry *cur = ranges->root;
+	struct range_entry *found = NULL;
+
+	while (cur != NULL) {
+		if (cur->end >= addr) {
+			found = cur;
+			cur = cur->left;
+		} else {
+			cur = cur->right;
+		}
+	}
+	return found;
+}
+
+/* Pointer to the list link of the first entry beginning at or after addr. */
+static struct range_entry **list_position(struct memranges *ranges,
+					  resource_t addr)
+{
+	struct range_entry *cur = ranges->root;
+	struct range_entry *prev = NULL;
+
+	while (cur != NULL) {
+		if (cur->begin < addr) {
+			prev = cur;
+			cur = cur->right;
+		} else {
+			cur = cur->left;
+		}
+	}
+	return prev ? &prev->next : &ranges->entries;
+}
+
 static inline void range_entry_unlink_and_free(struct memranges *ranges,
 					       struct range_entry **prev_ptr,
 					       struct range_entry *r)
 {
 	range_entry_unlink(prev_ptr, r);
+	ranges->root = tree_remove(ranges->root, r);
 	range_entry_link(&ranges->free_list, r);
 }
 
 static struct range_entry *alloc_range(struct memranges *ranges)
 {
+	if (ranges->free_list == NULL && ENV_RAMSTAGE) {
+		struct range_entry *pool;
+		size_t i;
+
+		/* coreboot doesn't free, so don't malloc() every entry. */
+		pool = malloc(MEMRANGES_POOL_CHUNK * sizeof(*pool));
+		for (i = 0; pool != NULL && i < MEMRANGES_POOL_CHUNK; i++)
+			range_entry_link(&ranges->free_list, &pool[i]);
+	}
 	if (ranges->free_list != NULL) {
 		struct range_entry *r;
 
@@ -47,8 +171,6 @@ static struct range_entry *alloc_range(struct memranges *ranges)
 		range_entry_unlink(&ranges->free_list, r);
 		return r;
 	}
-	if (ENV_RAMSTAGE)
-		return malloc(sizeof(struct range_entry));
 	return NULL;
 }
 
@@ -68,9 +190,30 @@ range_list_add(struct memranges *ranges, struct range_entry **prev_ptr,
 	new_entry->tag = tag;
 	range_entry_link(prev_ptr, new_entry);
 
+	/* xorshift32 for the treap priorities. */
+	ranges->seed ^= ranges->seed << 13;
+	ranges->seed ^= ranges->seed >> 17;
+	ranges->seed ^= ranges->seed << 5;
+	new_entry->prio = ranges->seed;
+	new_entry->left = NULL;
+	new_entry->right = NULL;
+	ranges->root = tree_insert(ranges->root, new_entry);
+
 	return new_entry;
 }
 
+/* Merge r into prev if they touch and have the same tag. */
+static int merge_entries(struct memranges *ranges, struct range_entry *prev,
+			 struct range_entry *r)
+{
+	if (prev->end + 1 < r->begin || prev->tag != r->tag)
+		return 0;
+
+	prev->end = r->end;
+	range_entry_unlink_and_free(ranges, &prev->next, r);
+	return 1;
+}
+
 static void merge_neighbor_entries(struct memranges *ranges)
 {
 	struct range_entry *cur;
@@ -87,12 +230,9 @@ static void merge_neighbor_entries(struct memranges *ranges)
 
 		/* If the previous entry merges with the current update the
 		 * previous entry to cover full range and delete current from
-		 * the list. */
-		if (prev->end + 1 >= cur->begin && prev->tag == cur->tag) {
-			prev->end = cur->end;
-			range_entry_unlink_and_free(ranges, &prev->next, cur);
-			/* Set cur to prev so cur->next is valid since cur
-			 * was just unlinked and free. */
+		 * the list. Set cur to prev so cur->next is valid since cur
+		 * was just unlinked and free. */
+		if (merge_entries(ranges, prev, cur)) {
 			cur = prev;
 			continue;
 		}
@@ -109,8 +249,13 @@ static void remove_memranges(struct memranges *ranges,
 	struct range_entry *next;
 	struct range_entry **prev_ptr;
 
-	prev_ptr = &ranges->entries;
-	for (cur = ranges->entries; cur != NULL; cur = next) {
+	/* Skip the entries ending before the removal range. */
+	cur = tree_find(ranges, begin);
+	if (cur == NULL)
+		return;
+	prev_ptr = list_position(ranges, cur->begin);
+
+	for (; cur != NULL; cur = next) {
 		resource_t tmp_end;
 
 		/* Cache the next value to handle unlinks. */
@@ -120,12 +265,6 @@ static void remove_memranges(struct memranges *ranges,
 		if (end < cur->begin)
 			break;
 
-		/* The removal range starts after this one. */
-		if (begin > cur->end) {
-			prev_ptr = &cur->next;
-			continue;
-		}
-
 		/* The removal range overlaps with the current entry either
 		 * partially or fully. However, we need to adjust the removal
 		 * range for any holes. */
@@ -171,34 +310,28 @@ static void merge_add_memranges(struct memranges *ranges,
 				resource_t begin, resource_t end,
 				unsigned long tag)
 {
-	struct range_entry *cur;
 	struct range_entry **prev_ptr;
-
-	prev_ptr = &ranges->entries;
+	struct range_entry *new_entry;
+	struct range_entry *prev;
 
 	/* Remove all existing entries covered by the range. */
 	remove_memranges(ranges, begin, end, -1);
 
-	/* Find the entry to place the new entry after. Since
-	 * remove_memranges() was called above there is a guaranteed
+	/* Since remove_memranges() was called above there is a guaranteed
 	 * spot for this new entry. */
-	for (cur = ranges->entries; cur != NULL; cur = cur->next) {
-		/* Found insertion spot before current entry. */
-		if (end < cur->begin)
-			break;
-
-		/* Keep track of previous entry to insert new entry after it. */
-		prev_ptr = &cur->next;
-
-		/* The new entry starts after this one. */
-		if (begin > cur->end)
-			continue;
+	prev_ptr = list_position(ranges, begin);
+	new_entry = range_list_add(ranges, prev_ptr, begin, end, tag);
+	if (new_entry == NULL)
+		return;
 
+	/* All other neighbors were merged already, only the new entry can
+	 * merge with the ones next to it. */
+	if (new_entry->next != NULL)
+		merge_entries(ranges, new_entry, new_entry->next);
+	if (prev_ptr != &ranges->entries) {
+		prev = container_of(prev_ptr, struct range_entry, next);
+		merge_entries(ranges, prev, new_entry);
 	}
-
-	/* Add new entry and merge with neighbors. */
-	range_list_add(ranges, prev_ptr, begin, end, tag);
-	merge_neighbor_entries(ranges);
 }
 
 void memranges_update_tag(struct memranges *ranges, unsigned long old_tag,
@@ -228,12 +361,12 @@ static void do_action(struct memranges *ranges,
 	if (size == 0)
 		return;
 
-	/* The addresses are aligned to 4096 bytes: the begin address is
+	/* The addresses are aligned to 2^align bytes: the begin address is
 	 * aligned down while the end address is aligned up to be conservative
 	 * about the full range covered. */
-	begin = ALIGN_DOWN(base, 4096);
+	begin = ALIGN_DOWN(base, 1ULL << ranges->align);
 	end = begin + size + (base - begin);
-	end = ALIGN_UP(end, 4096) - 1;
+	end = ALIGN_UP(end, 1ULL << ranges->align) - 1;
 	action(ranges, begin, end, tag);
 }
 
@@ -290,18 +423,28 @@ void memranges_add_resources(struct memranges *ranges,
 	memranges_add_resources_filter(ranges, mask, match, tag, NULL);
 }
 
-void memranges_init_empty(struct memranges *ranges, struct range_entry *to_free,
-			  size_t num_free)
+void memranges_init_empty_with_alignment(struct memranges *ranges,
+					 struct range_entry *to_free,
+					 size_t num_free, unsigned char align)
 {
 	size_t i;
 
 	ranges->entries = NULL;
 	ranges->free_list = NULL;
+	ranges->root = NULL;
+	ranges->seed = 0x2545f491;
+	ranges->align = align;
 
 	for (i = 0; i < num_free; i++)
 		range_entry_link(&ranges->free_list, &to_free[i]);
 }
 
+void memranges_init_empty(struct memranges *ranges, struct range_entry *to_free,
+			  size_t num_free)
+{
+	memranges_init_empty_with_alignment(ranges, to_free, num_free, 12);
+}
+
 void memranges_init(struct memranges *ranges,
 		    unsigned long mask, unsigned long match,
 		    unsigned long tag)
@@ -312,9 +455,13 @@ void memranges_init(struct memranges *ranges,
 
 void memranges_teardown(struct memranges *ranges)
 {
+	struct range_entry *r;
+
+	ranges->root = NULL;
 	while (ranges->entries != NULL) {
-		range_entry_unlink_and_free(ranges, &ranges->entries,
-					    ranges->entries);
+		r = ranges->entries;
+		range_entry_unlink(&ranges->entries, r);
+		range_entry_link(&ranges->free_list, r);
 	}
 }
 
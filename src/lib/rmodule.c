@@ -151,6 +151,14 @@ static int rmodule_relocate(const struct rmodule *module)
 	reloc = module->relocations;
 	num_relocations = rmodule_number_relocations(module);
 
+	/* A module prelinked by cbfstool for the address it was loaded at
+	 * needs no further processing. */
+	if (adjustment == 0) {
+		printk(BIOS_DEBUG, "Module prelinked at %p, skipping %zu relocs\n",
+		       module->location, num_relocations);
+		return 0;
+	}
+
 	printk(BIOS_DEBUG, "Processing %zu relocs. Offset value of 0x%08lx\n",
 	       num_relocations, (unsigned long)adjustment);
 
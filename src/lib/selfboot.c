@@ -28,6 +28,11 @@
 #include <bootmem.h>
 #include <program_loading.h>
 #include <timestamp.h>
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+#include <cpu/x86/mp.h>
+#include <smp/spinlock.h>
+#include <timer.h>
+#endif
 
 static const unsigned long lb_start = (unsigned long)&_program;
 static const unsigned long lb_end = (unsigned long)&_eprogram;
@@ -40,6 +45,7 @@ struct segment {
 	unsigned long s_memsz;
 	unsigned long s_filesz;
 	int compression;
+	int bounce;
 };
 
 static void segment_insert_before(struct segment *seg, struct segment *new)
@@ -80,33 +86,44 @@ static void segment_insert_after(struct segment *seg, struct segment *new)
 
 static unsigned long bounce_size, bounce_buffer;
 
-static void get_bounce_buffer(unsigned long req_size)
+static int bounce_buffer_needed(void)
 {
-	unsigned long lb_size;
-	void *buffer;
-
 	/* When the ramstage is relocatable there is no need for a bounce
 	 * buffer. All payloads should not overlap the ramstage.
 	 */
-	if (IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE) ||
-	    !arch_supports_bounce_buffer()) {
+	return !IS_ENABLED(CONFIG_RELOCATABLE_RAMSTAGE) &&
+		arch_supports_bounce_buffer();
+}
+
+static void get_bounce_buffer(unsigned long prefix, unsigned long suffix)
+{
+	unsigned long lb_size, size;
+	void *buffer;
+
+	if (!bounce_buffer_needed()) {
 		bounce_buffer = ~0UL;
 		bounce_size = 0;
 		return;
 	}
 
 	lb_size = lb_end - lb_start;
-	/* Plus coreboot size so I have somewhere
-	 * to place a copy to return to.
+	/* The buffer mirrors coreboot, followed by a copy of coreboot to
+	 * return to. Compressed segments that only partly shadow coreboot
+	 * are decompressed around the mirror, so leave room for the largest
+	 * prefix and suffix of those as well.
 	 */
-	lb_size = req_size + lb_size;
+	size = prefix + lb_size + MAX(lb_size, suffix);
 
-	buffer = bootmem_allocate_buffer(lb_size);
+	buffer = bootmem_allocate_buffer(size);
+	if (buffer == NULL) {
+		bounce_buffer = 0;
+		return;
+	}
 
-	printk(BIOS_SPEW, "Bounce Buffer at %p, %lu bytes\n", buffer, lb_size);
+	printk(BIOS_SPEW, "Bounce Buffer at %p, %lu bytes\n", buffer, size);
 
-	bounce_buffer = (uintptr_t)buffer;
-	bounce_size = req_size;
+	bounce_buffer = (uintptr_t)buffer + prefix;
+	bounce_size = lb_size;
 }
 
 static int overlaps_coreboot(struct segment *seg)
@@ -117,26 +134,17 @@ static int overlaps_coreboot(struct segment *seg)
 	return !((end <= lb_start) || (start >= lb_end));
 }
 
-static int relocate_segment(unsigned long buffer, struct segment *seg)
+/* Slice off the parts of an uncompressed segment that don't conflict with
+ * coreboot, so that only the bytes shadowing coreboot go through the bounce
+ * buffer.
+ */
+static void split_segment(struct segment *seg)
 {
-	/* Modify all segments that want to load onto coreboot
-	 * to load onto the bounce buffer instead.
-	 */
-	/* ret:  1 : A new segment is inserted before the seg.
-	 *       0 : A new segment is inserted after the seg, or no new one.
-	 */
-	unsigned long start, middle, end, ret = 0;
+	unsigned long start, middle, end;
 
 	printk(BIOS_SPEW, "lb: [0x%016lx, 0x%016lx)\n",
 		lb_start, lb_end);
 
-	/* I don't conflict with coreboot so get out of here */
-	if (!overlaps_coreboot(seg))
-		return 0;
-
-	if (!arch_supports_bounce_buffer())
-		die("bounce buffer not supported");
-
 	start = seg->s_dstaddr;
 	middle = start + seg->s_filesz;
 	end = start + seg->s_memsz;
@@ -144,83 +152,122 @@ static int relocate_segment(unsigned long buffer, struct segment *seg)
 	printk(BIOS_SPEW, "segment: [0x%016lx, 0x%016lx, 0x%016lx)\n",
 		start, middle, end);
 
-	if (seg->compression == CBFS_COMPRESS_NONE) {
-		/* Slice off a piece at the beginning
-		 * that doesn't conflict with coreboot.
-		 */
-		if (start < lb_start) {
-			struct segment *new;
-			unsigned long len = lb_start - start;
-			new = malloc(sizeof(*new));
-			*new = *seg;
-			new->s_memsz = len;
-			seg->s_memsz -= len;
-			seg->s_dstaddr += len;
-			seg->s_srcaddr += len;
-			if (seg->s_filesz > len) {
-				new->s_filesz = len;
-				seg->s_filesz -= len;
-			} else {
-				seg->s_filesz = 0;
-			}
+	if (seg->compression != CBFS_COMPRESS_NONE)
+		return;
 
-			/* Order by stream offset */
-			segment_insert_before(seg, new);
+	/* Slice off a piece at the beginning
+	 * that doesn't conflict with coreboot.
+	 */
+	if (start < lb_start) {
+		struct segment *new;
+		unsigned long len = lb_start - start;
+		new = malloc(sizeof(*new));
+		*new = *seg;
+		new->s_memsz = len;
+		seg->s_memsz -= len;
+		seg->s_dstaddr += len;
+		seg->s_srcaddr += len;
+		if (seg->s_filesz > len) {
+			new->s_filesz = len;
+			seg->s_filesz -= len;
+		} else {
+			seg->s_filesz = 0;
+		}
 
-			/* compute the new value of start */
-			start = seg->s_dstaddr;
+		/* Order by stream offset */
+		segment_insert_before(seg, new);
 
-			printk(BIOS_SPEW,
-				"   early: [0x%016lx, 0x%016lx, 0x%016lx)\n",
-				new->s_dstaddr,
-				new->s_dstaddr + new->s_filesz,
-				new->s_dstaddr + new->s_memsz);
+		/* compute the new value of start */
+		start = seg->s_dstaddr;
 
-			ret = 1;
-		}
+		printk(BIOS_SPEW,
+			"   early: [0x%016lx, 0x%016lx, 0x%016lx)\n",
+			new->s_dstaddr,
+			new->s_dstaddr + new->s_filesz,
+			new->s_dstaddr + new->s_memsz);
+	}
 
-		/* Slice off a piece at the end
-		 * that doesn't conflict with coreboot
-		 */
-		if (end > lb_end) {
-			unsigned long len = lb_end - start;
-			struct segment *new;
-			new = malloc(sizeof(*new));
-			*new = *seg;
-			seg->s_memsz = len;
-			new->s_memsz -= len;
-			new->s_dstaddr += len;
-			new->s_srcaddr += len;
-			if (seg->s_filesz > len) {
-				seg->s_filesz = len;
-				new->s_filesz -= len;
-			} else {
-				new->s_filesz = 0;
-			}
-			/* Order by stream offset */
-			segment_insert_after(seg, new);
-
-			printk(BIOS_SPEW,
-				"   late: [0x%016lx, 0x%016lx, 0x%016lx)\n",
-				new->s_dstaddr,
-				new->s_dstaddr + new->s_filesz,
-				new->s_dstaddr + new->s_memsz);
+	/* Slice off a piece at the end
+	 * that doesn't conflict with coreboot
+	 */
+	if (end > lb_end) {
+		unsigned long len = lb_end - start;
+		struct segment *new;
+		new = malloc(sizeof(*new));
+		*new = *seg;
+		seg->s_memsz = len;
+		new->s_memsz -= len;
+		new->s_dstaddr += len;
+		new->s_srcaddr += len;
+		if (seg->s_filesz > len) {
+			seg->s_filesz = len;
+			new->s_filesz -= len;
+		} else {
+			new->s_filesz = 0;
 		}
+		/* Order by stream offset */
+		segment_insert_after(seg, new);
+
+		printk(BIOS_SPEW,
+			"   late: [0x%016lx, 0x%016lx, 0x%016lx)\n",
+			new->s_dstaddr,
+			new->s_dstaddr + new->s_filesz,
+			new->s_dstaddr + new->s_memsz);
 	}
+}
 
+static void relocate_segment(unsigned long buffer, struct segment *seg)
+{
 	/* Now retarget this segment onto the bounce buffer */
 	/* sort of explanation: the buffer is a 1:1 mapping to coreboot.
 	 * so you will make the dstaddr be this buffer, and it will get copied
 	 * later to where coreboot lives.
 	 */
 	seg->s_dstaddr = buffer + (seg->s_dstaddr - lb_start);
+	seg->bounce = 1;
 
 	printk(BIOS_SPEW, " bounce: [0x%016lx, 0x%016lx, 0x%016lx)\n",
 		seg->s_dstaddr,
 		seg->s_dstaddr + seg->s_filesz,
 		seg->s_dstaddr + seg->s_memsz);
+}
 
-	return ret;
+/*
+ * Put the parts of [start, end) of a segment loaded onto the bounce buffer
+ * that don't shadow coreboot where they belong: the data is copied out and
+ * anything else is cleared in place.
+ */
+static void place_outside_coreboot(unsigned long start, unsigned long end,
+				   int data)
+{
+	const unsigned long mirror_end = bounce_buffer + (lb_end - lb_start);
+	unsigned long ranges[2][2] = {
+		{ start, MIN(end, bounce_buffer) },
+		{ MAX(start, mirror_end), end },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ranges); i++) {
+		unsigned long from = ranges[i][0];
+		unsigned long to = lb_start + (from - bounce_buffer);
+		unsigned long amount = ranges[i][1] - from;
+
+		if (ranges[i][1] <= from)
+			continue;
+
+		printk(BIOS_DEBUG, "move %s around: from %lx, to %lx, amount: %lx\n",
+			i ? "suffix" : "prefix", from, to, amount);
+		if (data)
+			memcpy((void *)to, (void *)from, amount);
+		else
+			memset((void *)to, 0, amount);
+	}
+
+	/* Clear what is left in the mirror of coreboot. */
+	start = MAX(start, bounce_buffer);
+	end = MIN(end, mirror_end);
+	if (!data && start < end)
+		memset((void *)start, 0, end - start);
 }
 
 /* Decode a serialized cbfs payload segment
@@ -271,6 +318,7 @@ static int build_self_segment_list(
 			new->s_dstaddr = segment.load_addr;
 			new->s_memsz = segment.mem_len;
 			new->compression = segment.compression;
+			new->bounce = 0;
 			new->s_srcaddr = (uintptr_t)
 				((unsigned char *)first_segment)
 				+ segment.offset;
@@ -302,6 +350,7 @@ static int build_self_segment_list(
 			new->s_dstaddr = segment.load_addr;
 			new->s_memsz = segment.mem_len;
 			new->compression = CBFS_COMPRESS_NONE;
+			new->bounce = 0;
 			break;
 
 		case PAYLOAD_SEGMENT_ENTRY:
@@ -362,11 +411,226 @@ static int payload_targets_usable_ram(struct segment *head)
 	return 1;
 }
 
+/*
+ * Load a single segment. The LZMA scratchpad is NULL on the BSP, which
+ * uses the one of ulzman() and records timestamps. Returns 1 on success.
+ */
+static int load_segment(struct segment *ptr, void *lzma_scratchpad)
+{
+	unsigned char *dest, *src, *middle, *end;
+	size_t len, memsz;
+
+	printk(BIOS_DEBUG,
+		"Loading Segment: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
+		ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
+
+	/* Compute the boundaries of the segment */
+	dest = (unsigned char *)(ptr->s_dstaddr);
+	src = (unsigned char *)(ptr->s_srcaddr);
+	len = ptr->s_filesz;
+	memsz = ptr->s_memsz;
+	end = dest + memsz;
+
+	/* Copy data from the initial buffer */
+	switch (ptr->compression) {
+	case CBFS_COMPRESS_LZMA: {
+		printk(BIOS_DEBUG, "using LZMA\n");
+		if (lzma_scratchpad) {
+			len = ulzman_scratchpad(src, len, dest, memsz,
+					lzma_scratchpad, LZMA_SCRATCHPAD_SIZE);
+		} else {
+			timestamp_add_now(TS_START_ULZMA);
+			len = ulzman(src, len, dest, memsz);
+			timestamp_add_now(TS_END_ULZMA);
+		}
+		if (!len) /* Decompression Error. */
+			return 0;
+		break;
+	}
+	case CBFS_COMPRESS_LZ4: {
+		printk(BIOS_DEBUG, "using LZ4\n");
+		if (lzma_scratchpad) {
+			len = ulz4fn(src, len, dest, memsz);
+		} else {
+			timestamp_add_now(TS_START_ULZ4F);
+			len = ulz4fn(src, len, dest, memsz);
+			timestamp_add_now(TS_END_ULZ4F);
+		}
+		if (!len) /* Decompression Error. */
+			return 0;
+		break;
+	}
+	case CBFS_COMPRESS_NONE: {
+		printk(BIOS_DEBUG, "it's not compressed!\n");
+		memcpy(dest, src, len);
+		break;
+	}
+	default:
+		printk(BIOS_INFO,  "CBFS:  Unknown compression type %d\n",
+			ptr->compression);
+		return 0;
+	}
+	/* Calculate middle after any changes to len. */
+	middle = dest + len;
+	printk(BIOS_SPEW, "[ 0x%08lx, %08lx, 0x%08lx) <- %08lx\n",
+		(unsigned long)dest,
+		(unsigned long)middle,
+		(unsigned long)end,
+		(unsigned long)src);
+
+	/* Only the bytes shadowing coreboot stay in the bounce buffer. */
+	if (ptr->bounce) {
+		place_outside_coreboot((unsigned long)dest,
+				       (unsigned long)middle, 1);
+		place_outside_coreboot((unsigned long)middle,
+				       (unsigned long)end, 0);
+		return 1;
+	}
+
+	/* Zero the extra bytes between middle & end */
+	if (middle < end) {
+		printk(BIOS_DEBUG,
+			"Clearing Segment: addr: 0x%016lx memsz: 0x%016lx\n",
+			(unsigned long)middle,
+			(unsigned long)(end - middle));
+
+		/* Zero the extra bytes */
+		memset(middle, 0, end - middle);
+	}
+
+	return 1;
+}
+
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+/* APs decompressing segments next to the BSP, each with its own LZMA state. */
+#define SELF_AP_WORKERS 3
+
+static struct {
+	struct segment *head;
+	struct segment *next;
+	int workers;
+	int busy;
+	int failed;
+} self_work;
+
+static unsigned char ap_scratchpad[SELF_AP_WORKERS][LZMA_SCRATCHPAD_SIZE];
+DECLARE_SPIN_LOCK(self_work_lock)
+
+/* Take the next segment not using the bounce buffer. Called locked. */
+static struct segment *claim_segment(void)
+{
+	struct segment *seg = self_work.next;
+
+	while (seg != self_work.head && seg->bounce)
+		seg = seg->next;
+
+	if (seg == self_work.head)
+		return NULL;
+
+	self_work.next = seg->next;
+	self_work.busy++;
+	return seg;
+}
+
+static void self_work_loop(void *lzma_scratchpad)
+{
+	struct segment *seg;
+	int loaded;
+
+	while (1) {
+		spin_lock(&self_work_lock);
+		seg = claim_segment();
+		spin_unlock(&self_work_lock);
+
+		if (seg == NULL)
+			return;
+
+		loaded = load_segment(seg, lzma_scratchpad);
+
+		spin_lock(&self_work_lock);
+		if (!loaded)
+			self_work.failed = 1;
+		self_work.busy--;
+		spin_unlock(&self_work_lock);
+	}
+}
+
+static void self_ap_worker(void)
+{
+	int worker;
+
+	spin_lock(&self_work_lock);
+	worker = self_work.workers++;
+	spin_unlock(&self_work_lock);
+
+	if (worker < SELF_AP_WORKERS)
+		self_work_loop(ap_scratchpad[worker]);
+}
+
+/* Segments can only be loaded in any order if none of them overlap. */
+static int segments_independent(struct segment *head)
+{
+	struct segment *a, *b;
+	int count = 0;
+
+	for (a = head->next; a != head; a = a->next) {
+		for (b = a->next; b != head; b = b->next) {
+			if (a->s_dstaddr < b->s_dstaddr + b->s_memsz &&
+			    b->s_dstaddr < a->s_dstaddr + a->s_memsz)
+				return 0;
+		}
+		count++;
+	}
+
+	return count > 1;
+}
+
+static int load_segments_parallel(struct segment *head)
+{
+	struct segment *ptr;
+	int failed = 0;
+
+	self_work.head = head;
+	self_work.next = head->next;
+	self_work.workers = 0;
+	self_work.busy = 0;
+	self_work.failed = 0;
+
+	if (mp_run_on_aps(self_ap_worker, 10 * USECS_PER_MSEC) < 0)
+		printk(BIOS_DEBUG, "Loading segments without all APs.\n");
+
+	/* The room around the bounce buffer is shared, so the segments
+	 * using it are loaded one after the other by the BSP. */
+	for (ptr = head->next; ptr != head; ptr = ptr->next) {
+		if (ptr->bounce && !load_segment(ptr, NULL))
+			failed = 1;
+	}
+
+	self_work_loop(NULL);
+
+	/* Wait for the APs to finish the segments they picked up, without
+	 * keeping them from the lock they need to say so. */
+	while (self_work.busy)
+		cpu_relax();
+
+	/* APs that pick up the work late find nothing to do. */
+	spin_lock(&self_work_lock);
+	self_work.next = self_work.head;
+	failed |= self_work.failed;
+	spin_unlock(&self_work_lock);
+
+	return !failed;
+}
+#endif
+
 static int load_self_segments(struct segment *head, struct prog *payload,
 			      bool check_regions)
 {
 	struct segment *ptr;
-	unsigned long bounce_high = lb_end;
+	unsigned long prefix = 0, suffix = 0;
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+	int parallel;
+#endif
 
 	if (check_regions) {
 		if (!payload_targets_usable_ram(head))
@@ -386,128 +650,57 @@ static int load_self_segments(struct segment *head, struct prog *payload,
 
 		if (!overlaps_coreboot(ptr))
 			continue;
-		if (ptr->s_dstaddr + ptr->s_memsz > bounce_high)
-			bounce_high = ptr->s_dstaddr + ptr->s_memsz;
+
+		if (!bounce_buffer_needed())
+			die("bounce buffer not supported");
+
+		/* Plan the bounce buffer: uncompressed segments are split at
+		 * the coreboot boundaries, compressed ones are decompressed
+		 * around the mirror of coreboot. */
+		split_segment(ptr);
+		if (ptr->compression == CBFS_COMPRESS_NONE)
+			continue;
+		if (ptr->s_dstaddr < lb_start)
+			prefix = MAX(prefix, lb_start - ptr->s_dstaddr);
+		if (ptr->s_dstaddr + ptr->s_memsz > lb_end)
+			suffix = MAX(suffix,
+				     ptr->s_dstaddr + ptr->s_memsz - lb_end);
 	}
-	get_bounce_buffer(bounce_high - lb_start);
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+	parallel = segments_independent(head);
+#endif
+
+	get_bounce_buffer(prefix, suffix);
 	if (!bounce_buffer) {
 		printk(BIOS_ERR, "Could not find a bounce buffer...\n");
 		return 0;
 	}
 
 	for (ptr = head->next; ptr != head; ptr = ptr->next) {
-		unsigned char *dest, *src, *middle, *end;
-		size_t len, memsz;
-		printk(BIOS_DEBUG,
-			"Loading Segment: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
-			ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
-
-		/* Modify the segment to load onto the bounce_buffer if
-		 * necessary.
-		 */
-		if (relocate_segment(bounce_buffer, ptr)) {
-			ptr = (ptr->prev)->prev;
-			continue;
-		}
+		if (overlaps_coreboot(ptr))
+			relocate_segment(bounce_buffer, ptr);
+	}
 
-		printk(BIOS_DEBUG,
-			"Post relocation: addr: 0x%016lx memsz: 0x%016lx filesz: 0x%016lx\n",
-			ptr->s_dstaddr, ptr->s_memsz, ptr->s_filesz);
-
-		/* Compute the boundaries of the segment */
-		dest = (unsigned char *)(ptr->s_dstaddr);
-		src = (unsigned char *)(ptr->s_srcaddr);
-		len = ptr->s_filesz;
-		memsz = ptr->s_memsz;
-		end = dest + memsz;
-
-		/* Copy data from the initial buffer */
-		switch (ptr->compression) {
-		case CBFS_COMPRESS_LZMA: {
-			printk(BIOS_DEBUG, "using LZMA\n");
-			timestamp_add_now(TS_START_ULZMA);
-			len = ulzman(src, len, dest, memsz);
-			timestamp_add_now(TS_END_ULZMA);
-			if (!len) /* Decompression Error. */
-				return 0;
-			break;
-		}
-		case CBFS_COMPRESS_LZ4: {
-			printk(BIOS_DEBUG, "using LZ4\n");
-			timestamp_add_now(TS_START_ULZ4F);
-			len = ulz4fn(src, len, dest, memsz);
-			timestamp_add_now(TS_END_ULZ4F);
-			if (!len) /* Decompression Error. */
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+	if (parallel) {
+		if (!load_segments_parallel(head))
+			return 0;
+	} else
+#endif
+	{
+		for (ptr = head->next; ptr != head; ptr = ptr->next) {
+			if (!load_segment(ptr, NULL))
 				return 0;
-			break;
-		}
-		case CBFS_COMPRESS_NONE: {
-			printk(BIOS_DEBUG, "it's not compressed!\n");
-			memcpy(dest, src, len);
-			break;
-		}
-		default:
-			printk(BIOS_INFO,  "CBFS:  Unknown compression type %d\n",
-				ptr->compression);
-			return -1;
-		}
-		/* Calculate middle after any changes to len. */
-		middle = dest + len;
-		printk(BIOS_SPEW, "[ 0x%08lx, %08lx, 0x%08lx) <- %08lx\n",
-			(unsigned long)dest,
-			(unsigned long)middle,
-			(unsigned long)end,
-			(unsigned long)src);
-
-		/* Zero the extra bytes between middle & end */
-		if (middle < end) {
-			printk(BIOS_DEBUG,
-				"Clearing Segment: addr: 0x%016lx memsz: 0x%016lx\n",
-				(unsigned long)middle,
-				(unsigned long)(end - middle));
-
-			/* Zero the extra bytes */
-			memset(middle, 0, end - middle);
-		}
-
-		/* Copy the data that's outside the area that shadows ramstage
-		 */
-		printk(BIOS_DEBUG, "dest %p, end %p, bouncebuffer %lx\n", dest,
-			end, bounce_buffer);
-		if ((unsigned long)end > bounce_buffer) {
-			if ((unsigned long)dest < bounce_buffer) {
-				unsigned char *from = dest;
-				unsigned char *to = (unsigned char *)
-					(lb_start - (bounce_buffer
-					- (unsigned long)dest));
-				unsigned long amount = bounce_buffer
-					- (unsigned long)dest;
-				printk(BIOS_DEBUG,
-					"move prefix around: from %p, to %p, amount: %lx\n",
-					from, to, amount);
-				memcpy(to, from, amount);
-			}
-			if ((unsigned long)end > bounce_buffer + (lb_end
-				- lb_start)) {
-				unsigned long from = bounce_buffer + (lb_end
-					- lb_start);
-				unsigned long to = lb_end;
-				unsigned long amount =
-					(unsigned long)end - from;
-				printk(BIOS_DEBUG,
-					"move suffix around: from %lx, to %lx, amount: %lx\n",
-						from, to, amount);
-				memcpy((char *)to, (char *)from, amount);
-			}
 		}
+	}
 
-		/*
-		 * Each architecture can perform additonal operations
-		 * on the loaded segment
-		 */
-		prog_segment_loaded((uintptr_t)dest, ptr->s_memsz,
+	/*
+	 * Each architecture can perform additonal operations
+	 * on the loaded segment
+	 */
+	for (ptr = head->next; ptr != head; ptr = ptr->next)
+		prog_segment_loaded(ptr->s_dstaddr, ptr->s_memsz,
 				ptr->next == head ? SEG_FINAL : 0);
-	}
 
 	return 1;
 }
@@ -1423,8 +1423,10 @@ static void remap_bsp_lapic(struct bus *cpu_bus)
 		cpu_path.type = DEVICE_PATH_APIC;
 		cpu_path.apic.apic_id = 0;
 		cpu = find_dev_path(cpu_bus, &cpu_path);
-		if (cpu)
+		if (cpu) {
 			cpu->path.apic.apic_id = bsp_lapic_id;
+			dev_index_update(cpu);
+		}
 	}
 }
 
@@ -1490,6 +1492,7 @@ static void cpu_bus_scan(device_t dev)
 					while (dev_mc) {
 						printk(BIOS_DEBUG, "%s move to ",dev_path(dev_mc));
 						dev_mc->path.pci.devfn -= PCI_DEVFN(0x18,0);
+						dev_index_update(dev_mc);
 						printk(BIOS_DEBUG, "%s\n",dev_path(dev_mc));
 						dev_mc = dev_mc->sibling;
 					}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <cbmem.h>
+#include <console/console.h>
+#include <security/vboot/body_cache.h>
+
+#define BODY_CACHE_VERIFIED	0x56455249	/* "VERI" */
+
+struct body_cache {
+	uint32_t offset;
+	uint32_t size;
+	uint32_t state;
+	/*
+	 * The region device lives in the CBMEM entry itself so that CBFS
+	 * file handles chained off of it stay valid for the whole stage,
+	 * also in romstage where there is no writable .bss. Every stage
+	 * initializes it again before use.
+	 */
+	struct mem_region_device mdev;
+	uint8_t data[0];
+};
+
+void *vboot_body_cache_alloc(const struct region *region)
+{
+	struct body_cache *bc;
+
+	/* An entry recovered on resume cannot be resized. */
+	bc = cbmem_find(CBMEM_ID_VBOOT_BODY);
+	if (bc != NULL && bc->size != region_sz(region))
+		return NULL;
+
+	if (bc == NULL)
+		bc = cbmem_add(CBMEM_ID_VBOOT_BODY,
+			       sizeof(*bc) + region_sz(region));
+	if (bc == NULL) {
+		printk(BIOS_WARNING, "VBOOT: No space to cache firmware body.\n");
+		return NULL;
+	}
+
+	bc->offset = region_offset(region);
+	bc->size = region_sz(region);
+	bc->state = 0;
+
+	return bc->data;
+}
+
+void vboot_body_cache_commit(void)
+{
+	struct body_cache *bc = cbmem_find(CBMEM_ID_VBOOT_BODY);
+
+	if (bc != NULL)
+		bc->state = BODY_CACHE_VERIFIED;
+}
+
+int vboot_body_cache_rdev(const struct cbfs_props *props,
+			  struct region_device *rdev)
+{
+	struct body_cache *bc = cbmem_find(CBMEM_ID_VBOOT_BODY);
+
+	if (bc == NULL || bc->state != BODY_CACHE_VERIFIED)
+		return -1;
+
+	/*
+	 * The cache only covers the signed part of the slot, which is what
+	 * the vboot locator reports as the CBFS region.
+	 */
+	if (props->offset != bc->offset || props->size != bc->size)
+		return -1;
+
+	mem_region_device_ro_init(&bc->mdev, bc->data, bc->size);
+
+	return rdev_chain(rdev, &bc->mdev.rdev, 0, bc->size);
+}
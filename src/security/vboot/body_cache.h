@@ -0,0 +1,53 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __VBOOT_BODY_CACHE_H__
+#define __VBOOT_BODY_CACHE_H__
+
+#include <cbfs.h>
+#include <commonlib/region.h>
+#include <rules.h>
+
+/*
+ * The body cache holds the RW firmware body that verstage read while
+ * hashing it, so that later CBFS accesses to the same region do not hit
+ * the boot media again. The copy is only handed out once it is committed,
+ * i.e. after the hash has been verified. It lives in CBMEM, so it is only
+ * available from romstage on.
+ */
+#if IS_ENABLED(CONFIG_VBOOT_HASH_BODY_CACHE) && \
+	(ENV_ROMSTAGE || ENV_POSTCAR || ENV_RAMSTAGE)
+/* Allocate the cache for the given boot device region. NULL on failure. */
+void *vboot_body_cache_alloc(const struct region *region);
+/* Mark the cache contents as verified. */
+void vboot_body_cache_commit(void);
+/*
+ * Provide a region device backed by the verified copy of the region
+ * described by props. Returns 0 on success, < 0 if there is none.
+ */
+int vboot_body_cache_rdev(const struct cbfs_props *props,
+			  struct region_device *rdev);
+#else
+static inline void *vboot_body_cache_alloc(const struct region *region)
+{
+	return NULL;
+}
+static inline void vboot_body_cache_commit(void) {}
+static inline int vboot_body_cache_rdev(const struct cbfs_props *props,
+					struct region_device *rdev)
+{
+	return -1;
+}
+#endif
+
+#endif /* __VBOOT_BODY_CACHE_H__ */
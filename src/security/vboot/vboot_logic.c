@@ -14,22 +14,37 @@
  */
 
 #include <antirollback.h>
+#include <arch/early_variables.h>
 #include <arch/exception.h>
 #include <assert.h>
 #include <bootmode.h>
+#include <commonlib/helpers.h>
 #include <console/console.h>
 #include <console/vtxprintf.h>
 #include <delay.h>
 #include <string.h>
 #include <timestamp.h>
 #include <vb2_api.h>
+#include <security/vboot/body_cache.h>
 #include <security/vboot/misc.h>
 #include <security/vboot/vbnv.h>
 
 /* The max hash size to expect is for SHA512. */
 #define VBOOT_MAX_HASH_SIZE VB2_SHA512_DIGEST_SIZE
 
-#define TODO_BLOCK_SIZE 1024
+/* Read size used when the body is loaded into the body cache. */
+#define CACHE_BLOCK_SIZE (64 * KiB)
+
+/*
+ * With the body cache, the bounce buffer is only used if the cache can't be
+ * allocated, so a small one on the stack does.
+ */
+#if IS_ENABLED(CONFIG_VBOOT_HASH_BODY_CACHE)
+#define HASH_BLOCK_SIZE 1024
+#else
+#define HASH_BLOCK_SIZE CONFIG_VBOOT_HASH_BLOCK_SIZE
+static uint8_t hash_block[HASH_BLOCK_SIZE] CAR_GLOBAL;
+#endif
 
 static int is_slot_a(struct vb2_context *ctx)
 {
@@ -183,10 +198,15 @@ static int hash_body(struct vb2_context *ctx, struct region_device *fw_main)
 {
 	uint64_t load_ts;
 	uint32_t expected_size;
-	uint8_t block[TODO_BLOCK_SIZE];
+#if IS_ENABLED(CONFIG_VBOOT_HASH_BODY_CACHE)
+	uint8_t block[HASH_BLOCK_SIZE];
+#else
+	uint8_t *block = car_get_var_ptr(hash_block);
+#endif
 	uint8_t hash_digest[VBOOT_MAX_HASH_SIZE];
 	const size_t hash_digest_sz = sizeof(hash_digest);
-	size_t block_size = sizeof(block);
+	size_t block_size = HASH_BLOCK_SIZE;
+	uint8_t *cache;
 	size_t offset;
 	int rv;
 
@@ -222,18 +242,29 @@ static int hash_body(struct vb2_context *ctx, struct region_device *fw_main)
 		return VB2_ERROR_UNKNOWN;
 	}
 
+	/*
+	 * If the body can be kept in memory, read it straight into its final
+	 * place in large blocks and hash it from there. CBFS uses that copy
+	 * once it is verified instead of loading the stages again.
+	 */
+	cache = vboot_body_cache_alloc(region_device_region(fw_main));
+	if (cache != NULL)
+		block_size = CACHE_BLOCK_SIZE;
+
 	/* Extend over the body */
 	while (expected_size) {
 		uint64_t temp_ts;
+		uint8_t *buf = cache != NULL ? cache + offset : block;
+
 		if (block_size > expected_size)
 			block_size = expected_size;
 
 		temp_ts = timestamp_get();
-		if (rdev_readat(fw_main, block, offset, block_size) < 0)
+		if (rdev_readat(fw_main, buf, offset, block_size) < 0)
 			return VB2_ERROR_UNKNOWN;
 		load_ts += timestamp_get() - temp_ts;
 
-		rv = vb2api_extend_hash(ctx, block, block_size);
+		rv = vb2api_extend_hash(ctx, buf, block_size);
 		if (rv)
 			return rv;
 
@@ -297,7 +328,8 @@ static uint32_t extend_pcrs(struct vb2_context *ctx)
  * Verify and select the firmware in the RW image
  *
  * TODO: Avoid loading a stage twice (once in hash_body & again in load_stage).
- * when per-stage verification is ready.
+ * when per-stage verification is ready. VBOOT_HASH_BODY_CACHE does this for
+ * platforms that verify in romstage by keeping the hashed body in CBMEM.
  */
 void verstage_main(void)
 {
@@ -434,5 +466,6 @@ void verstage_main(void)
 
 	printk(BIOS_INFO, "Slot %c is selected\n", is_slot_a(&ctx) ? 'A' : 'B');
 	vb2_set_selected_region(region_device_region(&fw_main));
+	vboot_body_cache_commit();
 	timestamp_add_now(TS_END_VBOOT);
 }
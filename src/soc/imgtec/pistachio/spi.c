@@ -215,7 +215,8 @@ static u32 transaction_reg_setup(struct spim_buffer *first,
 
 /* Sets up control register */
 static u32 control_reg_setup(struct spim_buffer *first,
-				struct spim_buffer *second)
+				struct spim_buffer *second,
+				enum transfer_mode data_mode)
 {
 	u32 reg;
 
@@ -225,7 +226,7 @@ static u32 control_reg_setup(struct spim_buffer *first,
 
 	/* Set up the transfer mode */
 	reg = spi_write_reg_field(reg, SPFI_TRNSFR_MODE_DQ, SPIM_CMD_MODE_0);
-	reg = spi_write_reg_field(reg, SPFI_TRNSFR_MODE, SPIM_DMODE_SINGLE);
+	reg = spi_write_reg_field(reg, SPFI_TRNSFR_MODE, data_mode);
 	reg = spi_write_reg_field(reg, SPIM_EDGE_TX_RX, 1);
 
 	if (second) {
@@ -329,9 +330,12 @@ static int check_device_params(struct spim_device_parameters *pdev_param)
 	return SPIM_OK;
 }
 
-/* Function that carries out read/write operations */
+/*
+ * Function that carries out read/write operations. The command is always
+ * sent on sio0, data_mode selects the lines of the data.
+ */
 static int spim_io(const struct spi_slave *slave, struct spim_buffer *first,
-			struct spim_buffer *second)
+			struct spim_buffer *second, enum transfer_mode data_mode)
 {
 	u32 reg, base;
 	int i, trans_count, ret;
@@ -360,7 +364,7 @@ static int spim_io(const struct spi_slave *slave, struct spim_buffer *first,
 	/* Clear status */
 	write32(base + SPFI_INT_CLEAR_REG_OFFSET, 0xffffffff);
 	/* Set control register */
-	reg = control_reg_setup(first, second);
+	reg = control_reg_setup(first, second, data_mode);
 	write32(base + SPFI_CONTROL_REG_OFFSET, reg);
 	/* First transaction always exists */
 	transaction[0] = first;
@@ -481,7 +485,8 @@ static int do_spi_xfer(const struct spi_slave *slave, const void *dout,
 		buff_1.isread = IMG_TRUE;
 		buff_1.inter_byte_delay = 0;
 	}
-	return spim_io(slave, &buff_0, (dout && din) ? &buff_1 : NULL);
+	return spim_io(slave, &buff_0, (dout && din) ? &buff_1 : NULL,
+			SPIM_DMODE_SINGLE);
 }
 
 static int spi_ctrlr_xfer(const struct spi_slave *slave, const void *dout,
@@ -526,6 +531,62 @@ static int spi_ctrlr_xfer(const struct spi_slave *slave, const void *dout,
 	return SPIM_OK;
 }
 
+/*
+ * Read the flash with a dual output command (1-1-2). The command, address
+ * and dummy bytes go out on sio0 like those of a fast read, only the data
+ * comes back on two lines. Quad output would also need the QE bit of the
+ * flash set, which nothing does yet.
+ */
+static int spi_ctrlr_flash_read(const struct spi_slave *slave,
+				const struct spi_flash_read_cmd *cmd,
+				uint32_t offset, size_t len, void *buf)
+{
+	struct spim_buffer	buff_0;
+	struct spim_buffer	buff_1;
+	u8 command[SPIM_MAX_FLASH_COMMAND_BYTES];
+	unsigned int dummy_bytes = cmd->dummy_cycles / 8;
+	u8 *din = buf;
+	int ret;
+
+	if (cmd->io_mode != SPI_FLASH_IO_1_1_2 || cmd->dummy_cycles % 8 ||
+	    1 + cmd->addr_len + dummy_bytes > sizeof(command)) {
+		printk(BIOS_ERR, "%s: Error: unsupported read command.\n",
+				__func__);
+		return -SPIM_INVALID_TRANSFER_DESC;
+	}
+
+	buff_0.buffer = command;
+	buff_0.isread = IMG_FALSE;
+	buff_0.inter_byte_delay = 0;
+	buff_1.isread = IMG_TRUE;
+	buff_1.inter_byte_delay = 0;
+
+	while (len) {
+		buff_0.size = 0;
+		command[buff_0.size++] = cmd->opcode;
+		if (cmd->addr_len == 4)
+			command[buff_0.size++] = offset >> 24;
+		command[buff_0.size++] = offset >> 16;
+		command[buff_0.size++] = offset >> 8;
+		command[buff_0.size++] = offset;
+		memset(&command[buff_0.size], 0, dummy_bytes);
+		buff_0.size += dummy_bytes;
+
+		buff_1.buffer = din;
+		buff_1.size = min(IMGTEC_SPI_MAX_TRANSFER_SIZE, len);
+
+		ret = spim_io(slave, &buff_0, &buff_1, SPIM_DMODE_DUAL);
+		if (ret)
+			return ret;
+
+		offset += buff_1.size;
+		din += buff_1.size;
+		len -= buff_1.size;
+	}
+
+	return SPIM_OK;
+}
+
 static int spi_ctrlr_setup(const struct spi_slave *slave)
 {
 	struct img_spi_slave *img_slave = NULL;
@@ -574,6 +635,8 @@ static const struct spi_ctrlr spi_ctrlr = {
 	.xfer = spi_ctrlr_xfer,
 	.xfer_vector = spi_xfer_two_vectors,
 	.max_xfer_size = IMGTEC_SPI_MAX_TRANSFER_SIZE,
+	.flash_read_modes = SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_2),
+	.flash_read = spi_ctrlr_flash_read,
 };
 
 const struct spi_ctrlr_buses spi_ctrlr_bus_map[] = {
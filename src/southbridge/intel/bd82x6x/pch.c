@@ -303,6 +303,7 @@ static void pch_pcie_devicetree_update(
 				[PCI_FUNC(dev->path.pci.devfn)];
 
 			dev->path.pci.devfn = new_devfn;
+			dev_index_update(dev);
 		}
 	}
 
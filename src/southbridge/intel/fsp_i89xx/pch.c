@@ -195,6 +195,7 @@ static void pch_pcie_devicetree_update(void)
 			       PCI_SLOT(new_devfn), PCI_FUNC(new_devfn));
 
 			dev->path.pci.devfn = new_devfn;
+			dev_index_update(dev);
 		}
 	}
 }
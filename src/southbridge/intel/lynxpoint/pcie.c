@@ -173,6 +173,7 @@ static void pch_pcie_device_set_func(int index, int pci_func)
 		       PCI_SLOT(new_devfn), PCI_FUNC(new_devfn));
 
 		dev->path.pci.devfn = new_devfn;
+		dev_index_update(dev);
 	}
 }
 
@@ -1505,6 +1505,16 @@ int cbfs_print_entry_info(struct cbfs_image *image, struct cbfs_file *entry,
 		free(hash_str);
 	}
 
+	for (struct cbfs_file_attribute *attr = cbfs_file_first_attr(entry);
+	     attr != NULL;
+	     attr = cbfs_file_next_attr(entry, attr)) {
+		if (ntohl(attr->tag) == CBFS_FILE_ATTR_TAG_PRELINK) {
+			struct cbfs_file_attr_prelink *ap =
+				(struct cbfs_file_attr_prelink *)attr;
+			fprintf(fp, "    prelinked at 0x%x\n", ntohl(ap->base));
+		}
+	}
+
 	if (!verbose)
 		return 0;
 
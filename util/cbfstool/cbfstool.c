@@ -29,6 +29,7 @@
 #include "cbfs_sections.h"
 #include "fit.h"
 #include "partitioned_file.h"
+#include "rmodule.h"
 #include <commonlib/fsp.h>
 #include <commonlib/endian.h>
 
@@ -68,6 +69,8 @@ static struct param {
 	uint32_t size;
 	uint32_t alignment;
 	uint32_t pagesize;
+	uint32_t prelink;
+	uint32_t prelink_assigned;
 	uint32_t cbfsoffset;
 	uint32_t cbfsoffset_assigned;
 	uint32_t arch;
@@ -583,9 +586,28 @@ static int cbfstool_convert_mkstage(struct buffer *buffer, uint32_t *offset,
 
 		ret = parse_elf_to_xip_stage(buffer, &output, offset,
 						param.ignore_section);
-	} else
+	} else {
+		if (param.prelink_assigned) {
+			struct cbfs_file_attr_prelink *attr;
+
+			if (rmodule_prelink(buffer, param.prelink)) {
+				ERROR("Could not prelink rmodule at 0x%x.\n",
+				      param.prelink);
+				return -1;
+			}
+
+			attr = (struct cbfs_file_attr_prelink *)
+				cbfs_add_file_attr(header,
+					CBFS_FILE_ATTR_TAG_PRELINK,
+					sizeof(struct cbfs_file_attr_prelink));
+			if (attr == NULL)
+				return -1;
+			attr->base = htonl(param.prelink);
+		}
+
 		ret = parse_elf_to_stage(buffer, &output, param.compression,
 					 offset, param.ignore_section);
+	}
 
 	if (ret != 0)
 		return -1;
@@ -692,6 +714,11 @@ static int cbfs_add_stage(void)
 			return 1;
 		}
 
+		if (param.prelink_assigned) {
+			ERROR("Cannot prelink an XIP stage.\n");
+			return 1;
+		}
+
 		if (param.compression != CBFS_COMPRESS_NONE) {
 			ERROR("Cannot specify compression for XIP.\n");
 			return 1;
@@ -1144,7 +1171,7 @@ static const struct command commands[] = {
 				true, true},
 	{"add-payload", "H:r:f:n:t:c:b:C:I:vA:gh?", cbfs_add_payload,
 				true, true},
-	{"add-stage", "a:H:r:f:n:t:c:b:P:S:yvA:gh?", cbfs_add_stage,
+	{"add-stage", "a:H:r:f:n:t:c:b:P:S:L:yvA:gh?", cbfs_add_stage,
 				true, true},
 	{"add-int", "H:r:i:n:b:vgh?", cbfs_add_integer, true, true},
 	{"add-master-header", "H:r:vh?", cbfs_add_master_header, true, true},
@@ -1188,6 +1215,7 @@ static struct option long_options[] = {
 	{"name",          required_argument, 0, 'n' },
 	{"offset",        required_argument, 0, 'o' },
 	{"page-size",     required_argument, 0, 'P' },
+	{"prelink",       required_argument, 0, 'L' },
 	{"size",          required_argument, 0, 's' },
 	{"top-aligned",   required_argument, 0, 'T' },
 	{"type",          required_argument, 0, 't' },
@@ -1275,7 +1303,8 @@ static void usage(char *name)
 			"Add a payload to the ROM\n"
 	     " add-stage [-r image,regions] -f FILE -n NAME [-A hash] \\\n"
 	     "        [-c compression] [-b base] [-S section-to-ignore] \\\n"
-	     "        [-a alignment] [-y|--xip] [-P page-size]             "
+	     "        [-a alignment] [-y|--xip] [-P page-size] \\\n"
+	     "        [-L|--prelink rmodule-base]                          "
 			"Add a stage to the ROM\n"
 	     " add-flat-binary [-r image,regions] -f FILE -n NAME \\\n"
 	     "        [-A hash] -l load-address -e entry-point \\\n"
@@ -1513,6 +1542,15 @@ int main(int argc, char **argv)
 					return 1;
 				}
 				break;
+			case 'L':
+				param.prelink = strtoul(optarg, &suffix, 0);
+				if (!*optarg || (suffix && *suffix)) {
+					ERROR("Invalid prelink base '%s'.\n",
+						optarg);
+					return 1;
+				}
+				param.prelink_assigned = 1;
+				break;
 			case 'o':
 				param.cbfsoffset = strtoul(optarg, &suffix, 0);
 				if (!*optarg || (suffix && *suffix)) {
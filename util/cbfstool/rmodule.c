@@ -697,6 +697,149 @@ static void rmod_deserialize(struct rmodule_header *rmod, struct buffer *buff,
 	rmod->padding[3] = xdr->get32(buff);
 }
 
+static void rmod_serialize(const struct rmodule_header *rmod,
+			   struct buffer *buff, struct xdr *xdr)
+{
+	buffer_set_size(buff, 0);
+	xdr->put16(buff, rmod->magic);
+	xdr->put8(buff, rmod->version);
+	xdr->put8(buff, rmod->type);
+	xdr->put32(buff, rmod->payload_begin_offset);
+	xdr->put32(buff, rmod->payload_end_offset);
+	xdr->put32(buff, rmod->relocations_begin_offset);
+	xdr->put32(buff, rmod->relocations_end_offset);
+	xdr->put32(buff, rmod->module_link_start_address);
+	xdr->put32(buff, rmod->module_program_size);
+	xdr->put32(buff, rmod->module_entry_point);
+	xdr->put32(buff, rmod->parameters_begin);
+	xdr->put32(buff, rmod->parameters_end);
+	xdr->put32(buff, rmod->bss_begin);
+	xdr->put32(buff, rmod->bss_end);
+	xdr->put32(buff, rmod->padding[0]);
+	xdr->put32(buff, rmod->padding[1]);
+	xdr->put32(buff, rmod->padding[2]);
+	xdr->put32(buff, rmod->padding[3]);
+}
+
+int rmodule_prelink(struct buffer *elf, uint32_t base)
+{
+	struct parsed_elf pelf;
+	struct rmodule_header rmod;
+	struct buffer seg, reader, writer;
+	struct xdr *xdr;
+	Elf64_Phdr *phdr = NULL;
+	size_t payload_sz, reloc_sz, i, nrelocs;
+	int64_t delta;
+	int bit64;
+	int ret = -1;
+
+	if (parse_elf(elf, &pelf, ELF_PARSE_PHDR)) {
+		ERROR("Couldn't parse ELF!\n");
+		return -1;
+	}
+
+	xdr = (pelf.ehdr.e_ident[EI_DATA] == ELFDATA2MSB) ? &xdr_be : &xdr_le;
+	bit64 = pelf.ehdr.e_ident[EI_CLASS] == ELFCLASS64;
+	reloc_sz = bit64 ? sizeof(Elf64_Addr) : sizeof(Elf32_Addr);
+
+	/* The header, program and relocations form the segment at 0. */
+	for (i = 0; i < pelf.ehdr.e_phnum; i++) {
+		if (pelf.phdr[i].p_type == PT_LOAD &&
+		    pelf.phdr[i].p_vaddr == 0) {
+			phdr = &pelf.phdr[i];
+			break;
+		}
+	}
+
+	if (phdr == NULL || phdr->p_filesz < sizeof(rmod) ||
+	    phdr->p_offset + phdr->p_filesz > buffer_size(elf)) {
+		ret = 1;
+		goto out;
+	}
+
+	buffer_splice(&seg, elf, phdr->p_offset, phdr->p_filesz);
+	buffer_clone(&reader, &seg);
+	rmod_deserialize(&rmod, &reader, xdr);
+
+	/* Indicate that file is not an rmodule if initial checks fail. */
+	if (rmod.magic != RMODULE_MAGIC || rmod.version != RMODULE_VERSION_1) {
+		ret = 1;
+		goto out;
+	}
+
+	if (rmod.payload_begin_offset > rmod.payload_end_offset ||
+	    rmod.payload_end_offset > seg.size ||
+	    rmod.relocations_begin_offset > rmod.relocations_end_offset ||
+	    rmod.relocations_end_offset > seg.size) {
+		ERROR("Rmodule fields out of bounds.\n");
+		goto out;
+	}
+
+	payload_sz = rmod.payload_end_offset - rmod.payload_begin_offset;
+	nrelocs = (rmod.relocations_end_offset -
+			rmod.relocations_begin_offset) / reloc_sz;
+	delta = (int64_t)base - rmod.module_link_start_address;
+
+	/*
+	 * Apply the relocations as the loader would for a module placed at
+	 * base, then rebase the relocation list and the header so that the
+	 * loader computes an adjustment of 0 when it is placed there.
+	 */
+	for (i = 0; i < nrelocs; i++) {
+		size_t reloc_offset = rmod.relocations_begin_offset +
+					i * reloc_sz;
+		uint64_t addr, offset, value;
+
+		buffer_splice(&reader, &seg, reloc_offset, reloc_sz);
+		addr = bit64 ? xdr->get64(&reader) : xdr->get32(&reader);
+
+		offset = addr - rmod.module_link_start_address;
+		if (addr < rmod.module_link_start_address ||
+		    offset + reloc_sz > payload_sz) {
+			ERROR("Relocation 0x%" PRIx64 " outside of the "
+			      "payload, can't prelink.\n", addr);
+			goto out;
+		}
+
+		buffer_splice(&reader, &seg,
+			      rmod.payload_begin_offset + offset, reloc_sz);
+		buffer_clone(&writer, &reader);
+		buffer_set_size(&writer, 0);
+		if (bit64) {
+			value = xdr->get64(&reader);
+			xdr->put64(&writer, value + delta);
+		} else {
+			value = xdr->get32(&reader);
+			xdr->put32(&writer, value + delta);
+		}
+
+		buffer_splice(&writer, &seg, reloc_offset, reloc_sz);
+		buffer_set_size(&writer, 0);
+		if (bit64)
+			xdr->put64(&writer, addr + delta);
+		else
+			xdr->put32(&writer, addr + delta);
+	}
+
+	rmod.module_link_start_address += delta;
+	rmod.module_entry_point += delta;
+	rmod.parameters_begin += delta;
+	rmod.parameters_end += delta;
+	rmod.bss_begin += delta;
+	rmod.bss_end += delta;
+
+	buffer_clone(&writer, &seg);
+	rmod_serialize(&rmod, &writer, xdr);
+
+	DEBUG("Prelinked rmodule at 0x%x: %zu relocations applied.\n", base,
+	      nrelocs);
+	ret = 0;
+
+out:
+	parsed_elf_destroy(&pelf);
+	return ret;
+}
+
 int rmodule_stage_to_elf(Elf64_Ehdr *ehdr, struct buffer *buff)
 {
 	struct buffer reader;
@@ -91,4 +91,13 @@ void rmodule_cleanup(struct rmod_context *ctx);
  */
 int rmodule_stage_to_elf(Elf64_Ehdr *ehdr, struct buffer *buff);
 
+/*
+ * Relocate the rmodule contained in the ELF file in the buffer in place so
+ * that it runs at base without any further relocation processing. The
+ * relocation list is kept, rebased to base, so the module can still be loaded
+ * elsewhere. Returns 1 if buff doesn't contain an rmodule and < 0 on failure,
+ * 0 on success.
+ */
+int rmodule_prelink(struct buffer *elf, uint32_t base);
+
 #endif /* TOOL_RMODULE_H */
@@ -65,10 +65,14 @@ struct mapping {
 static int verbose = 0;
 #define debug(x...) if(verbose) printf(x)
 
-/* File handle used to access /dev/mem */
+/* File handle used to access /dev/mem or a memory dump */
 static int mem_fd;
 static struct mapping lbtable_mapping;
 
+/* Physical address and size of a memory dump, mem_size is 0 for /dev/mem */
+static unsigned long long mem_base;
+static unsigned long long mem_size;
+
 static void die(const char *msg)
 {
 	if (msg)
@@ -108,11 +112,21 @@ static const void *map_memory(struct mapping *mapping, unsigned long long phys,
 {
 	void *v;
 	unsigned long long page_size;
+	unsigned long long file_offset;
 
 	page_size = system_page_size();
 
 	mapping->virt = NULL;
-	mapping->offset = phys % page_size;
+
+	if (mem_size && (phys < mem_base || phys - mem_base > mem_size ||
+			 sz > mem_size - (phys - mem_base))) {
+		debug("0x%llx + 0x%zx is outside of the memory dump.\n",
+			phys, sz);
+		return NULL;
+	}
+	file_offset = phys - mem_base;
+
+	mapping->offset = file_offset % page_size;
 	mapping->virt_size = sz + mapping->offset;
 	mapping->size = sz;
 	mapping->phys = phys;
@@ -127,7 +141,7 @@ static const void *map_memory(struct mapping *mapping, unsigned long long phys,
 	}
 
 	v = mmap(NULL, mapping->virt_size, PROT_READ, MAP_SHARED, mem_fd,
-			phys - mapping->offset);
+			file_offset - mapping->offset);
 
 	if (v == MAP_FAILED) {
 		debug("Mapping failed %zuB of physical memory at 0x%llx.\n",
@@ -584,8 +598,74 @@ uint64_t timestamp_print_entry(uint32_t id, uint64_t stamp, uint64_t prev_stamp)
 	return step_time;
 }
 
+/* Print str as a JSON string, or as a CSV field if csv is set. */
+static void print_quoted(const char *str, int csv)
+{
+	putchar('"');
+	for (; *str; str++) {
+		unsigned char c = *str;
+
+		if (csv && c == '"')
+			printf("\"\"");
+		else if (csv)
+			putchar(c);
+		else if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c < 0x20)
+			printf("\\u%04x", c);
+		else
+			putchar(c);
+	}
+	putchar('"');
+}
+
+static void timestamp_print_json_entry(uint32_t id, uint64_t stamp,
+				       uint64_t prev_stamp, int first)
+{
+	printf("%s\n    { \"id\": %u, \"name\": ", first ? "" : ",", id);
+	print_quoted(timestamp_name(id), 0);
+	printf(", \"time\": %llu, \"step\": %llu }",
+	       (unsigned long long)arch_convert_raw_ts_entry(stamp),
+	       (unsigned long long)arch_convert_raw_ts_entry(stamp - prev_stamp));
+}
+
+static void timestamp_print_csv_entry(uint32_t id, uint64_t stamp,
+				      uint64_t prev_stamp)
+{
+	printf("%u,%llu,%llu,", id,
+	       (unsigned long long)arch_convert_raw_ts_entry(stamp),
+	       (unsigned long long)arch_convert_raw_ts_entry(stamp - prev_stamp));
+	print_quoted(timestamp_name(id), 1);
+	printf("\n");
+}
+
+enum timestamps_format {
+	TIMESTAMPS_TEXT,
+	TIMESTAMPS_PARSEABLE,
+	TIMESTAMPS_JSON,
+	TIMESTAMPS_CSV,
+};
+
+static uint64_t timestamp_print(enum timestamps_format format, uint32_t id,
+				uint64_t stamp, uint64_t prev_stamp)
+{
+	switch (format) {
+	case TIMESTAMPS_PARSEABLE:
+		return timestamp_print_parseable_entry(id, stamp, prev_stamp);
+	case TIMESTAMPS_JSON:
+		timestamp_print_json_entry(id, stamp, prev_stamp, id == 0);
+		break;
+	case TIMESTAMPS_CSV:
+		timestamp_print_csv_entry(id, stamp, prev_stamp);
+		break;
+	default:
+		return timestamp_print_entry(id, stamp, prev_stamp);
+	}
+	return arch_convert_raw_ts_entry(stamp - prev_stamp);
+}
+
 /* dump the timestamp table */
-static void dump_timestamps(int mach_readable)
+static void dump_timestamps(enum timestamps_format format)
 {
 	int i;
 	const struct timestamp_table *tst_p;
@@ -606,7 +686,7 @@ static void dump_timestamps(int mach_readable)
 
 	timestamp_set_tick_freq(tst_p->tick_freq_mhz);
 
-	if (!mach_readable)
+	if (format == TIMESTAMPS_TEXT)
 		printf("%d entries total:\n\n", tst_p->num_entries);
 	size += tst_p->num_entries * sizeof(tst_p->entries[0]);
 
@@ -616,13 +696,15 @@ static void dump_timestamps(int mach_readable)
 	if (!tst_p)
 		die("Unable to map full timestamp table\n");
 
+	if (format == TIMESTAMPS_JSON)
+		printf("{\n  \"tick_freq_mhz\": %lu,\n  \"timestamps\": [",
+		       tick_freq_mhz);
+	else if (format == TIMESTAMPS_CSV)
+		printf("id,time,step,name\n");
+
 	/* Report the base time within the table. */
 	prev_stamp = 0;
-	if (mach_readable)
-		timestamp_print_parseable_entry(0,  tst_p->base_time,
-						prev_stamp);
-	else
-		timestamp_print_entry(0,  tst_p->base_time, prev_stamp);
+	timestamp_print(format, 0, tst_p->base_time, prev_stamp);
 	prev_stamp = tst_p->base_time;
 
 	total_time = 0;
@@ -632,25 +714,307 @@ static void dump_timestamps(int mach_readable)
 
 		/* Make all timestamps absolute. */
 		stamp = tse->entry_stamp + tst_p->base_time;
-		if (mach_readable)
-			total_time +=
-				timestamp_print_parseable_entry(tse->entry_id,
-							stamp, prev_stamp);
-		else
-			total_time += timestamp_print_entry(tse->entry_id,
-							stamp, prev_stamp);
+		total_time += timestamp_print(format, tse->entry_id, stamp,
+					      prev_stamp);
 		prev_stamp = stamp;
 	}
 
-	if (!mach_readable) {
+	if (format == TIMESTAMPS_TEXT) {
 		printf("\nTotal Time: ");
 		print_norm(total_time);
 		printf("\n");
+	} else if (format == TIMESTAMPS_JSON) {
+		printf("\n  ],\n  \"total_time\": %llu\n}\n",
+		       (unsigned long long)total_time);
 	}
 
 	unmap_memory(&timestamp_mapping);
 }
 
+/*
+ * Timestamp statistics over many boots, from files written by cbmem -T,
+ * --json-timestamps or --csv-timestamps. A stage is the step to the n-th
+ * occurrence of a timestamp id in a boot, plus the total of each boot.
+ */
+#define TS_TOTAL	0xffffffff
+
+struct ts_stage {
+	uint32_t id;
+	int occurrence;
+	size_t count;
+	size_t capacity;
+	uint64_t *steps;
+};
+
+struct ts_set {
+	struct ts_stage *stages;
+	size_t count;
+	int boots;
+};
+
+struct ts_stats {
+	size_t count;
+	uint64_t min;
+	uint64_t median;
+	uint64_t p95;
+	uint64_t p99;
+	uint64_t max;
+};
+
+static struct ts_stage *ts_set_stage(struct ts_set *set, uint32_t id,
+				     int occurrence)
+{
+	struct ts_stage *stage;
+	size_t i;
+
+	for (i = 0; i < set->count; i++) {
+		stage = &set->stages[i];
+		if (stage->id == id && stage->occurrence == occurrence)
+			return stage;
+	}
+
+	set->stages = realloc(set->stages,
+			      (set->count + 1) * sizeof(*set->stages));
+	if (!set->stages)
+		die("Out of memory\n");
+	stage = &set->stages[set->count++];
+	memset(stage, 0, sizeof(*stage));
+	stage->id = id;
+	stage->occurrence = occurrence;
+	return stage;
+}
+
+static void ts_stage_add(struct ts_stage *stage, uint64_t step)
+{
+	if (stage->count == stage->capacity) {
+		stage->capacity = stage->capacity ? stage->capacity * 2 : 16;
+		stage->steps = realloc(stage->steps,
+				       stage->capacity * sizeof(*stage->steps));
+		if (!stage->steps)
+			die("Out of memory\n");
+	}
+	stage->steps[stage->count++] = step;
+}
+
+/* Parse one timestamp line, return 0 if it is none. */
+static int ts_parse_line(const char *line, uint32_t *id, uint64_t *step)
+{
+	unsigned long long time, ll_step;
+	const char *p;
+
+	p = strstr(line, "\"id\":");
+	if (p) {
+		/* JSON, one timestamp per line */
+		if (sscanf(p, "\"id\": %u", id) != 1)
+			return 0;
+		p = strstr(line, "\"step\":");
+		if (!p || sscanf(p, "\"step\": %llu", &ll_step) != 1)
+			return 0;
+	} else if (sscanf(line, "%u%*[,\t]%llu%*[,\t]%llu", id, &time,
+			  &ll_step) != 3) {
+		/* Neither CSV nor parseable */
+		return 0;
+	}
+	*step = ll_step;
+	return 1;
+}
+
+static void ts_set_add_file(struct ts_set *set, const char *name)
+{
+	/* Occurrences of each id so far in this boot */
+	struct {
+		uint32_t id;
+		int count;
+	} seen[256];
+	size_t num_seen = 0, i;
+	uint64_t step, total = 0;
+	char line[256];
+	uint32_t id;
+	FILE *f;
+
+	f = fopen(name, "r");
+	if (!f) {
+		fprintf(stderr, "Failed to open %s: %s\n", name,
+			strerror(errno));
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		/* Id 0 is the base time, not a step. */
+		if (!ts_parse_line(line, &id, &step) || id == 0)
+			continue;
+
+		for (i = 0; i < num_seen; i++)
+			if (seen[i].id == id)
+				break;
+		if (i == num_seen) {
+			if (num_seen == ARRAY_SIZE(seen))
+				die("Too many different timestamps\n");
+			seen[num_seen].id = id;
+			seen[num_seen++].count = 0;
+		}
+		ts_stage_add(ts_set_stage(set, id, ++seen[i].count), step);
+		total += step;
+	}
+	fclose(f);
+
+	if (!num_seen) {
+		fprintf(stderr, "No timestamps found in %s.\n", name);
+		exit(1);
+	}
+	ts_stage_add(ts_set_stage(set, TS_TOTAL, 1), total);
+	set->boots++;
+}
+
+static int ts_compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Nearest rank percentile of sorted steps */
+static uint64_t ts_percentile(const struct ts_stage *stage, int pct)
+{
+	size_t rank = (stage->count * pct + 99) / 100;
+
+	return stage->steps[rank ? rank - 1 : 0];
+}
+
+static void ts_stage_stats(struct ts_stage *stage, struct ts_stats *stats)
+{
+	size_t n = stage->count;
+
+	qsort(stage->steps, n, sizeof(*stage->steps), ts_compare_u64);
+	stats->count = n;
+	stats->min = stage->steps[0];
+	stats->max = stage->steps[n - 1];
+	if (n % 2)
+		stats->median = stage->steps[n / 2];
+	else
+		stats->median = (stage->steps[n / 2 - 1] +
+				 stage->steps[n / 2]) / 2;
+	stats->p95 = ts_percentile(stage, 95);
+	stats->p99 = ts_percentile(stage, 99);
+}
+
+static const char *ts_stage_name(const struct ts_stage *stage)
+{
+	static char name[64];
+
+	if (stage->id == TS_TOTAL)
+		return "total";
+	if (stage->occurrence == 1)
+		return timestamp_name(stage->id);
+	snprintf(name, sizeof(name), "%s #%d", timestamp_name(stage->id),
+		 stage->occurrence);
+	return name;
+}
+
+static void ts_print_stats(struct ts_set *set)
+{
+	struct ts_stats stats;
+	size_t i;
+
+	printf("%d boots, steps in us:\n\n", set->boots);
+	printf("%4s %-36s %5s %10s %10s %10s %10s %10s\n", "id", "stage",
+	       "boots", "min", "median", "p95", "p99", "max");
+	for (i = 0; i < set->count; i++) {
+		struct ts_stage *stage = &set->stages[i];
+
+		ts_stage_stats(stage, &stats);
+		printf("%4d %-36.36s %5zu %10llu %10llu %10llu %10llu %10llu\n",
+		       stage->id == TS_TOTAL ? -1 : (int)stage->id,
+		       ts_stage_name(stage), stats.count,
+		       (unsigned long long)stats.min,
+		       (unsigned long long)stats.median,
+		       (unsigned long long)stats.p95,
+		       (unsigned long long)stats.p99,
+		       (unsigned long long)stats.max);
+	}
+}
+
+/* Change from a to b in percent */
+static double ts_change(uint64_t a, uint64_t b)
+{
+	if (a == 0)
+		return b == 0 ? 0.0 : 100.0;
+	return ((double)b - (double)a) * 100.0 / (double)a;
+}
+
+/*
+ * Compare the stages of two sets of boots and flag those whose median or
+ * p95 moved by more than threshold percent. Return the number flagged.
+ */
+static int ts_compare_sets(struct ts_set *a, struct ts_set *b,
+			   double threshold)
+{
+	struct ts_stats sa, sb;
+	int flagged = 0;
+	size_t i, j;
+
+	printf("%d boots before, %d boots after, steps in us, threshold "
+	       "%.1f%%:\n\n", a->boots, b->boots, threshold);
+	printf("%4s %-36s %10s %10s %8s %10s %10s %8s\n", "id", "stage",
+	       "median", "median", "change", "p95", "p95", "change");
+
+	for (i = 0; i < a->count; i++) {
+		struct ts_stage *stage = &a->stages[i];
+		struct ts_stage *other = NULL;
+		double dmedian, dp95;
+		int shifted;
+
+		for (j = 0; j < b->count; j++)
+			if (b->stages[j].id == stage->id &&
+			    b->stages[j].occurrence == stage->occurrence)
+				other = &b->stages[j];
+
+		ts_stage_stats(stage, &sa);
+		if (!other) {
+			printf("%4d %-36.36s %10llu %10s\n",
+			       stage->id == TS_TOTAL ? -1 : (int)stage->id,
+			       ts_stage_name(stage),
+			       (unsigned long long)sa.median, "gone");
+			flagged++;
+			continue;
+		}
+		ts_stage_stats(other, &sb);
+		dmedian = ts_change(sa.median, sb.median);
+		dp95 = ts_change(sa.p95, sb.p95);
+		shifted = dmedian > threshold || dmedian < -threshold ||
+			  dp95 > threshold || dp95 < -threshold;
+		flagged += shifted;
+
+		printf("%4d %-36.36s %10llu %10llu %+7.1f%% %10llu %10llu "
+		       "%+7.1f%%%s\n",
+		       stage->id == TS_TOTAL ? -1 : (int)stage->id,
+		       ts_stage_name(stage), (unsigned long long)sa.median,
+		       (unsigned long long)sb.median, dmedian,
+		       (unsigned long long)sa.p95, (unsigned long long)sb.p95,
+		       dp95, shifted ? "  <--" : "");
+	}
+
+	/* Stages only the second set has */
+	for (j = 0; j < b->count; j++) {
+		struct ts_stage *stage = &b->stages[j];
+
+		for (i = 0; i < a->count; i++)
+			if (a->stages[i].id == stage->id &&
+			    a->stages[i].occurrence == stage->occurrence)
+				break;
+		if (i < a->count)
+			continue;
+		ts_stage_stats(stage, &sb);
+		printf("%4d %-36.36s %10s %10llu\n", (int)stage->id,
+		       ts_stage_name(stage), "new",
+		       (unsigned long long)sb.median);
+		flagged++;
+	}
+
+	printf("\n%d stage%s shifted.\n", flagged, flagged == 1 ? "" : "s");
+	return flagged;
+}
+
 struct cbmem_console {
 	u32 size;
 	u32 cursor;
@@ -660,13 +1024,94 @@ struct cbmem_console {
 #define CBMC_CURSOR_MASK ((1 << 28) - 1)
 #define CBMC_OVERFLOW (1 << 31)
 
+/* Poll interval of cbmem -c --follow */
+#define FOLLOW_INTERVAL_US	50000
+
+/* Replace unprintable characters like '\0' from memory corruption by '?'. */
+static void sanitize_console(char *s, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (!isprint(s[i]) && !isspace(s[i]))
+			s[i] = '?';
+}
+
+/* Print body[from, to) of a console with size bytes, wrapping around. */
+static void print_console_range(const struct cbmem_console *console_p,
+				char *buf, size_t size, size_t from, size_t to)
+{
+	size_t n = 0;
+
+	if (to < from) {
+		n = size - from;
+		aligned_memcpy(buf, console_p->body + from, n);
+		from = 0;
+	}
+	aligned_memcpy(buf + n, console_p->body + from, to - from);
+	n += to - from;
+
+	sanitize_console(buf, n);
+	fwrite(buf, 1, n, stdout);
+}
+
+/*
+ * Print what is appended to the console from now on, until killed. cursor
+ * is the cursor of the part printed already. The console does not count
+ * the bytes written, so more than its size written between two polls
+ * looks like less, unless it overflows for the first time and the cursor
+ * ends up at or past where it was.
+ */
+static void follow_console(const struct cbmem_console *console_p,
+			   char *buf, size_t size, u32 cursor)
+{
+	const volatile struct cbmem_console *live = console_p;
+	size_t pos = cursor & CBMC_CURSOR_MASK;
+	u32 next;
+	size_t next_pos;
+
+	for (;;) {
+		fflush(stdout);
+		usleep(FOLLOW_INTERVAL_US);
+
+		next = live->cursor;
+		next_pos = next & CBMC_CURSOR_MASK;
+		if (next_pos > size) {
+			printf("\ncbmem: ERROR: CBMEM console cursor is illegal, "
+			       "stopping.\n");
+			return;
+		}
+		if (next == cursor)
+			continue;
+
+		if (!(next & CBMC_OVERFLOW) &&
+		    ((cursor & CBMC_OVERFLOW) || next_pos < pos)) {
+			/* The console was started over. */
+			pos = 0;
+		} else if (!(cursor & CBMC_OVERFLOW) &&
+			   (next & CBMC_OVERFLOW) && next_pos >= pos) {
+			printf("\ncbmem: WARNING: CBMEM console overflowed, "
+			       "output may be lost!\n\n");
+			/* All of the buffer is new, oldest first. */
+			print_console_range(console_p, buf, size, next_pos,
+					    size);
+			pos = 0;
+		}
+
+		print_console_range(console_p, buf, size, pos, next_pos);
+		pos = next_pos;
+		cursor = next;
+	}
+}
+
 /* dump the cbmem console */
-static void dump_console(int one_boot_only)
+static void dump_console(int one_boot_only, int follow)
 {
 	const struct cbmem_console *console_p;
 	char *console_c;
-	size_t size, cursor;
+	size_t size, cursor, console_size;
 	struct mapping console_mapping;
+	u32 console_cursor;
 
 	if (console.tag != LB_TAG_CBMEM_CONSOLE) {
 		fprintf(stderr, "No console found in coreboot table.\n");
@@ -677,28 +1122,31 @@ static void dump_console(int one_boot_only)
 	console_p = map_memory(&console_mapping, console.cbmem_addr, size);
 	if (!console_p)
 		die("Unable to map console object.\n");
+	console_size = console_p->size;
+	unmap_memory(&console_mapping);
+
+	/* Map all of it once, a follow reads the rest from this mapping. */
+	console_p = map_memory(&console_mapping, console.cbmem_addr,
+		console_size + sizeof(*console_p));
 
-	cursor = console_p->cursor & CBMC_CURSOR_MASK;
-	if (!(console_p->cursor & CBMC_OVERFLOW) && cursor < console_p->size)
+	if (!console_p)
+		die("Unable to map full console object.\n");
+
+	console_cursor = console_p->cursor;
+	cursor = console_cursor & CBMC_CURSOR_MASK;
+	if (!(console_cursor & CBMC_OVERFLOW) && cursor < console_size)
 		size = cursor;
 	else
-		size = console_p->size;
-	unmap_memory(&console_mapping);
+		size = console_size;
 
-	console_c = malloc(size + 1);
+	console_c = malloc(console_size + 1);
 	if (!console_c) {
 		fprintf(stderr, "Not enough memory for console.\n");
 		exit(1);
 	}
 	console_c[size] = '\0';
 
-	console_p = map_memory(&console_mapping, console.cbmem_addr,
-		size + sizeof(*console_p));
-
-	if (!console_p)
-		die("Unable to map full console object.\n");
-
-	if (console_p->cursor & CBMC_OVERFLOW) {
+	if (console_cursor & CBMC_OVERFLOW) {
 		if (cursor >= size) {
 			printf("cbmem: ERROR: CBMEM console struct is illegal, "
 			       "output may be corrupt or out of order!\n\n");
@@ -714,9 +1162,7 @@ static void dump_console(int one_boot_only)
 
 	/* Slight memory corruption may occur between reboots and give us a few
 	   unprintable characters like '\0'. Replace them with '?' on output. */
-	for (cursor = 0; cursor < size; cursor++)
-		if (!isprint(console_c[cursor]) && !isspace(console_c[cursor]))
-			console_c[cursor] = '?';
+	sanitize_console(console_c, size);
 
 	/* We detect the last boot by looking for a bootblock, romstage or
 	   ramstage banner, in that order (to account for platforms without
@@ -745,7 +1191,15 @@ static void dump_console(int one_boot_only)
 		}
 	}
 
-	puts(console_c + cursor);
+	if (follow) {
+		/* Carry on where this ends, without a newline in between. */
+		fputs(console_c + cursor, stdout);
+		if ((console_cursor & CBMC_CURSOR_MASK) <= console_size)
+			follow_console(console_p, console_c, console_size,
+				       console_cursor);
+	} else {
+		puts(console_c + cursor);
+	}
 	free(console_c);
 	unmap_memory(&console_mapping);
 }
@@ -1026,18 +1480,37 @@ static void print_version(void)
     "GNU General Public License for more details.\n\n");
 }
 
+/* Long options without a short one */
+enum {
+	OPT_CSV_TIMESTAMPS = 256,
+	OPT_THRESHOLD,
+};
+
 static void print_usage(const char *name, int exit_code)
 {
-	printf("usage: %s [-cCltTxVvh?]\n", name);
+	printf("usage: %s [-cFCltTjxVvh?] [-f FILE [-b ADDRESS]]\n", name);
+	printf("       %s -a [--threshold PERCENT] FILE... [-- FILE...]\n",
+	       name);
 	printf("\n"
 	     "   -c | --console:                   print cbmem console\n"
 	     "   -1 | --oneboot:                   print cbmem console for last boot only\n"
+	     "   -F | --follow:                    print cbmem console, then what is appended\n"
 	     "   -C | --coverage:                  dump coverage information\n"
 	     "   -l | --list:                      print cbmem table of contents\n"
 	     "   -x | --hexdump:                   print hexdump of cbmem area\n"
 	     "   -r | --rawdump ID:                print rawdump of specific ID (in hex) of cbtable\n"
 	     "   -t | --timestamps:                print timestamp information\n"
 	     "   -T | --parseable-timestamps:      print parseable timestamps\n"
+	     "   -j | --json-timestamps:           print timestamps as JSON\n"
+	     "        --csv-timestamps:            print timestamps as CSV\n"
+	     "   -a | --aggregate:                 print statistics of the boots\n"
+	     "                                     in the timestamp FILEs, or\n"
+	     "                                     compare those before and\n"
+	     "                                     after --\n"
+	     "        --threshold PERCENT:         flag stages whose median or\n"
+	     "                                     p95 changed more (default 10)\n"
+	     "   -f | --from-file FILE:            read memory from a dump instead of /dev/mem\n"
+	     "   -b | --base ADDRESS:              physical address of the dump (default 0)\n"
 	     "   -V | --verbose:                   verbose (debugging) output\n"
 	     "   -v | --version:                   print the version\n"
 	     "   -h | --help:                      print this help\n"
@@ -1160,6 +1633,75 @@ static char *dt_find_compat(const char *parent, const char *compat,
 }
 #endif /* __arm__ */
 
+/* Find the coreboot table of the running system. Return < 0 on error. */
+static int find_cbtable(void)
+{
+#ifdef __arm__
+	int addr_cells, size_cells;
+	char *coreboot_node = dt_find_compat("/proc/device-tree", "coreboot",
+					     &addr_cells, &size_cells);
+
+	if (!coreboot_node) {
+		fprintf(stderr, "Could not find 'coreboot' compatible node!\n");
+		return -1;
+	}
+
+	if (addr_cells < 0) {
+		fprintf(stderr, "Warning: no #address-cells node in tree!\n");
+		addr_cells = 1;
+	}
+
+	int nlen = strlen(coreboot_node);
+	char *reg = alloca(nlen + sizeof("/reg"));
+
+	strcpy(reg, coreboot_node);
+	strcpy(reg + nlen, "/reg");
+	free(coreboot_node);
+
+	int fd = open(reg, O_RDONLY);
+	if (fd < 0) {
+		perror(reg);
+		return -1;
+	}
+
+	int i;
+	size_t size_to_read = addr_cells * 4 + size_cells * 4;
+	u8 *dtbuffer = alloca(size_to_read);
+	if (read(fd, dtbuffer, size_to_read) < 0) {
+		perror(reg);
+		return -1;
+	}
+	close(fd);
+
+	/* No variable-length byte swap function anywhere in C... how sad. */
+	u64 baseaddr = 0;
+	for (i = 0; i < addr_cells * 4; i++) {
+		baseaddr <<= 8;
+		baseaddr |= *dtbuffer;
+		dtbuffer++;
+	}
+	u64 cb_table_size = 0;
+	for (i = 0; i < size_cells * 4; i++) {
+		cb_table_size <<= 8;
+		cb_table_size |= *dtbuffer;
+		dtbuffer++;
+	}
+
+	parse_cbtable(baseaddr, cb_table_size);
+#else
+	int j;
+	unsigned long long possible_base_addresses[] = { 0, 0xf0000 };
+
+	/* Find and parse coreboot table */
+	for (j = 0; j < ARRAY_SIZE(possible_base_addresses); j++) {
+		if (!parse_cbtable(possible_base_addresses[j], 0))
+			break;
+	}
+#endif
+
+	return 0;
+}
+
 int main(int argc, char** argv)
 {
 	int print_defaults = 1;
@@ -1169,26 +1711,46 @@ int main(int argc, char** argv)
 	int print_hexdump = 0;
 	int print_rawdump = 0;
 	int print_timestamps = 0;
-	int machine_readable_timestamps = 0;
+	enum timestamps_format timestamps_format = TIMESTAMPS_TEXT;
+	int aggregate = 0;
+	double threshold = 10.0;
+	int split;
 	int one_boot_only = 0;
+	int follow = 0;
 	unsigned int rawdump_id = 0;
+	const char *mem_file = NULL;
+	int has_base = 0;
+	char *endp;
+	struct stat st;
 
 	int opt, option_index = 0;
 	static struct option long_options[] = {
 		{"console", 0, 0, 'c'},
 		{"oneboot", 0, 0, '1'},
+		{"follow", 0, 0, 'F'},
 		{"coverage", 0, 0, 'C'},
 		{"list", 0, 0, 'l'},
 		{"timestamps", 0, 0, 't'},
 		{"parseable-timestamps", 0, 0, 'T'},
+		{"json-timestamps", 0, 0, 'j'},
+		{"csv-timestamps", 0, 0, OPT_CSV_TIMESTAMPS},
+		{"aggregate", 0, 0, 'a'},
+		{"threshold", required_argument, 0, OPT_THRESHOLD},
 		{"hexdump", 0, 0, 'x'},
 		{"rawdump", required_argument, 0, 'r'},
+		{"from-file", required_argument, 0, 'f'},
+		{"base", required_argument, 0, 'b'},
 		{"verbose", 0, 0, 'V'},
 		{"version", 0, 0, 'v'},
 		{"help", 0, 0, 'h'},
 		{0, 0, 0, 0}
 	};
-	while ((opt = getopt_long(argc, argv, "c1CltTxVvh?r:",
+	/* In aggregate mode, the files after -- are the second set. */
+	for (split = 1; split < argc; split++)
+		if (!strcmp(argv[split], "--"))
+			break;
+
+	while ((opt = getopt_long(split, argv, "c1FCltTjaxVvh?r:f:b:",
 				  long_options, &option_index)) != EOF) {
 		switch (opt) {
 		case 'c':
@@ -1200,6 +1762,11 @@ int main(int argc, char** argv)
 			one_boot_only = 1;
 			print_defaults = 0;
 			break;
+		case 'F':
+			print_console = 1;
+			follow = 1;
+			print_defaults = 0;
+			break;
 		case 'C':
 			print_coverage = 1;
 			print_defaults = 0;
@@ -1223,9 +1790,38 @@ int main(int argc, char** argv)
 			break;
 		case 'T':
 			print_timestamps = 1;
-			machine_readable_timestamps = 1;
+			timestamps_format = TIMESTAMPS_PARSEABLE;
 			print_defaults = 0;
 			break;
+		case 'j':
+			print_timestamps = 1;
+			timestamps_format = TIMESTAMPS_JSON;
+			print_defaults = 0;
+			break;
+		case OPT_CSV_TIMESTAMPS:
+			print_timestamps = 1;
+			timestamps_format = TIMESTAMPS_CSV;
+			print_defaults = 0;
+			break;
+		case 'a':
+			aggregate = 1;
+			break;
+		case OPT_THRESHOLD:
+			threshold = strtod(optarg, NULL);
+			break;
+		case 'f':
+			mem_file = optarg;
+			break;
+		case 'b':
+			errno = 0;
+			mem_base = strtoull(optarg, &endp, 0);
+			if (errno || endp == optarg || *endp != '\0') {
+				fprintf(stderr, "Invalid base address %s.\n",
+					optarg);
+				print_usage(argv[0], 1);
+			}
+			has_base = 1;
+			break;
 		case 'V':
 			verbose = 1;
 			break;
@@ -1243,81 +1839,64 @@ int main(int argc, char** argv)
 		}
 	}
 
-	mem_fd = open("/dev/mem", O_RDONLY, 0);
-	if (mem_fd < 0) {
-		fprintf(stderr, "Failed to gain memory access: %s\n",
-			strerror(errno));
-		return 1;
+	/* map_memory() offsets by the base, which is wrong for /dev/mem. */
+	if (has_base && !mem_file) {
+		fprintf(stderr, "-b needs a memory dump given with -f.\n");
+		print_usage(argv[0], 1);
 	}
 
-#ifdef __arm__
-	int addr_cells, size_cells;
-	char *coreboot_node = dt_find_compat("/proc/device-tree", "coreboot",
-					     &addr_cells, &size_cells);
-
-	if (!coreboot_node) {
-		fprintf(stderr, "Could not find 'coreboot' compatible node!\n");
-		return 1;
-	}
+	if (aggregate) {
+		struct ts_set before = { 0 }, after = { 0 };
+		int i;
 
-	if (addr_cells < 0) {
-		fprintf(stderr, "Warning: no #address-cells node in tree!\n");
-		addr_cells = 1;
+		if (optind >= split)
+			print_usage(argv[0], 1);
+		for (i = optind; i < split; i++)
+			ts_set_add_file(&before, argv[i]);
+		if (split >= argc) {
+			ts_print_stats(&before);
+			return 0;
+		}
+		if (split + 1 >= argc)
+			print_usage(argv[0], 1);
+		for (i = split + 1; i < argc; i++)
+			ts_set_add_file(&after, argv[i]);
+		return ts_compare_sets(&before, &after, threshold) ? 1 : 0;
 	}
 
-	int nlen = strlen(coreboot_node);
-	char *reg = alloca(nlen + sizeof("/reg"));
-
-	strcpy(reg, coreboot_node);
-	strcpy(reg + nlen, "/reg");
-	free(coreboot_node);
-
-	int fd = open(reg, O_RDONLY);
-	if (fd < 0) {
-		perror(reg);
-		return 1;
+	if (mem_file) {
+		mem_fd = open(mem_file, O_RDONLY, 0);
+		if (mem_fd < 0 || fstat(mem_fd, &st)) {
+			fprintf(stderr, "Failed to open %s: %s\n", mem_file,
+				strerror(errno));
+			return 1;
+		}
+		mem_size = st.st_size;
+		if (!mem_size) {
+			fprintf(stderr, "%s is empty.\n", mem_file);
+			return 1;
+		}
+	} else {
+		mem_fd = open("/dev/mem", O_RDONLY, 0);
+		if (mem_fd < 0) {
+			fprintf(stderr, "Failed to gain memory access: %s\n",
+				strerror(errno));
+			return 1;
+		}
 	}
 
-	int i;
-	size_t size_to_read = addr_cells * 4 + size_cells * 4;
-	u8 *dtbuffer = alloca(size_to_read);
-	if (read(fd, dtbuffer, size_to_read) < 0) {
-		perror(reg);
+	if (mem_size) {
+		/* A memory dump need not start at 0, search all of it. */
+		parse_cbtable(mem_base, mem_size);
+	} else if (find_cbtable()) {
 		return 1;
 	}
-	close(fd);
-
-	/* No variable-length byte swap function anywhere in C... how sad. */
-	u64 baseaddr = 0;
-	for (i = 0; i < addr_cells * 4; i++) {
-		baseaddr <<= 8;
-		baseaddr |= *dtbuffer;
-		dtbuffer++;
-	}
-	u64 cb_table_size = 0;
-	for (i = 0; i < size_cells * 4; i++) {
-		cb_table_size <<= 8;
-		cb_table_size |= *dtbuffer;
-		dtbuffer++;
-	}
-
-	parse_cbtable(baseaddr, cb_table_size);
-#else
-	int j;
-	unsigned long long possible_base_addresses[] = { 0, 0xf0000 };
-
-	/* Find and parse coreboot table */
-	for (j = 0; j < ARRAY_SIZE(possible_base_addresses); j++) {
-		if (!parse_cbtable(possible_base_addresses[j], 0))
-			break;
-	}
-#endif
 
 	if (mapping_virt(&lbtable_mapping) == NULL)
 		die("Table not found.\n");
 
 	if (print_console)
-		dump_console(one_boot_only);
+		dump_console(one_boot_only, follow);
 
 	if (print_coverage)
 		dump_coverage();
@@ -1332,7 +1911,7 @@ int main(int argc, char** argv)
 		dump_cbmem_raw(rawdump_id);
 
 	if (print_defaults || print_timestamps)
-		dump_timestamps(machine_readable_timestamps);
+		dump_timestamps(timestamps_format);
 
 	unmap_memory(&lbtable_mapping);
 
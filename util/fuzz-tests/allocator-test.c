@@ -0,0 +1,491 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test and benchmark for the resource allocator in src/device/device.c
+ *
+ * Builds random device trees like a PCI domain looks after enumeration: a
+ * northbridge with fixed DRAM, MMCONF and APIC ranges, an LPC bridge with
+ * the fixed legacy I/O ports, and devices and bridges with random I/O and
+ * memory BARs. Runs dev_configure() on them and checks that every resource
+ * was placed, aligned, inside the window of its bus, off the legacy I/O
+ * aliases and the fixed ranges, and that no two resources overlap unless
+ * one is a bridge window the other is behind. Then reports the time
+ * dev_configure() takes for buses of increasing size.
+ *
+ * With RESOURCE_ALLOCATOR_SORTED, the domain also gets a memory window
+ * above 4 GiB, the 64-bit prefetchable BARs below it have to end up there,
+ * and there are fixed ranges in the middle of the window below 4 GiB. The
+ * original allocator can only use one side of such ranges.
+ */
+
+#include <console/console.h>
+#include <device/device.h>
+#include <device/pci_def.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test-helpers.h"
+
+#define DEFAULT_ROUNDS	500
+#define MAX_DEPTH	3		/* of bridges below the domain */
+#define MAX_IO_BARS	12
+#define MAX_DEMAND	(256 * MiB)	/* of memory per tree */
+#define MAX_RANGES	16
+
+#define IO_LIMIT	0xffffULL
+#define MEM_LIMIT	0xffffffffULL
+#define TOLM		0x80000000ULL
+#define MMCONF_SIZE	(CONFIG_MMCONF_BUS_NUMBER * MiB)
+#define FOUR_GIB	(1ULL << 32)
+#define TOUUD		(8ULL << 30)
+#define HIGH_LIMIT	((1ULL << 36) - 1)
+
+#if IS_ENABLED(CONFIG_RESOURCE_ALLOCATOR_SORTED)
+#define ALLOCATOR	"sorted"
+#else
+#define ALLOCATOR	"original"
+#endif
+
+struct range {
+	unsigned long type;
+	resource_t base, end;
+};
+
+static struct bus root_bus = { .dev = &dev_root };
+struct device dev_root = {
+	.path = { .type = DEVICE_PATH_ROOT },
+	.enabled = 1,
+	.link_list = &root_bus,
+};
+struct device *last_dev = &dev_root;
+
+/* The domain windows and the fixed ranges of the tree */
+static struct range windows[MAX_RANGES], fixed[MAX_RANGES];
+static int num_windows, num_fixed;
+static resource_t demand;
+static int io_bars;
+
+int do_printk(int msg_level, const char *fmt, ...)
+{
+	return 0;
+}
+
+void __attribute__((noreturn)) die(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	exit(1);
+}
+
+void post_code(u8 value)
+{
+}
+
+/* The resources are added when the tree is built. */
+static void read_nothing(struct device *dev)
+{
+}
+
+static void set_nothing(struct device *dev)
+{
+}
+
+static void set_link_resources(struct device *dev)
+{
+	assign_resources(dev->link_list);
+}
+
+static struct device_operations device_ops = {
+	.read_resources = read_nothing,
+	.set_resources = set_nothing,
+};
+
+static struct device_operations bridge_ops = {
+	.read_resources = read_nothing,
+	.set_resources = set_link_resources,
+};
+
+static struct device *add_dev(struct bus *bus, enum device_path_type type,
+			      unsigned int devfn)
+{
+	struct device_path path = { .type = type };
+	struct device *dev;
+
+	if (type == DEVICE_PATH_PCI)
+		path.pci.devfn = devfn;
+	dev = alloc_dev(bus, &path);
+	dev->ops = &device_ops;
+	return dev;
+}
+
+static struct bus *add_link(struct device *dev)
+{
+	struct bus *link = calloc(1, sizeof(*link));
+
+	link->dev = dev;
+	dev->link_list = link;
+	dev->ops = &bridge_ops;
+	return link;
+}
+
+/* A domain window, like pci_domain_read_resources() adds */
+static void add_window(struct device *dev, unsigned long index,
+		       unsigned long type, resource_t base, resource_t limit)
+{
+	struct resource *res = new_resource(dev, IOINDEX_SUBTRACTIVE(index, 0));
+
+	res->base = base;
+	res->limit = limit;
+	res->flags = type | IORESOURCE_SUBTRACTIVE | IORESOURCE_ASSIGNED;
+	windows[num_windows++] = (struct range){ type, base, limit };
+}
+
+static void add_fixed(struct device *dev, unsigned long index,
+		      unsigned long type, resource_t base, resource_t size)
+{
+	struct resource *res = new_resource(dev, index);
+
+	res->base = base;
+	res->size = size;
+	res->flags = type | IORESOURCE_FIXED | IORESOURCE_ASSIGNED;
+	fixed[num_fixed++] = (struct range){ type, base, base + size - 1 };
+}
+
+static void add_bar(struct device *dev, unsigned long index,
+		    unsigned long flags, int align, resource_t limit)
+{
+	struct resource *res = new_resource(dev, index);
+
+	res->size = 1ULL << align;
+	res->align = res->gran = align;
+	res->limit = limit;
+	res->flags = flags;
+	if (flags & IORESOURCE_MEM)
+		demand += res->size;
+}
+
+/* The windows pci_bridge_read_bases() finds on a 64-bit bridge */
+static void add_bridge_windows(struct device *dev)
+{
+	static const struct {
+		unsigned long index, flags;
+		int gran;
+		resource_t limit;
+	} bases[] = {
+		{ 0x1c, IORESOURCE_IO, 12, IO_LIMIT },
+		{ 0x20, IORESOURCE_MEM, 20, MEM_LIMIT },
+		{ 0x24, IORESOURCE_MEM | IORESOURCE_PREFETCH, 20, ~0ULL },
+	};
+	struct resource *res;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(bases); i++) {
+		res = new_resource(dev, bases[i].index);
+		res->gran = res->align = bases[i].gran;
+		res->limit = bases[i].limit;
+		res->flags = bases[i].flags | IORESOURCE_PCI_BRIDGE |
+			     IORESOURCE_BRIDGE;
+	}
+}
+
+static void random_bus(struct bus *bus, int depth);
+
+static void random_device(struct bus *bus, unsigned int devfn, int depth)
+{
+	struct device *dev = add_dev(bus, DEVICE_PATH_PCI, devfn);
+	int i, bars = 1 + rand() % 3;
+
+	if (depth < MAX_DEPTH && rand() % 6 == 0) {
+		random_bus(add_link(dev), depth + 1);
+		add_bridge_windows(dev);
+		return;
+	}
+
+	for (i = 0; i < bars; i++) {
+		unsigned long index = 0x10 + 4 * i;
+
+		switch (rand() % 8) {
+		case 0:
+		case 1:
+			if (io_bars < MAX_IO_BARS) {
+				add_bar(dev, index, IORESOURCE_IO,
+					2 + rand() % 5, IO_LIMIT);
+				io_bars++;
+				break;
+			}
+			/* fall through */
+		case 2:
+		case 3:
+			add_bar(dev, index, IORESOURCE_MEM |
+				IORESOURCE_PREFETCH | IORESOURCE_PCI64,
+				12 + rand() % 13, ~0ULL);
+			break;
+		default:
+			add_bar(dev, index, IORESOURCE_MEM, 12 + rand() % 10,
+				MEM_LIMIT);
+			break;
+		}
+	}
+}
+
+static void random_bus(struct bus *bus, int depth)
+{
+	int i, n = 1 + rand() % 8;
+
+	for (i = 0; i < n && demand < MAX_DEMAND; i++)
+		random_device(bus, PCI_DEVFN(i, 0), depth);
+}
+
+/* A domain with the northbridge and the LPC bridge, return its bus. */
+static struct bus *add_domain(void)
+{
+	struct device *domain, *nb, *lpc;
+	struct bus *bus;
+
+	domain = add_dev(&root_bus, DEVICE_PATH_DOMAIN, 0);
+	bus = add_link(domain);
+	add_window(domain, 0, IORESOURCE_IO, 0, IO_LIMIT);
+	add_window(domain, 1, IORESOURCE_MEM, 0, MEM_LIMIT);
+
+	nb = add_dev(bus, DEVICE_PATH_PCI, PCI_DEVFN(0, 0));
+	add_fixed(nb, 0x60, IORESOURCE_MEM, 0, TOLM);
+	add_fixed(nb, 0x61, IORESOURCE_MEM, CONFIG_MMCONF_BASE_ADDRESS,
+		  MMCONF_SIZE);
+	add_fixed(nb, 0x62, IORESOURCE_MEM, 0xfec00000, 0x1400000);
+	lpc = add_dev(bus, DEVICE_PATH_PCI, PCI_DEVFN(0x1f, 0));
+	add_fixed(lpc, 0x60, IORESOURCE_IO, 0, 0x1000);
+
+#if IS_ENABLED(CONFIG_RESOURCE_ALLOCATOR_SORTED)
+	add_window(domain, 2, IORESOURCE_MEM, FOUR_GIB, HIGH_LIMIT);
+	add_fixed(nb, 0x63, IORESOURCE_MEM, FOUR_GIB, TOUUD - FOUR_GIB);
+#endif
+	return bus;
+}
+
+static int in_range(const struct range *r, unsigned long type,
+		    resource_t base, resource_t end)
+{
+	return r->type == type && r->base <= base && end <= r->end;
+}
+
+static int overlaps(const struct range *a, const struct range *b)
+{
+	return a->type == b->type && a->base <= b->end && b->base <= a->end;
+}
+
+static int behind(struct device *dev, struct device *bridge)
+{
+	while (dev->bus->dev != dev) {
+		dev = dev->bus->dev;
+		if (dev == bridge)
+			return 1;
+	}
+	return 0;
+}
+
+/* The window of the bridge or domain the resource is behind */
+static int in_parent_window(struct device *dev, struct resource *res,
+			    const struct range *r)
+{
+	struct device *parent = dev->bus->dev;
+	unsigned long type_mask = IORESOURCE_TYPE_MASK | IORESOURCE_PREFETCH;
+	struct resource *window;
+	int i;
+
+	if (parent->path.type == DEVICE_PATH_DOMAIN) {
+		for (i = 0; i < num_windows; i++)
+			if (in_range(&windows[i], r->type, r->base, r->end))
+				return 1;
+		return 0;
+	}
+
+	for (window = parent->resource_list; window; window = window->next)
+		if ((window->flags & IORESOURCE_BRIDGE) &&
+		    (window->flags & IORESOURCE_ASSIGNED) &&
+		    (window->flags & type_mask) == (res->flags & type_mask))
+			return window->base <= r->base &&
+				r->end <= window->base + window->size - 1;
+	return 0;
+}
+
+static int check(const char *op)
+{
+	static struct range placed[4096];
+	static struct device *owner[ARRAY_SIZE(placed)];
+	static struct resource *owner_res[ARRAY_SIZE(placed)];
+	struct device *dev;
+	struct resource *res;
+	int i, j, n = 0;
+
+	for (dev = all_devices; dev; dev = dev->next) {
+		if (dev->path.type != DEVICE_PATH_PCI)
+			continue;
+
+		for (res = dev->resource_list; res; res = res->next) {
+			struct range r;
+
+			if ((res->flags & IORESOURCE_FIXED) || !res->size)
+				continue;
+			if (!(res->flags & IORESOURCE_ASSIGNED))
+				return check_failed(op, "%s %02lx was not "
+						    "placed", dev_path(dev),
+						    res->index);
+
+			r.type = res->flags & IORESOURCE_TYPE_MASK;
+			r.base = res->base;
+			r.end = res->base + res->size - 1;
+
+			if (r.base & ((1ULL << res->align) - 1))
+				return check_failed(op, "%s %02lx at %llx is "
+						    "not aligned",
+						    dev_path(dev), res->index,
+						    r.base);
+			if (!in_parent_window(dev, res, &r))
+				return check_failed(op, "%s %02lx at %llx is "
+						    "outside its window",
+						    dev_path(dev), res->index,
+						    r.base);
+			if ((r.type == IORESOURCE_IO && r.end > IO_LIMIT) ||
+			    (!(res->flags & IORESOURCE_PREFETCH) &&
+			     r.end > MEM_LIMIT))
+				return check_failed(op, "%s %02lx at %llx is "
+						    "above its limit",
+						    dev_path(dev), res->index,
+						    r.base);
+			if (r.type == IORESOURCE_IO &&
+			    !(res->flags & IORESOURCE_BRIDGE) &&
+			    (r.base & 0x3ff) + res->size > 0x100)
+				return check_failed(op, "%s %02lx at %llx "
+						    "aliases legacy I/O",
+						    dev_path(dev), res->index,
+						    r.base);
+			for (i = 0; i < num_fixed; i++)
+				if (overlaps(&r, &fixed[i]))
+					return check_failed(op, "%s %02lx at "
+							    "%llx is over a fixed "
+							    "range",
+							    dev_path(dev),
+							    res->index, r.base);
+#if IS_ENABLED(CONFIG_RESOURCE_ALLOCATOR_SORTED)
+			if ((res->flags & IORESOURCE_PREFETCH) &&
+			    dev->bus->dev->path.type == DEVICE_PATH_DOMAIN &&
+			    r.base < FOUR_GIB)
+				return check_failed(op, "%s %02lx at %llx is "
+						    "below 4 GiB",
+						    dev_path(dev), res->index,
+						    r.base);
+#endif
+
+			if (n == ARRAY_SIZE(placed))
+				return check_failed(op, "too many resources");
+			placed[n] = r;
+			owner[n] = dev;
+			owner_res[n] = res;
+			n++;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			if (!overlaps(&placed[i], &placed[j]))
+				continue;
+			if ((owner_res[i]->flags & IORESOURCE_BRIDGE) &&
+			    behind(owner[j], owner[i]))
+				continue;
+			if ((owner_res[j]->flags & IORESOURCE_BRIDGE) &&
+			    behind(owner[i], owner[j]))
+				continue;
+			return check_failed(op, "%s %02lx and %s %02lx overlap",
+					    dev_path(owner[i]),
+					    owner_res[i]->index,
+					    dev_path(owner[j]),
+					    owner_res[j]->index);
+		}
+	}
+	return 0;
+}
+
+static int random_round(int seed)
+{
+	struct bus *bus;
+	int i;
+
+	srand(seed);
+	bus = add_domain();
+	random_bus(bus, 0);
+
+#if IS_ENABLED(CONFIG_RESOURCE_ALLOCATOR_SORTED)
+	/* Fixed ranges where the original allocator has no good side */
+	for (i = 0; i < 1 + rand() % 3; i++) {
+		struct device *dev = add_dev(bus, DEVICE_PATH_PNP, 0);
+		resource_t size = (1 + rand() % 64) * MiB;
+
+		add_fixed(dev, 0, IORESOURCE_MEM, TOLM + (rand() % 1024) * MiB,
+			  size);
+	}
+#else
+	(void)i;
+#endif
+
+	dev_configure();
+	return check("dev_configure") ? 1 : 0;
+}
+
+/* Time dev_configure() with n devices behind four bridges */
+static int bench(int n)
+{
+	struct bus *bus, *link = NULL;
+	struct device *dev;
+	double start, elapsed;
+	int i;
+
+	srand(n);
+	bus = add_domain();
+	for (i = 0; i < n; i++) {
+		if (i % (n / 4) == 0) {
+			dev = add_dev(bus, DEVICE_PATH_PCI, PCI_DEVFN(i / 4, 0));
+			link = add_link(dev);
+			add_bridge_windows(dev);
+		}
+		dev = add_dev(link, DEVICE_PATH_PCI, i % 256);
+		add_bar(dev, 0x10, IORESOURCE_MEM, 12 + rand() % 5, MEM_LIMIT);
+		add_bar(dev, 0x14, IORESOURCE_MEM | IORESOURCE_PREFETCH |
+			IORESOURCE_PCI64, 12 + rand() % 5, ~0ULL);
+	}
+
+	start = now();
+	dev_configure();
+	elapsed = now() - start;
+
+	printf("%5d devices: %9.3f ms\n", n, elapsed * 1e3);
+	return check("bench") ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = test_rounds(argc, argv, DEFAULT_ROUNDS);
+	int r;
+
+	for (r = 0; r < rounds; r++)
+		if (run_forked(random_round, r + 1)) {
+			printf("allocator (%s): FAILED in round %d\n",
+			       ALLOCATOR, r + 1);
+			return 1;
+		}
+	printf("allocator (%s): %d random trees passed\n", ALLOCATOR, rounds);
+
+	if (run_forked(bench, 100) || run_forked(bench, 500) ||
+	    run_forked(bench, 2000))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,468 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Synthetic CBMEM image generator for util/cbmem
+ *
+ * Writes a memory image of [base, base + size) like the one a system left
+ * after booting coreboot: CBMEM at the top, laid out by src/lib/imd.c,
+ * holding a timestamp table, a CBMEM console and the coreboot table that
+ * points to them, and a forwarding table at 0x500 if the image covers it.
+ * The timestamps of a boot vary with the seed and one step can be made
+ * slower, the console may be wrapped around.
+ *
+ * If an output prefix is given, the timestamps and the console are also
+ * written the way cbmem -T and cbmem -c should print them, to
+ * <prefix>.timestamps and <prefix>.console.
+ *
+ * With -A, it instead appends to the console of an existing image in
+ * place, a line every millisecond, like firmware logging at runtime, and
+ * writes what cbmem -F should print for it to <prefix>.follow.
+ */
+
+#include <cbmem.h>
+#include <commonlib/cbmem_id.h>
+#include <commonlib/coreboot_tables.h>
+#include <commonlib/timestamp_serialized.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <imd.h>
+#include <ip_checksum.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEFAULT_SIZE		(1 << 20)
+#define DEFAULT_CONSOLE_SIZE	0x2000
+#define CBTABLE_SIZE		0x1000
+#define FORWARD_TABLE		0x500
+#define TICK_FREQ_MHZ		1000
+
+/* Like src/lib/cbmem_console.c */
+struct cbmem_console {
+	u32 size;
+	u32 cursor;
+	u8  body[0];
+} __packed;
+
+#define CBMC_CURSOR_MASK	((1 << 28) - 1)
+#define CBMC_OVERFLOW		(1U << 31)
+
+/* A boot: the stages and their typical duration in us */
+static const struct {
+	u32 id;
+	u32 us;
+} boot_steps[] = {
+	{ TS_START_BOOTBLOCK, 0 },
+	{ TS_END_BOOTBLOCK, 2500 },
+	{ TS_START_ROMSTAGE, 8000 },
+	{ TS_BEFORE_INITRAM, 1200 },
+	{ TS_AFTER_INITRAM, 95000 },
+	{ TS_END_ROMSTAGE, 3000 },
+	{ TS_START_COPYRAM, 400 },
+	{ TS_END_COPYRAM, 9000 },
+	{ TS_START_RAMSTAGE, 300 },
+	{ TS_DEVICE_ENUMERATE, 2200 },
+	{ TS_DEVICE_CONFIGURE, 18000 },
+	{ TS_DEVICE_ENABLE, 1500 },
+	{ TS_DEVICE_INITIALIZE, 700 },
+	{ TS_DEVICE_DONE, 42000 },
+	{ TS_CBMEM_POST, 500 },
+	{ TS_WRITE_TABLES, 600 },
+	{ TS_LOAD_PAYLOAD, 3500 },
+	{ TS_SELFBOOT_JUMP, 12000 },
+};
+
+static u8 *mem;
+static unsigned long long base;
+
+/* Id of the timestamp whose step takes half again as long, if any */
+static u32 slow_id;
+
+static u64 phys(const void *p)
+{
+	return base + ((const u8 *)p - mem);
+}
+
+static void *lb_add(struct lb_header *head, u32 tag, u32 size)
+{
+	struct lb_record *rec = (void *)((u8 *)(head + 1) + head->table_bytes);
+
+	rec->tag = tag;
+	rec->size = size;
+	head->table_bytes += size;
+	head->table_entries++;
+	return rec;
+}
+
+static void lb_init(struct lb_header *head)
+{
+	memcpy(head->signature, "LBIO", 4);
+	head->header_bytes = sizeof(*head);
+}
+
+static void lb_fini(struct lb_header *head)
+{
+	head->table_checksum = compute_ip_checksum(head + 1, head->table_bytes);
+	head->header_checksum = 0;
+	head->header_checksum = compute_ip_checksum(head, sizeof(*head));
+}
+
+static struct timestamp_table *add_timestamps(struct imd *imd)
+{
+	const size_t n = ARRAY_SIZE(boot_steps);
+	const struct imd_entry *e;
+	struct timestamp_table *ts;
+	u64 stamp = 0;
+	size_t i;
+
+	e = imd_entry_add(imd, CBMEM_ID_TIMESTAMP,
+			  sizeof(*ts) + n * sizeof(ts->entries[0]));
+	ts = imd_entry_at(imd, e);
+	ts->base_time = (u64)(1000 + rand() % 1000) * TICK_FREQ_MHZ;
+	ts->max_entries = n;
+	ts->tick_freq_mhz = TICK_FREQ_MHZ;
+	ts->num_entries = n;
+
+	/* Each stage takes its typical time, give or take 10%. */
+	for (i = 0; i < n; i++) {
+		u64 us = boot_steps[i].us;
+
+		us = us * 9 / 10 + (us ? rand() % (us / 5 + 1) : 0);
+		if (boot_steps[i].id == slow_id)
+			us += us / 2;
+		stamp += us * TICK_FREQ_MHZ + rand() % TICK_FREQ_MHZ;
+		ts->entries[i].entry_id = boot_steps[i].id;
+		ts->entries[i].entry_stamp = stamp;
+	}
+	return ts;
+}
+
+/* Append to the console like cbmemc_tx_byte() */
+static void console_write(struct cbmem_console *cons, const char *s)
+{
+	for (; *s; s++) {
+		u32 flags = cons->cursor & ~CBMC_CURSOR_MASK;
+		u32 cursor = cons->cursor & CBMC_CURSOR_MASK;
+
+		cons->body[cursor++] = *s;
+		if (cursor >= cons->size) {
+			cursor = 0;
+			flags |= CBMC_OVERFLOW;
+		}
+		cons->cursor = cursor | flags;
+	}
+}
+
+static struct cbmem_console *add_console(struct imd *imd, size_t size,
+					 size_t bytes)
+{
+	const struct imd_entry *e;
+	struct cbmem_console *cons;
+	char line[80];
+	size_t written = 0;
+	int n = 0;
+
+	e = imd_entry_add(imd, CBMEM_ID_CONSOLE, sizeof(*cons) + size);
+	cons = imd_entry_at(imd, e);
+	cons->size = size;
+	cons->cursor = 0;
+
+	console_write(cons, "\n\ncoreboot-4.6 Mon Jan 1 00:00:00 UTC 2017 "
+		      "bootblock starting...\n");
+	while (written < bytes) {
+		snprintf(line, sizeof(line), "line %d: %08x\n", n++, rand());
+		if (strlen(line) > bytes - written)
+			line[bytes - written] = '\0';
+		console_write(cons, line);
+		written += strlen(line);
+	}
+	return cons;
+}
+
+static void add_cbtable(struct imd *imd, struct timestamp_table *ts,
+			struct cbmem_console *cons, size_t size)
+{
+	const struct imd_entry *e;
+	struct imd_cursor cursor;
+	struct lb_header *head, *table;
+	struct lb_memory *lbm;
+	struct lb_cbmem_ref *ref;
+	struct lb_cbmem_entry *lbe;
+	void *cbmem_base;
+	size_t cbmem_size;
+
+	e = imd_entry_add(imd, CBMEM_ID_CBTABLE, CBTABLE_SIZE);
+	head = table = imd_entry_at(imd, e);
+	lb_init(head);
+
+	imd_region_used(imd, &cbmem_base, &cbmem_size);
+	lbm = lb_add(head, LB_TAG_MEMORY,
+		     sizeof(*lbm) + 2 * sizeof(lbm->map[0]));
+	lbm->map[0].start = pack_lb64(base);
+	lbm->map[0].size = pack_lb64(size - cbmem_size);
+	lbm->map[0].type = LB_MEM_RAM;
+	lbm->map[1].start = pack_lb64(phys(cbmem_base));
+	lbm->map[1].size = pack_lb64(cbmem_size);
+	lbm->map[1].type = LB_MEM_TABLE;
+
+	ref = lb_add(head, LB_TAG_TIMESTAMPS, sizeof(*ref));
+	ref->cbmem_addr = phys(ts);
+	ref = lb_add(head, LB_TAG_CBMEM_CONSOLE, sizeof(*ref));
+	ref->cbmem_addr = phys(cons);
+
+	/* Like cbmem_add_lb_records() */
+	imd_cursor_init(imd, &cursor);
+	while ((e = imd_cursor_next(&cursor))) {
+		u32 id = imd_entry_id(imd, e);
+
+		if (id == CBMEM_ID_IMD_ROOT || id == CBMEM_ID_IMD_SMALL)
+			continue;
+		lbe = lb_add(head, LB_TAG_CBMEM_ENTRY, sizeof(*lbe));
+		lbe->address = phys(imd_entry_at(imd, e));
+		lbe->entry_size = imd_entry_size(imd, e);
+		lbe->id = id;
+	}
+	lb_fini(head);
+
+	if (base <= FORWARD_TABLE) {
+		struct lb_forward *fwd;
+
+		head = (void *)(mem + FORWARD_TABLE - base);
+		lb_init(head);
+		fwd = lb_add(head, LB_TAG_FORWARD, sizeof(*fwd));
+		fwd->forward = phys(table);
+		lb_fini(head);
+	}
+}
+
+static const char *timestamp_name(u32 id)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(timestamp_ids); i++)
+		if (timestamp_ids[i].id == id)
+			return timestamp_ids[i].name;
+	return "<unknown>";
+}
+
+/* What cbmem -T prints */
+static void write_timestamps(FILE *f, const struct timestamp_table *ts)
+{
+	u64 prev, stamp;
+	u32 i;
+
+	fprintf(f, "0\t%llu\t%llu\t%s\n",
+		(unsigned long long)ts->base_time / TICK_FREQ_MHZ,
+		(unsigned long long)ts->base_time / TICK_FREQ_MHZ,
+		timestamp_name(0));
+	prev = ts->base_time;
+	for (i = 0; i < ts->num_entries; i++) {
+		stamp = ts->base_time + ts->entries[i].entry_stamp;
+		fprintf(f, "%u\t%llu\t%llu\t%s\n", ts->entries[i].entry_id,
+			(unsigned long long)stamp / TICK_FREQ_MHZ,
+			(unsigned long long)(stamp - prev) / TICK_FREQ_MHZ,
+			timestamp_name(ts->entries[i].entry_id));
+		prev = stamp;
+	}
+}
+
+static void write_console_body(FILE *f, const struct cbmem_console *cons)
+{
+	u32 cursor = cons->cursor & CBMC_CURSOR_MASK;
+
+	if (cons->cursor & CBMC_OVERFLOW) {
+		fwrite(cons->body + cursor, 1, cons->size - cursor, f);
+		fwrite(cons->body, 1, cursor, f);
+	} else {
+		fwrite(cons->body, 1, cursor, f);
+	}
+}
+
+/* What cbmem -c prints */
+static void write_console(FILE *f, const struct cbmem_console *cons)
+{
+	write_console_body(f, cons);
+	fputc('\n', f);
+}
+
+static FILE *open_output(const char *prefix, const char *suffix)
+{
+	char name[256];
+	FILE *f;
+
+	snprintf(name, sizeof(name), "%s%s", prefix, suffix);
+	f = fopen(name, "wb");
+	if (!f) {
+		perror(name);
+		exit(1);
+	}
+	return f;
+}
+
+/* Append to the console of an image, logging what cbmem -F prints to f */
+static int append_console(const char *image, size_t bytes, FILE *f)
+{
+	const struct imd_entry *e;
+	struct cbmem_console *cons;
+	struct imd imd;
+	struct stat st;
+	size_t written = 0;
+	char line[80];
+	int fd, n = 0;
+
+	fd = open(image, O_RDWR);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(image);
+		return 1;
+	}
+	mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED) {
+		perror(image);
+		return 1;
+	}
+
+	imd_handle_init(&imd, mem + st.st_size);
+	e = imd_recover(&imd) ? NULL : imd_entry_find(&imd, CBMEM_ID_CONSOLE);
+	if (!e) {
+		fprintf(stderr, "No console in %s.\n", image);
+		return 1;
+	}
+	cons = imd_entry_at(&imd, e);
+	if (f)
+		write_console_body(f, cons);
+
+	while (written < bytes) {
+		snprintf(line, sizeof(line), "runtime %d: %08x\n", n++, rand());
+		if (strlen(line) > bytes - written)
+			line[bytes - written] = '\0';
+		console_write(cons, line);
+		if (f)
+			fputs(line, f);
+		written += strlen(line);
+		usleep(1000);
+	}
+
+	munmap(mem, st.st_size);
+	close(fd);
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-b base] [-s size] [-c console size] "
+	       "[-n console bytes] [-S seed] [-d id] <image> [<prefix>]\n"
+	       "       %s -A bytes [-S seed] <image> [<prefix>]\n"
+	       "  -b  physical address of the image (default 0)\n"
+	       "  -s  size of the image, CBMEM is at the top (default 1 MiB)\n"
+	       "  -c  size of the console buffer (default 8 KiB)\n"
+	       "  -n  bytes written to the console, more than its size wrap "
+	       "around\n"
+	       "  -S  seed for the timestamps and the console\n"
+	       "  -d  make the step to timestamp id 50%% slower\n"
+	       "  -A  append bytes to the console of an existing image\n",
+	       name, name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long size = DEFAULT_SIZE;
+	unsigned long console_size = DEFAULT_CONSOLE_SIZE;
+	unsigned long console_bytes = DEFAULT_CONSOLE_SIZE / 2;
+	unsigned long append_bytes = 0;
+	struct timestamp_table *ts;
+	struct cbmem_console *cons;
+	struct imd imd;
+	FILE *f;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:s:c:n:S:d:A:h")) != -1) {
+		switch (opt) {
+		case 'b':
+			base = strtoull(optarg, NULL, 0);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			console_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			console_bytes = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			srand(strtoul(optarg, NULL, 0));
+			break;
+		case 'd':
+			slow_id = strtoul(optarg, NULL, 0);
+			break;
+		case 'A':
+			append_bytes = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || base % 16 || size % (4 * KiB) || size < 64 * KiB)
+		usage(argv[0]);
+
+	if (append_bytes) {
+		int ret;
+
+		f = optind + 1 < argc ? open_output(argv[optind + 1], ".follow")
+				      : NULL;
+		ret = append_console(argv[optind], append_bytes, f);
+		if (f)
+			fclose(f);
+		return ret;
+	}
+
+	/* imd.c aligns the top down to 4 KiB, keep it at the end. */
+	if (posix_memalign((void **)&mem, 4 * KiB, size)) {
+		perror("posix_memalign");
+		return 1;
+	}
+	memset(mem, 0, size);
+
+	/* Like cbmem_initialize_empty() with cbmem_top() at the end */
+	imd_handle_init(&imd, mem + size);
+	if (imd_create_tiered_empty(&imd, CBMEM_ROOT_MIN_SIZE, CBMEM_LG_ALIGN,
+				    CBMEM_SM_ROOT_SIZE, CBMEM_SM_ALIGN)) {
+		fprintf(stderr, "Could not create CBMEM.\n");
+		return 1;
+	}
+	ts = add_timestamps(&imd);
+	cons = add_console(&imd, console_size, console_bytes);
+	add_cbtable(&imd, ts, cons, size);
+
+	f = open_output(argv[optind], "");
+	if (fwrite(mem, size, 1, f) != 1) {
+		perror(argv[optind]);
+		return 1;
+	}
+	fclose(f);
+
+	if (optind + 1 < argc) {
+		f = open_output(argv[optind + 1], ".timestamps");
+		write_timestamps(f, ts);
+		fclose(f);
+		f = open_output(argv[optind + 1], ".console");
+		write_console(f, cons);
+		fclose(f);
+	}
+	return 0;
+}
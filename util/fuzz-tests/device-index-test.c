@@ -0,0 +1,300 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test and benchmark for the lookup index in src/device/device_util.c
+ *
+ * Builds a device list the way enumeration does, appending devices and
+ * renumbering buses, changing devfns, APIC ids and vendor/device ids on
+ * the way, and checks every dev_find_slot(), dev_find_slot_pnp(),
+ * dev_find_lapic() and dev_find_device() result against a walk of the
+ * list. Then reports the time per dev_find_slot() for lists of
+ * increasing size.
+ */
+
+#include <console/console.h>
+#include <device/device.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test-helpers.h"
+
+#define NUM_BUSES	8
+#define NUM_IDS		16
+#define DEFAULT_ROUNDS	20
+#define OPS_PER_ROUND	500
+
+struct device *all_devices;
+struct resource *free_resources;
+static struct device *last_dev;
+static struct bus buses[NUM_BUSES];
+
+int do_printk(int msg_level, const char *fmt, ...)
+{
+	return 0;
+}
+
+void __attribute__((noreturn)) die(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	exit(1);
+}
+
+/* Like __alloc_dev() in device.c */
+static struct device *append_dev(struct bus *bus, enum device_path_type type)
+{
+	struct device *dev = calloc(1, sizeof(*dev));
+
+	dev->bus = bus;
+	dev->path.type = type;
+	if (last_dev)
+		last_dev->next = dev;
+	else
+		all_devices = dev;
+	last_dev = dev;
+	dev_index_add(dev);
+	return dev;
+}
+
+static void random_path(struct device *dev)
+{
+	switch (dev->path.type) {
+	case DEVICE_PATH_PCI:
+		dev->path.pci.devfn = rand() % 64;
+		break;
+	case DEVICE_PATH_PNP:
+		dev->path.pnp.port = rand() % 2 ? 0x2e : 0x4e;
+		dev->path.pnp.device = rand() % 16 | (rand() % 2) << 8;
+		break;
+	case DEVICE_PATH_APIC:
+		dev->path.apic.apic_id = rand() % 32;
+		break;
+	default:
+		break;
+	}
+}
+
+static void random_ids(struct device *dev)
+{
+	dev->vendor = 0x8086 + rand() % 2;
+	dev->device = rand() % NUM_IDS;
+	/* CPUs have a full CPUID signature as device id */
+	if (dev->path.type == DEVICE_PATH_APIC && rand() % 2)
+		dev->device |= 0x90600;
+}
+
+static struct device *new_random_dev(void)
+{
+	static const enum device_path_type types[] = {
+		DEVICE_PATH_PCI, DEVICE_PATH_PCI, DEVICE_PATH_PCI,
+		DEVICE_PATH_PNP, DEVICE_PATH_APIC, DEVICE_PATH_I2C,
+	};
+	struct device *dev;
+
+	dev = append_dev(&buses[rand() % NUM_BUSES],
+			 types[rand() % ARRAY_SIZE(types)]);
+	random_path(dev);
+	random_ids(dev);
+	dev_index_update(dev);
+	return dev;
+}
+
+static struct device *nth_dev(int n)
+{
+	struct device *dev = all_devices;
+
+	while (n-- && dev->next)
+		dev = dev->next;
+	return dev;
+}
+
+/* The list walks device_util.c did before the index */
+
+static struct device *ref_find_slot(unsigned int bus, unsigned int devfn)
+{
+	struct device *dev;
+
+	for (dev = all_devices; dev; dev = dev->next)
+		if (dev->path.type == DEVICE_PATH_PCI &&
+		    dev->bus->secondary == bus && dev->path.pci.devfn == devfn)
+			return dev;
+	return NULL;
+}
+
+static struct device *ref_find_slot_pnp(u16 port, u16 device)
+{
+	struct device *dev;
+
+	for (dev = all_devices; dev; dev = dev->next)
+		if (dev->path.type == DEVICE_PATH_PNP &&
+		    dev->path.pnp.port == port && dev->path.pnp.device == device)
+			return dev;
+	return NULL;
+}
+
+static struct device *ref_find_lapic(unsigned int apic_id)
+{
+	struct device *dev;
+
+	for (dev = all_devices; dev; dev = dev->next)
+		if (dev->path.type == DEVICE_PATH_APIC &&
+		    dev->path.apic.apic_id == apic_id)
+			return dev;
+	return NULL;
+}
+
+static struct device *ref_find_device(u16 vendor, u16 device,
+				      struct device *from)
+{
+	from = from ? from->next : all_devices;
+	while (from && (from->vendor != vendor || from->device != device))
+		from = from->next;
+	return from;
+}
+
+static int check(const char *op)
+{
+	struct device *dev, *ref;
+	unsigned int bus, devfn, id;
+	u16 port;
+
+	for (bus = 0; bus < NUM_BUSES * 2; bus++) {
+		for (devfn = 0; devfn < 64; devfn++) {
+			if (dev_find_slot(bus, devfn) == ref_find_slot(bus, devfn))
+				continue;
+			return check_failed(op, "dev_find_slot(%u, %u) differs",
+					    bus, devfn);
+		}
+	}
+	for (port = 0x2e; port <= 0x4e; port += 0x20) {
+		for (id = 0; id < 0x110; id++) {
+			if (dev_find_slot_pnp(port, id) ==
+			    ref_find_slot_pnp(port, id))
+				continue;
+			return check_failed(op,
+					    "dev_find_slot_pnp(%x, %x) differs",
+					    port, id);
+		}
+	}
+	for (id = 0; id < 33; id++) {
+		if (dev_find_lapic(id) != ref_find_lapic(id))
+			return check_failed(op, "dev_find_lapic(%u) differs",
+					    id);
+	}
+	for (id = 0; id < 2 * NUM_IDS; id++) {
+		u16 vendor = 0x8086 + id % 2, device = id / 2;
+
+		dev = ref = NULL;
+		do {
+			dev = dev_find_device(vendor, device, dev);
+			ref = ref_find_device(vendor, device, ref);
+			if (dev != ref)
+				return check_failed(op,
+					"dev_find_device(%x, %x) differs",
+					vendor, device);
+		} while (dev);
+	}
+	return 0;
+}
+
+static int random_round(int seed)
+{
+	int i, n;
+
+	srand(seed);
+	for (i = 0; i < NUM_BUSES; i++)
+		buses[i].secondary = i;
+
+	/* Devices from the static tree, before the first lookup */
+	for (n = 0; n < 16; n++)
+		new_random_dev();
+
+	for (i = 0; i < OPS_PER_ROUND; i++) {
+		struct device *dev = nth_dev(rand() % n);
+		const char *op;
+
+		switch (rand() % 5) {
+		case 0:
+		case 1:
+			new_random_dev();
+			n++;
+			op = "append";
+			break;
+		case 2:
+			random_path(dev);
+			dev_index_update(dev);
+			op = "path change";
+			break;
+		case 3:
+			random_ids(dev);
+			dev_index_update(dev);
+			op = "id change";
+			break;
+		default:
+			buses[rand() % NUM_BUSES].secondary =
+				rand() % (NUM_BUSES * 2);
+			op = "bus renumber";
+			break;
+		}
+		if (i % 10 == 0 && check(op))
+			return 1;
+	}
+	return check("final") ? 1 : 0;
+}
+
+/* Time to look up every PCI device of a list of n devices */
+static int bench(int n)
+{
+	struct device *dev;
+	double t0, t1, t2;
+	int i, found = 0;
+
+	for (i = 0; i < NUM_BUSES; i++)
+		buses[i].secondary = i;
+	for (i = 0; i < n; i++) {
+		dev = append_dev(&buses[i / 256 % NUM_BUSES],
+				 DEVICE_PATH_PCI);
+		dev->path.pci.devfn = i % 256;
+	}
+
+	t0 = now();
+	for (dev = all_devices; dev; dev = dev->next)
+		found += ref_find_slot(dev->bus->secondary,
+				       dev->path.pci.devfn) == dev;
+	t1 = now();
+	for (dev = all_devices; dev; dev = dev->next)
+		found += dev_find_slot(dev->bus->secondary,
+				       dev->path.pci.devfn) == dev;
+	t2 = now();
+
+	printf("%5d devices: list walk %8.1f ns, index %6.1f ns per lookup "
+	       "(%d found)\n", n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n,
+	       found);
+	return found != 2 * n;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = test_rounds(argc, argv, DEFAULT_ROUNDS);
+	int r;
+
+	for (r = 0; r < rounds; r++)
+		if (run_forked(random_round, r + 1))
+			return 1;
+	printf("device index: %d random rounds passed\n", rounds);
+
+	if (run_forked(bench, 100) || run_forked(bench, 500) ||
+	    run_forked(bench, 2000))
+		return 1;
+	return 0;
+}
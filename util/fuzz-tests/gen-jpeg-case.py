@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# This file is part of the coreboot project.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# Minimal baseline JPEG encoder (4:4:4 or 4:2:0) used to generate the
+# images in jpeg-bench-cases/. It draws a deterministic test pattern, so
+# the images can be regenerated at any resolution:
+#
+#   gen-jpeg-case.py <width> <height> <444|420> <output.jpg>
+#
+import math, struct, sys
+
+ZZ = [0,1,8,16,9,2,3,10,17,24,32,25,18,11,4,5,12,19,26,33,40,48,41,34,27,20,13,6,7,14,21,
+      28,35,42,49,56,57,50,43,36,29,22,15,23,30,37,44,51,58,59,52,45,38,31,39,46,53,60,61,54,47,55,62,63]
+QL = [16,11,10,16,24,40,51,61,12,12,14,19,26,58,60,55,14,13,16,24,40,57,69,56,14,17,22,29,51,87,80,62,
+      18,22,37,56,68,109,103,77,24,35,55,64,81,104,113,92,49,64,78,87,103,121,120,101,72,92,95,98,112,100,103,99]
+QC = [17,18,24,47,99,99,99,99,18,21,26,66,99,99,99,99,24,26,56,99,99,99,99,99,47,66,99,99,99,99,99,99]+[99]*32
+DC_L_BITS=[0,1,5,1,1,1,1,1,1,0,0,0,0,0,0,0]; DC_L_VAL=list(range(12))
+DC_C_BITS=[0,3,1,1,1,1,1,1,1,1,1,0,0,0,0,0]; DC_C_VAL=list(range(12))
+AC_L_BITS=[0,2,1,3,3,2,4,3,5,5,4,4,0,0,1,0x7d]
+AC_L_VAL=bytes.fromhex("01020300041105122131410613516107227114328191a1082342b1c11552d1f02433627282090a161718191a25262728292a3435363738393a434445464748494a535455565758595a636465666768696a737475767778797a838485868788898a92939495969798999aa2a3a4a5a6a7a8a9aab2b3b4b5b6b7b8b9bac2c3c4c5c6c7c8c9cad2d3d4d5d6d7d8d9dae1e2e3e4e5e6e7e8e9eaf1f2f3f4f5f6f7f8f9fa")
+AC_C_BITS=[0,2,1,2,4,4,3,4,7,5,4,4,0,1,2,0x77]
+AC_C_VAL=bytes.fromhex("000102031104052131061241510761711322328108144291a1b1c109233352f0156272d10a162434e125f11718191a262728292a35363738393a434445464748494a535455565758595a636465666768696a737475767778797a82838485868788898a92939495969798999aa2a3a4a5a6a7a8a9aab2b3b4b5b6b7b8b9bac2c3c4c5c6c7c8c9cad2d3d4d5d6d7d8d9dae2e3e4e5e6e7e8e9eaf2f3f4f5f6f7f8f9fa")
+
+def codes(bits, vals):
+    t = {}; code = 0; k = 0
+    for l in range(16):
+        for _ in range(bits[l]):
+            t[vals[k]] = (code, l + 1); code += 1; k += 1
+        code <<= 1
+    return t
+
+class BW:
+    def __init__(s): s.out = bytearray(); s.acc = 0; s.n = 0
+    def put(s, v, n):
+        for i in range(n - 1, -1, -1):
+            s.acc = (s.acc << 1) | ((v >> i) & 1); s.n += 1
+            if s.n == 8:
+                s.out.append(s.acc)
+                if s.acc == 0xff: s.out.append(0)
+                s.acc = 0; s.n = 0
+    def flush(s):
+        while s.n: s.put(1, 1)
+
+C = [[(math.sqrt(0.125) if u == 0 else 0.5) * math.cos((2 * x + 1) * u * math.pi / 16) for x in range(8)] for u in range(8)]
+
+def fdct(b):
+    tmp = [[sum(C[u][x] * b[y * 8 + x] for x in range(8)) for u in range(8)] for y in range(8)]
+    return [sum(C[v][y] * tmp[y][u] for y in range(8)) for v in range(8) for u in range(8)]
+
+def size(v):
+    v = abs(v); n = 0
+    while v: n += 1; v >>= 1
+    return n
+
+def enc_block(bw, blk, q, dct, act, prev):
+    f = fdct([p - 128 for p in blk])
+    z = [int(round(f[ZZ[i]] / q[i])) for i in range(64)]
+    d = z[0] - prev; s = size(d)
+    bw.put(*dct[s])
+    if s: bw.put(d if d > 0 else d + (1 << s) - 1, s)
+    run = 0
+    for i in range(1, 64):
+        if z[i] == 0: run += 1; continue
+        while run > 15: bw.put(*act[0xf0]); run -= 16
+        s = size(z[i]); bw.put(*act[(run << 4) | s])
+        bw.put(z[i] if z[i] > 0 else z[i] + (1 << s) - 1, s); run = 0
+    if run: bw.put(*act[0])
+    return z[0]
+
+def encode(w, h, pix, sub):
+    def comp(x, y, c):
+        x = min(x, w - 1); y = min(y, h - 1)
+        r, g, b = pix(x, y)
+        if c == 0: return 0.299 * r + 0.587 * g + 0.114 * b
+        if c == 1: return -0.168736 * r - 0.331264 * g + 0.5 * b + 128
+        return 0.5 * r - 0.418688 * g - 0.081312 * b + 128
+    out = bytearray(b'\xff\xd8')
+    def seg(m, d): out.extend(struct.pack('>BBH', 0xff, m, len(d) + 2) + d)
+    seg(0xdb, bytes([0] + [QL[ZZ[i]] for i in range(64)]) + bytes([1] + [QC[ZZ[i]] for i in range(64)]))
+    hv = 0x22 if sub else 0x11
+    seg(0xc0, struct.pack('>BHHB', 8, h, w, 3) + bytes([1, hv, 0, 2, 0x11, 1, 3, 0x11, 1]))
+    for tc, th, bits, vals in ((0, 0, DC_L_BITS, DC_L_VAL), (1, 0, AC_L_BITS, AC_L_VAL), (0, 1, DC_C_BITS, DC_C_VAL), (1, 1, AC_C_BITS, AC_C_VAL)):
+        seg(0xc4, bytes([tc << 4 | th] + bits) + bytes(vals))
+    seg(0xda, bytes([3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0]))
+    dcl, acl = codes(DC_L_BITS, DC_L_VAL), codes(AC_L_BITS, AC_L_VAL)
+    dcc, acc = codes(DC_C_BITS, DC_C_VAL), codes(AC_C_BITS, AC_C_VAL)
+    ql = [QL[ZZ[i]] for i in range(64)]; qc = [QC[ZZ[i]] for i in range(64)]
+    bw = BW(); prev = [0, 0, 0]; m = 16 if sub else 8
+    for my in range(0, h, m):
+        for mx in range(0, w, m):
+            if sub:
+                for by, bx in ((0, 0), (0, 8), (8, 0), (8, 8)):
+                    blk = [comp(mx + bx + x, my + by + y, 0) for y in range(8) for x in range(8)]
+                    prev[0] = enc_block(bw, blk, ql, dcl, acl, prev[0])
+                for c in (1, 2):
+                    blk = [sum(comp(mx + 2 * x + i, my + 2 * y + j, c) for i in (0, 1) for j in (0, 1)) / 4 for y in range(8) for x in range(8)]
+                    prev[c] = enc_block(bw, blk, qc, dcc, acc, prev[c])
+            else:
+                for c in range(3):
+                    blk = [comp(mx + x, my + y, c) for y in range(8) for x in range(8)]
+                    prev[c] = enc_block(bw, blk, ql if c == 0 else qc, dcl if c == 0 else dcc, acl if c == 0 else acc, prev[c])
+    bw.flush(); out.extend(bw.out); out.extend(b'\xff\xd9')
+    return bytes(out)
+
+if __name__ == '__main__':
+    w, h, sub, name = int(sys.argv[1]), int(sys.argv[2]), sys.argv[3] == '420', sys.argv[4]
+    def pix(x, y):
+        return ((x * 255) // max(w - 1, 1), (y * 255) // max(h - 1, 1), ((x ^ y) * 7) & 255)
+    open(name, 'wb').write(encode(w, h, pix, sub))
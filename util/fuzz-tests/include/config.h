@@ -0,0 +1,30 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* Configuration of the coreboot code built into the host tests. */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define CONFIG_BOOT_DEVICE_SPI_FLASH_BUS 0
+#define CONFIG_MAX_CPUS 1
+#define CONFIG_MMCONF_BASE_ADDRESS 0xe0000000
+#define CONFIG_MMCONF_BUS_NUMBER 256
+#define CONFIG_ONBOARD_VGA_IS_PRIMARY 0
+#define CONFIG_ROM_SIZE 0x1000000
+#define CONFIG_SPI_FLASH 1
+#define CONFIG_SPI_FLASH_SFDP 1
+#define CONFIG_SPI_FLASH_WINBOND 1
+#define CONFIG_STACK_SIZE 0x1000
+
+#endif /* CONFIG_H */
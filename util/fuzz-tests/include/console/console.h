@@ -0,0 +1,50 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* Host stand-in for the coreboot console. */
+
+#ifndef CONSOLE_CONSOLE_H_
+#define CONSOLE_CONSOLE_H_
+
+#include <rules.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <console/post_codes.h>
+
+#define BIOS_EMERG	0
+#define BIOS_ALERT	1
+#define BIOS_CRIT	2
+#define BIOS_ERR	3
+#define BIOS_WARNING	4
+#define BIOS_NOTICE	5
+#define BIOS_INFO	6
+#define BIOS_DEBUG	7
+#define BIOS_SPEW	8
+
+/* Provided by the tests that build code calling them directly */
+void post_code(u8 value);
+void __attribute__((noreturn)) die(const char *msg);
+int do_printk(int msg_level, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#define post_log_path(x) do {} while (0)
+#define post_log_clear() do {} while (0)
+
+/* Only errors and warnings, the tests print their own results. */
+#define printk(level, ...) \
+	do { \
+		if ((level) <= BIOS_WARNING) \
+			fprintf(stderr, __VA_ARGS__); \
+	} while (0)
+
+#endif /* CONSOLE_CONSOLE_H_ */
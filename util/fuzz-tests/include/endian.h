@@ -0,0 +1,22 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* The host <endian.h> plus the network byte order functions of coreboot's. */
+
+#ifndef HOST_ENDIAN_H
+#define HOST_ENDIAN_H
+
+#include_next <endian.h>
+#include <arpa/inet.h>
+
+#endif /* HOST_ENDIAN_H */
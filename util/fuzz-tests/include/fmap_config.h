@@ -0,0 +1,25 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Stand-in for the header fmaptool generates: the COREBOOT region is the
+ * upper half of the flash.
+ */
+
+#ifndef FMAP_CONFIG_H
+#define FMAP_CONFIG_H
+
+#define ___FMAP__COREBOOT_BASE 0x800000
+#define ___FMAP__COREBOOT_SIZE 0x800000
+
+#endif /* FMAP_CONFIG_H */
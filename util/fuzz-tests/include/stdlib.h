@@ -0,0 +1,25 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/* The host <stdlib.h> plus what coreboot adds to it. */
+
+#ifndef HOST_STDLIB_H
+#define HOST_STDLIB_H
+
+#include_next <stdlib.h>
+#include <commonlib/helpers.h>
+
+#define min(a, b) MIN((a), (b))
+#define max(a, b) MAX((a), (b))
+
+#endif /* HOST_STDLIB_H */
@@ -0,0 +1,56 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Host stand-in for the vboot API, for the CBFS headers. The host tests
+ * don't verify hashes.
+ */
+
+#ifndef VB2_API_H
+#define VB2_API_H
+
+#include <stdint.h>
+
+enum vb2_hash_algorithm {
+	VB2_HASH_INVALID,
+	VB2_HASH_SHA1,
+	VB2_HASH_SHA256,
+	VB2_HASH_SHA512,
+};
+
+#define VB2_SUCCESS		0
+#define VB2_ERROR_UNKNOWN	0x10000
+
+struct vb2_digest_context {
+	enum vb2_hash_algorithm hash_alg;
+};
+
+static inline int vb2_digest_init(struct vb2_digest_context *dc,
+				  enum vb2_hash_algorithm hash_alg)
+{
+	return VB2_ERROR_UNKNOWN;
+}
+
+static inline int vb2_digest_extend(struct vb2_digest_context *dc,
+				    const uint8_t *buf, uint32_t size)
+{
+	return VB2_ERROR_UNKNOWN;
+}
+
+static inline int vb2_digest_finalize(struct vb2_digest_context *dc,
+				      uint8_t *digest, uint32_t digest_size)
+{
+	return VB2_ERROR_UNKNOWN;
+}
+
+#endif /* VB2_API_H */
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test and benchmark for src/lib/compute_ip_checksum.c
+ *
+ * Compares compute_ip_checksum() against the original byte at a time
+ * implementation over random buffers, lengths and alignments, then reports
+ * the throughput of both on an MRC cache sized buffer.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ip_checksum.h>
+
+#include "test-helpers.h"
+
+#define MAX_LENGTH	(70 * 1024)
+#define BENCH_LENGTH	(256 * 1024)
+#define MIN_TIME	0.25	/* seconds to spend on each benchmark */
+#define DEFAULT_ROUNDS	100000
+
+/* The original implementation, as the reference */
+static unsigned long ref_ip_checksum(const void *addr, unsigned long length)
+{
+	const uint8_t *ptr;
+	volatile union {
+		uint8_t  byte[2];
+		uint16_t word;
+	} value;
+	unsigned long sum;
+	unsigned long i;
+
+	sum = 0;
+	ptr = addr;
+	for (i = 0; i < length; i++) {
+		unsigned long v;
+		v = ptr[i];
+		if (i & 1)
+			v <<= 8;
+		sum += v;
+		if (sum > 0xFFFF)
+			sum = (sum + (sum >> 16)) & 0xFFFF;
+	}
+	value.byte[0] = sum & 0xff;
+	value.byte[1] = (sum >> 8) & 0xff;
+	return (~value.word) & 0xFFFF;
+}
+
+static void fill(uint8_t *buf, size_t len, int pattern)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		switch (pattern) {
+		case 0:
+			buf[i] = rand();
+			break;
+		case 1:
+			buf[i] = 0xff;
+			break;
+		case 2:
+			buf[i] = 0;
+			break;
+		default:
+			buf[i] = rand() & 1 ? 0xff : 0;
+			break;
+		}
+	}
+}
+
+static int test(int rounds)
+{
+	uint8_t *buf = malloc(MAX_LENGTH + 16);
+	unsigned long len, align, want, got;
+	int i, failed = 0;
+
+	if (!buf)
+		return 1;
+
+	for (i = 0; i < rounds; i++) {
+		/* Mostly short buffers, where the edge cases are */
+		len = rand() % (i & 1 ? MAX_LENGTH : 64);
+		align = rand() % 16;
+		fill(buf + align, len, i % 4);
+
+		want = ref_ip_checksum(buf + align, len);
+		got = compute_ip_checksum(buf + align, len);
+		if (want != got) {
+			printf("MISMATCH: length %lu align %lu: %04lx != %04lx\n",
+			       len, align, got, want);
+			failed++;
+		}
+	}
+	printf("%d random buffers, %d failed\n", rounds, failed);
+	free(buf);
+	return failed;
+}
+
+static void bench(const char *name,
+		  unsigned long (*fn)(const void *, unsigned long))
+{
+	static uint8_t buf[BENCH_LENGTH];
+	volatile unsigned long result;
+	double start, elapsed;
+	int n = 0;
+
+	fill(buf, sizeof(buf), 0);
+	start = now();
+	do {
+		result = fn(buf, sizeof(buf));
+		n++;
+		elapsed = now() - start;
+	} while (elapsed < MIN_TIME);
+	(void)result;
+
+	printf("%-10s %4d KiB  %10.2f us  %8.2f MiB/s\n", name,
+	       BENCH_LENGTH / 1024, elapsed * 1e6 / n,
+	       (double)BENCH_LENGTH * n / elapsed / (1024 * 1024));
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = test_rounds(argc, argv, DEFAULT_ROUNDS);
+
+	srand(1);
+	if (test(rounds))
+		return 1;
+
+	bench("reference", ref_ip_checksum);
+	bench("optimized", compute_ip_checksum);
+	return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Golden image test and benchmark for src/lib/jpeg.c
+ *
+ * Reads a list of "<image> <depth> <crc32>" lines, decodes each image at the
+ * given depth, compares the CRC32 of the decoded picture against the expected
+ * value and reports the decoding speed. Image paths are relative to the
+ * directory of the list file. With -u, the list is rewritten with the
+ * checksums of the current decoder instead.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpeg.h"
+#include "test-helpers.h"
+
+#define MAX_ENTRIES	256
+#define MIN_TIME	0.25	/* seconds to spend decoding each image */
+
+struct entry {
+	char name[256];
+	int depth;
+	unsigned int crc;
+};
+
+static struct entry entries[MAX_ENTRIES];
+
+static uint32_t crc32(const unsigned char *buf, size_t len)
+{
+	uint32_t crc = 0xffffffff;
+	size_t i;
+	int j;
+
+	for (i = 0; i < len; i++) {
+		crc ^= buf[i];
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static unsigned char *read_file(const char *name, size_t *len)
+{
+	FILE *f = fopen(name, "rb");
+	unsigned char *buf = NULL;
+	long size;
+
+	if (!f)
+		return NULL;
+	if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 &&
+	    fseek(f, 0, SEEK_SET) == 0) {
+		buf = malloc(size);
+		if (buf && fread(buf, size, 1, f) != 1) {
+			free(buf);
+			buf = NULL;
+		}
+		*len = size;
+	}
+	fclose(f);
+	return buf;
+}
+
+/* Decode one entry, returns 0 if the checksum matches (or update is set) */
+static int run_entry(const char *dir, struct entry *e, int iterations,
+		     int update)
+{
+	struct jpeg_decdata *decdata = malloc(sizeof(*decdata));
+	unsigned char *buf, *pic;
+	char path[1024];
+	int width, height, n, ret;
+	double start, elapsed;
+	uint32_t crc;
+	size_t len;
+
+	if (snprintf(path, sizeof(path), "%s/%s", dir, e->name) >=
+	    (int)sizeof(path))
+		buf = NULL;
+	else
+		buf = read_file(path, &len);
+	if (!buf || !decdata) {
+		printf("%-28s cannot read file\n", e->name);
+		return 1;
+	}
+
+	jpeg_fetch_size(buf, &width, &height);
+	width = (width + 15) & ~15;
+	height = (height + 15) & ~15;
+	pic = calloc((size_t)width * height, e->depth / 8);
+	if (!pic)
+		return 1;
+
+	ret = jpeg_decode(buf, pic, width, height, e->depth, decdata);
+	if (ret) {
+		printf("%-28s %4dx%-4d @%2d  decode error %d\n", e->name,
+		       width, height, e->depth, ret);
+		return 1;
+	}
+	crc = crc32(pic, (size_t)width * height * (e->depth / 8));
+
+	/* Run for at least MIN_TIME unless the iterations are given */
+	n = 0;
+	start = now();
+	do {
+		jpeg_decode(buf, pic, width, height, e->depth, decdata);
+		n++;
+		elapsed = now() - start;
+	} while (iterations ? n < iterations : elapsed < MIN_TIME);
+
+	printf("%-28s %4dx%-4d @%2d  %8.3f ms  %8.2f MPixel/s  %08x  %s\n",
+	       e->name, width, height, e->depth, elapsed * 1000 / n,
+	       (double)width * height * n / elapsed / 1e6, crc,
+	       update ? "updated" : crc == e->crc ? "ok" : "MISMATCH");
+
+	ret = !update && crc != e->crc;
+	e->crc = crc;
+	free(pic);
+	free(buf);
+	free(decdata);
+	return ret;
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-u] [-i iterations] <checksum list>\n"
+	       "  -u  update the checksums in the list\n"
+	       "  -i  decode each image this many times (default: %.2fs)\n",
+	       name, MIN_TIME);
+}
+
+int main(int argc, char **argv)
+{
+	int update = 0, iterations = 0, count = 0, failed = 0, opt, i;
+	char line[512], dir[512], *slash;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "ui:h")) != -1) {
+		switch (opt) {
+		case 'u':
+			update = 1;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	snprintf(dir, sizeof(dir), "%s", argv[optind]);
+	slash = strrchr(dir, '/');
+	if (slash)
+		*slash = '\0';
+	else
+		strcpy(dir, ".");
+
+	f = fopen(argv[optind], "r");
+	if (!f) {
+		perror(argv[optind]);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f) && count < MAX_ENTRIES) {
+		struct entry *e = &entries[count];
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%255s %d %x", e->name, &e->depth, &e->crc)
+		    < 2) {
+			fprintf(stderr, "bad line: %s", line);
+			fclose(f);
+			return 1;
+		}
+		count++;
+	}
+	fclose(f);
+
+	for (i = 0; i < count; i++)
+		failed += run_entry(dir, &entries[i], iterations, update);
+
+	if (update) {
+		f = fopen(argv[optind], "w");
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+		fprintf(f, "# image depth crc32, see jpeg-bench.c\n");
+		for (i = 0; i < count; i++)
+			fprintf(f, "%s %d %08x\n", entries[i].name,
+				entries[i].depth, entries[i].crc);
+		fclose(f);
+	}
+
+	printf("%d images, %d failed\n", count, failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test and benchmark for src/lib/memrange.c
+ *
+ * Applies random inserts, holes, tag updates and hole fills to a memranges
+ * and to a plain array holding the tag of every address, and checks after
+ * each operation that the entries are sorted, disjoint, merged and describe
+ * the same map as the array. Then reports the time per insert for building
+ * maps of increasing size, the way the resource allocator and the MTRR code
+ * do.
+ */
+
+#include <console/console.h>
+#include <commonlib/helpers.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memrange.h>
+
+#include "test-helpers.h"
+
+#define SPACE		512	/* addresses in the random tests */
+#define NO_TAG		(~0UL)
+#define NUM_TAGS	4
+#define DEFAULT_ROUNDS	200
+#define OPS_PER_ROUND	100
+
+/* memrange.c pulls this in for memranges_add_resources(). */
+void search_global_resources(unsigned long type_mask, unsigned long type,
+			     void (*search)(void *, struct device *,
+					    struct resource *),
+			     void *gp)
+{
+}
+
+static unsigned long ref[SPACE];
+
+static int check(struct memranges *ranges, const char *op)
+{
+	const struct range_entry *r;
+	unsigned long map[SPACE];
+	resource_t last_end = 0;
+	unsigned long last_tag = NO_TAG;
+	resource_t a;
+	int first = 1;
+
+	for (a = 0; a < SPACE; a++)
+		map[a] = NO_TAG;
+
+	memranges_each_entry(r, ranges) {
+		if (r->begin > r->end ||
+		    (!first && r->begin <= last_end) ||
+		    (!first && r->begin == last_end + 1 && r->tag == last_tag)) {
+			return check_failed(op, "bad entry [%llx, %llx] tag %lu",
+					    (unsigned long long)r->begin,
+					    (unsigned long long)r->end, r->tag);
+		}
+		for (a = r->begin; a <= r->end && a < SPACE; a++)
+			map[a] = r->tag;
+		last_end = r->end;
+		last_tag = r->tag;
+		first = 0;
+	}
+
+	for (a = 0; a < SPACE; a++) {
+		if (map[a] != ref[a])
+			return check_failed(op, "address %llx has tag %ld, "
+					    "expected %ld",
+					    (unsigned long long)a,
+					    (long)map[a], (long)ref[a]);
+	}
+	return 0;
+}
+
+static int random_test(int rounds)
+{
+	struct memranges ranges;
+	int i, j;
+
+	for (i = 0; i < rounds; i++) {
+		memranges_init_empty_with_alignment(&ranges, NULL, 0, 0);
+		for (j = 0; j < SPACE; j++)
+			ref[j] = NO_TAG;
+
+		for (j = 0; j < OPS_PER_ROUND; j++) {
+			resource_t b = rand() % SPACE;
+			resource_t size = 1 + rand() % (SPACE / 8);
+			unsigned long tag = rand() % NUM_TAGS;
+			unsigned long new_tag = rand() % NUM_TAGS;
+			const char *op;
+			resource_t a;
+
+			if (b + size > SPACE)
+				size = SPACE - b;
+
+			switch (rand() % 8) {
+			case 0:
+				op = "create_hole";
+				memranges_create_hole(&ranges, b, size);
+				for (a = b; a < b + size; a++)
+					ref[a] = NO_TAG;
+				break;
+			case 1:
+				op = "update_tag";
+				memranges_update_tag(&ranges, tag, new_tag);
+				for (a = 0; a < SPACE; a++)
+					if (ref[a] == tag)
+						ref[a] = new_tag;
+				break;
+			case 2:
+				op = "fill_holes_up_to";
+				/*
+				 * Holes from the first entry on are filled.
+				 * Callers pass a limit in a hole after the
+				 * first entry or past the last one, other
+				 * limits aren't handled.
+				 */
+				for (a = 0; a < SPACE && ref[a] == NO_TAG; a++)
+					;
+				while (a < SPACE && ref[a] != NO_TAG)
+					a++;
+				size = MAX(b + size, a);
+				while (size < SPACE && ref[size - 1] != NO_TAG)
+					size++;
+				memranges_fill_holes_up_to(&ranges, size, tag);
+				for (a = 0; a < SPACE && ref[a] == NO_TAG; a++)
+					;
+				for (; a < size; a++)
+					if (ref[a] == NO_TAG)
+						ref[a] = tag;
+				break;
+			default:
+				op = "insert";
+				memranges_insert(&ranges, b, size, tag);
+				for (a = b; a < b + size; a++)
+					ref[a] = tag;
+				break;
+			}
+
+			if (check(&ranges, op) < 0)
+				return -1;
+		}
+		memranges_teardown(&ranges);
+	}
+	return 0;
+}
+
+/*
+ * Insert n ranges of 4 KiB at random page offsets with one of a few tags.
+ * Resources come in no particular order, so most inserts land in the
+ * middle of the list.
+ */
+static void bench(int n)
+{
+	struct memranges ranges;
+	double start, elapsed;
+	int entries = 0;
+	int i;
+	const struct range_entry *r;
+
+	srand(n);
+	memranges_init_empty_with_alignment(&ranges, NULL, 0, 12);
+	start = now();
+	for (i = 0; i < n; i++) {
+		resource_t page = rand() % (4 * n);
+
+		memranges_insert(&ranges, page << 12, 4096, rand() % NUM_TAGS);
+	}
+	elapsed = now() - start;
+
+	memranges_each_entry(r, &ranges)
+		entries++;
+	printf("%7d inserts: %8.3f ms, %7.1f ns/insert, %6d entries\n", n,
+	       elapsed * 1e3, elapsed * 1e9 / n, entries);
+	memranges_teardown(&ranges);
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = test_rounds(argc, argv, DEFAULT_ROUNDS);
+
+	srand(1);
+	if (random_test(rounds) < 0) {
+		printf("memrange: FAILED\n");
+		return 1;
+	}
+	printf("memrange: %d rounds of %d random operations passed\n", rounds,
+	       OPS_PER_ROUND);
+
+	bench(1000);
+	bench(10000);
+	bench(100000);
+	return 0;
+}
@@ -0,0 +1,495 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test and benchmark for the payload loader in src/lib/selfboot.c
+ *
+ * Maps fake RAM at a fixed address, with a fake coreboot linked to the
+ * middle of it, and loads random payloads with selfload(): uncompressed,
+ * LZMA and LZ4 segments and BSS, placed before, across, inside and after
+ * coreboot, sometimes overlapping each other. Checks that every byte of the
+ * payload outside coreboot ends up where a segment put it, that coreboot is
+ * left alone and that its mirror in the bounce buffer holds the payload
+ * bytes shadowing it. Then reports the time selfload() takes for a payload
+ * of large LZMA segments.
+ *
+ * With PAYLOAD_LOAD_ON_APS, threads stand in for the APs that
+ * mp_run_on_aps() starts, so that independent segments are loaded by
+ * several of them at once.
+ */
+
+#include <commonlib/endian.h>
+#include <commonlib/region.h>
+#include <console/console.h>
+#include <bootmem.h>
+#include <cbfs.h>
+#include <program_loading.h>
+#include <stdlib.h>
+#include <string.h>
+#include <symbols.h>
+#include <sys/mman.h>
+
+#include "../cbfstool/lz4/lib/lz4frame.h"
+#include "../cbfstool/lzma/C/LzmaEnc.h"
+#include "test-helpers.h"
+
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+#include <cpu/x86/mp.h>
+#include <pthread.h>
+
+#define LOADER		"parallel"
+#define AP_THREADS	4	/* one more than selfboot.c has work for */
+#else
+#define LOADER		"sequential"
+#endif
+
+#define DEFAULT_ROUNDS	200
+#define MAX_SEGMENTS	6
+#define MAX_MEMSZ	(192 * KiB)
+#define BENCH_SEGMENTS	4
+#define BENCH_MEMSZ	(1 * MiB)
+
+/* The Makefile links _program and _eprogram to 16 MiB into the fake RAM. */
+#define FAKE_RAM	0x20000000UL
+#define FAKE_RAM_SIZE	(64 * MiB)
+#define PAYLOAD_END	(FAKE_RAM + 32 * MiB)	/* usable RAM for payloads */
+#define BOUNCE_AREA	(FAKE_RAM + 48 * MiB)
+#define BOUNCE_SIZE	(16 * MiB)
+
+/* The random payloads are loaded around coreboot. */
+#define WINDOW_START	(lb_start - 512 * KiB)
+#define WINDOW_END	(lb_end + 512 * KiB)
+#define WINDOW_SIZE	(WINDOW_END - WINDOW_START)
+
+#define lb_start	((unsigned long)_program)
+#define lb_end		((unsigned long)_eprogram)
+
+struct payload_segment {
+	u32 type;
+	u32 compression;
+	u64 load_addr;
+	u32 len;
+	u32 mem_len;
+	u8 *data;	/* as stored in CBFS */
+};
+
+/* The fake RAM as it has to look after loading, and what was written */
+static u8 *expected, *written;
+static int segments_loaded, final_segment, loaded_early;
+
+static int check_window(const u8 *mirror);
+
+int do_printk(int msg_level, const char *fmt, ...)
+{
+	return 0;
+}
+
+void __attribute__((noreturn)) die(const char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	exit(1);
+}
+
+void post_code(u8 value)
+{
+}
+
+const struct mem_region_device addrspace_32bit =
+	MEM_REGION_DEV_RO_INIT(0, ~0UL);
+
+int arch_supports_bounce_buffer(void)
+{
+	return 1;
+}
+
+int bootmem_region_targets_usable_ram(uint64_t start, uint64_t size)
+{
+	return start >= FAKE_RAM && start + size <= PAYLOAD_END;
+}
+
+void bootmem_add_range(uint64_t start, uint64_t size, uint32_t type)
+{
+}
+
+void bootmem_dump_ranges(void)
+{
+}
+
+void *bootmem_allocate_buffer(size_t size)
+{
+	return size <= BOUNCE_SIZE ? (void *)BOUNCE_AREA : NULL;
+}
+
+void prog_segment_loaded(uintptr_t start, size_t size, int flags)
+{
+	/* All segments have to be in place before the first one is reported. */
+	if (segments_loaded++ == 0)
+		loaded_early = check_window(NULL) < 0;
+	final_segment = flags & SEG_FINAL;
+}
+
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+static pthread_t aps[AP_THREADS];
+static int ap_calls, num_aps;
+
+static void *ap_thread(void *func)
+{
+	((void (*)(void))func)();
+	return NULL;
+}
+
+int mp_run_on_aps(void (*func)(void), long expire_us)
+{
+	for (num_aps = 0; num_aps < AP_THREADS; num_aps++) {
+		if (pthread_create(&aps[num_aps], NULL, ap_thread, func))
+			return -1;
+	}
+	ap_calls++;
+	return 0;
+}
+
+/* The APs may still be on their way out when selfload() returns. */
+static void join_aps(void)
+{
+	while (num_aps > 0)
+		pthread_join(aps[--num_aps], NULL);
+}
+#else
+static void join_aps(void)
+{
+}
+#endif
+
+/* What the fake RAM holds before a payload is loaded */
+static u8 pattern(unsigned long addr)
+{
+	return (addr * 2654435761UL) >> 24;
+}
+
+static void fill_pattern(unsigned long start, unsigned long end)
+{
+	for (; start < end; start++)
+		*(u8 *)start = pattern(start);
+}
+
+/* Data that compresses about as well as code does */
+static void fill_data(u8 *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (i >= 64 && rand() % 4)
+			data[i] = data[i - 1 - rand() % 64];
+		else
+			data[i] = rand() % 32;
+	}
+}
+
+static void *lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+static struct ISzAlloc lzma_allocator = { lzma_alloc, lzma_free };
+
+/* Compress like cbfstool does, with the size after the properties. */
+static size_t compress_lzma(const u8 *in, size_t len, u8 *out, size_t out_len)
+{
+	const size_t header = LZMA_PROPS_SIZE + sizeof(u64);
+	size_t props_size = LZMA_PROPS_SIZE, size = out_len - header;
+	struct CLzmaEncProps props;
+
+	LzmaEncProps_Init(&props);
+	props.level = 1;
+	props.dictSize = MAX(len, 4 * KiB);
+	props.numThreads = 1;
+	if (LzmaEncode(out + header, &size, in, len, &props, out, &props_size,
+		       0, NULL, &lzma_allocator, &lzma_allocator) != SZ_OK)
+		return 0;
+	write_le64(out + LZMA_PROPS_SIZE, len);
+	return header + size;
+}
+
+/* Compress like cbfstool does, with independent blocks. */
+static size_t compress_lz4(const u8 *in, size_t len, u8 *out, size_t out_len)
+{
+	LZ4F_preferences_t prefs = {
+		.frameInfo = {
+			.blockSizeID = max4MB,
+			.blockMode = blockIndependent,
+			.contentChecksumFlag = noContentChecksum,
+		},
+	};
+	size_t size = LZ4F_compressFrame(out, out_len, in, len, &prefs);
+
+	return LZ4F_isError(size) ? 0 : size;
+}
+
+/* A segment of random type and size loaded at dst, recorded in expected[] */
+static void random_segment(struct payload_segment *seg, unsigned long dst,
+			   u32 mem_len)
+{
+	u32 len = rand() % 4 ? 1 + rand() % mem_len : mem_len;
+	size_t max = LZ4F_compressFrameBound(len, NULL) + len / 2 + 64;
+	u8 *data = malloc(len);
+	unsigned long i;
+
+	seg->load_addr = dst;
+	seg->mem_len = mem_len;
+	seg->len = 0;
+	seg->data = malloc(max);
+	fill_data(data, len);
+
+	switch (rand() % 4) {
+	case 0:
+		seg->type = PAYLOAD_SEGMENT_BSS;
+		seg->compression = CBFS_COMPRESS_NONE;
+		len = 0;
+		break;
+	case 1:
+		seg->type = PAYLOAD_SEGMENT_CODE;
+		seg->compression = CBFS_COMPRESS_LZMA;
+		seg->len = compress_lzma(data, len, seg->data, max);
+		break;
+	case 2:
+		seg->type = PAYLOAD_SEGMENT_DATA;
+		seg->compression = CBFS_COMPRESS_LZ4;
+		seg->len = compress_lz4(data, len, seg->data, max);
+		break;
+	default:
+		seg->type = PAYLOAD_SEGMENT_DATA;
+		seg->compression = CBFS_COMPRESS_NONE;
+		break;
+	}
+
+	/* Like cbfstool, store what doesn't get smaller as it is. */
+	if (len && (seg->len == 0 || seg->len >= len)) {
+		seg->compression = CBFS_COMPRESS_NONE;
+		memcpy(seg->data, data, seg->len = len);
+	}
+
+	for (i = 0; i < mem_len; i++) {
+		unsigned long offset = dst + i - WINDOW_START;
+
+		if (offset >= WINDOW_SIZE)
+			continue;
+		expected[offset] = i < len ? data[i] : 0;
+		written[offset] = 1;
+	}
+	free(data);
+}
+
+/* Serialize the segments into a SELF payload like cbfstool does. */
+static u8 *build_payload(struct payload_segment *segs, int num, u64 entry,
+			 size_t *size)
+{
+	size_t offset = (num + 2) * sizeof(struct cbfs_payload_segment);
+	struct cbfs_payload_segment *hdr;
+	u8 *payload;
+	int i;
+
+	*size = offset;
+	for (i = 0; i < num; i++)
+		*size += segs[i].len;
+	payload = malloc(*size);
+	hdr = (struct cbfs_payload_segment *)payload;
+
+	/* The loader skips parameters. */
+	write_be32(&hdr->type, PAYLOAD_SEGMENT_PARAMS);
+	for (i = 0, hdr++; i < num; i++, hdr++) {
+		write_be32(&hdr->type, segs[i].type);
+		write_be32(&hdr->compression, segs[i].compression);
+		write_be32(&hdr->offset, offset);
+		write_be64(&hdr->load_addr, segs[i].load_addr);
+		write_be32(&hdr->len, segs[i].len);
+		write_be32(&hdr->mem_len, segs[i].mem_len);
+		memcpy(payload + offset, segs[i].data, segs[i].len);
+		offset += segs[i].len;
+		free(segs[i].data);
+	}
+	write_be32(&hdr->type, PAYLOAD_SEGMENT_ENTRY);
+	write_be64(&hdr->load_addr, entry);
+	return payload;
+}
+
+static void *load(u8 *payload, size_t size, struct prog *prog)
+{
+	struct mem_region_device mdev;
+	void *entry;
+
+	mem_region_device_ro_init(&mdev, payload, size);
+	memset(prog, 0, sizeof(*prog));
+	rdev_chain(&prog->rdev, &mdev.rdev, 0, size);
+
+	segments_loaded = final_segment = 0;
+	entry = selfload(prog, true);
+	join_aps();
+	return entry;
+}
+
+static int overlaps(struct payload_segment *segs, int num, unsigned long dst,
+		    u32 mem_len)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (dst < segs[i].load_addr + segs[i].mem_len &&
+		    segs[i].load_addr < dst + mem_len)
+			return 1;
+	}
+	return 0;
+}
+
+static int check_window(const u8 *mirror)
+{
+	unsigned long addr;
+	u8 got, want;
+
+	for (addr = WINDOW_START; addr < WINDOW_END; addr++) {
+		got = *(u8 *)addr;
+		want = expected[addr - WINDOW_START];
+		if (addr >= lb_start && addr < lb_end) {
+			if (got != pattern(addr))
+				return check_failed("load",
+					"coreboot changed at 0x%lx", addr);
+			if (!mirror || !written[addr - WINDOW_START])
+				continue;
+			got = mirror[addr - lb_start];
+		}
+		if (got != want)
+			return check_failed("load",
+				"0x%lx is 0x%02x, should be 0x%02x", addr, got,
+				want);
+	}
+	return 0;
+}
+
+static int random_round(int independent)
+{
+	struct payload_segment segs[MAX_SEGMENTS];
+	int i, num = 1 + rand() % MAX_SEGMENTS;
+	u64 entry = WINDOW_START + rand() % WINDOW_SIZE;
+	struct prog prog;
+	size_t size;
+	u8 *payload;
+	void *got;
+
+	fill_pattern(WINDOW_START, WINDOW_END);
+	for (i = 0; i < WINDOW_SIZE; i++)
+		expected[i] = pattern(WINDOW_START + i);
+	memset(written, 0, WINDOW_SIZE);
+
+	/* Smaller segments for the independent ones, so that they fit. */
+	for (i = 0; i < num; i++) {
+		u32 mem_len = 1 + rand() % (MAX_MEMSZ >> (2 * independent));
+		unsigned long dst;
+
+		do {
+			dst = WINDOW_START + rand() % (WINDOW_SIZE - mem_len);
+		} while (independent && overlaps(segs, i, dst, mem_len));
+		random_segment(&segs[i], dst, mem_len);
+	}
+
+	payload = build_payload(segs, num, entry, &size);
+	got = load(payload, size, &prog);
+	free(payload);
+
+	if (got != (void *)(uintptr_t)entry)
+		return check_failed("selfload", "returned %p, not 0x%llx", got,
+				    (unsigned long long)entry);
+	if (loaded_early)
+		return check_failed("selfload",
+			"reported segments before all were loaded");
+	if (segments_loaded < num || !final_segment)
+		return check_failed("selfload",
+			"%d of %d segments reported, last one %sfinal",
+			segments_loaded, num, final_segment ? "" : "not ");
+	if (prog_size(&prog) != lb_end - lb_start)
+		return check_failed("selfload", "bounce buffer of %zu bytes",
+				    prog_size(&prog));
+	return check_window(prog_start(&prog));
+}
+
+static void bench(void)
+{
+	struct payload_segment segs[BENCH_SEGMENTS];
+	double start, best = 1e9;
+	struct prog prog;
+	size_t size;
+	u8 *payload, *data = malloc(BENCH_MEMSZ);
+	int i;
+
+	for (i = 0; i < BENCH_SEGMENTS; i++) {
+		fill_data(data, BENCH_MEMSZ);
+		segs[i].type = PAYLOAD_SEGMENT_CODE;
+		segs[i].compression = CBFS_COMPRESS_LZMA;
+		segs[i].load_addr = FAKE_RAM + i * BENCH_MEMSZ;
+		segs[i].mem_len = BENCH_MEMSZ;
+		segs[i].data = malloc(2 * BENCH_MEMSZ);
+		segs[i].len = compress_lzma(data, BENCH_MEMSZ, segs[i].data,
+					    2 * BENCH_MEMSZ);
+	}
+	free(data);
+	payload = build_payload(segs, BENCH_SEGMENTS, FAKE_RAM, &size);
+
+	for (i = 0; i < 5; i++) {
+		start = now();
+		load(payload, size, &prog);
+		best = MIN(best, now() - start);
+	}
+	free(payload);
+
+	printf("  %d x %d KiB LZMA: %8.2f ms, %6.1f MiB/s\n", BENCH_SEGMENTS,
+	       BENCH_MEMSZ / KiB, best * 1e3,
+	       BENCH_SEGMENTS * BENCH_MEMSZ / MiB / best);
+}
+
+int main(int argc, char **argv)
+{
+	int i, rounds = test_rounds(argc, argv, DEFAULT_ROUNDS);
+
+	if (lb_start < FAKE_RAM + 16 * MiB || lb_end > PAYLOAD_END - MiB) {
+		fprintf(stderr, "coreboot at 0x%lx is not in the fake RAM\n",
+			lb_start);
+		return 1;
+	}
+	if (mmap((void *)FAKE_RAM, FAKE_RAM_SIZE, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)
+	    != (void *)FAKE_RAM) {
+		perror("mapping the fake RAM");
+		return 1;
+	}
+	expected = malloc(WINDOW_SIZE);
+	written = malloc(WINDOW_SIZE);
+
+	srand(1);
+	for (i = 0; i < rounds; i++) {
+		if (random_round(i % 2) < 0) {
+			printf("selfboot (%s): FAILED in round %d\n", LOADER,
+			       i);
+			return 1;
+		}
+	}
+	printf("selfboot (%s): %d random payloads passed\n", LOADER, rounds);
+#if IS_ENABLED(CONFIG_PAYLOAD_LOAD_ON_APS)
+	printf("  %d of them loaded with the APs\n", ap_calls);
+#endif
+
+	bench();
+	return 0;
+}
@@ -0,0 +1,410 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Test for src/drivers/spi/sfdp.c
+ *
+ * Probes flash models with SFDP tables like those of a few real parts
+ * through spi_flash_probe(), checks what was parsed, and reads, programs
+ * and erases them with controllers supporting different read modes. The
+ * models reject read commands with the wrong opcode, address length or
+ * dummy cycles. Reports the SPI clock cycles needed to read 1 MiB with the
+ * command that was picked, and checks that erases use the largest block
+ * erase that fits and skip blocks that are erased already.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <boot_device.h>
+#include <boot/coreboot_tables.h>
+
+#include "spi-flash-model.h"
+#include "test-helpers.h"
+#include "../../src/drivers/spi/spi_flash_internal.h"
+
+#define DUAL_MODES	(SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_2) | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_2_2))
+#define QUAD_MODES	(DUAL_MODES | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_4) | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_4_4))
+
+/* Stubs for what spi_flash.c uses from the rest of coreboot */
+struct lb_record *lb_new_record(struct lb_header *header)
+{
+	return NULL;
+}
+
+const struct spi_flash *boot_device_spi_flash(void)
+{
+	return NULL;
+}
+
+int chipset_volatile_group_begin(const struct spi_flash *flash)
+{
+	return 0;
+}
+
+int chipset_volatile_group_end(const struct spi_flash *flash)
+{
+	return 0;
+}
+
+/*
+ * Like a W25Q256: 32 MiB, 3- or 4-byte addresses, here with the 4-byte
+ * address instruction table. JESD216B.
+ */
+static const u8 sfdp_w25q256[] = {
+	/* SFDP header, 2 parameter headers */
+	0x53, 0x46, 0x44, 0x50, 0x06, 0x01, 0x01, 0xff,
+	/* BFPT, 16 DWORDs at 0x30 */
+	0x00, 0x06, 0x01, 0x10, 0x30, 0x00, 0x00, 0xff,
+	/* 4BAIT, 2 DWORDs at 0x20 */
+	0x84, 0x00, 0x01, 0x02, 0x20, 0x00, 0x00, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	/* 4BAIT */
+	0x7f, 0x0e, 0x00, 0x00, 0x21, 0x5c, 0xdc, 0x00,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	/* BFPT */
+	0xe5, 0x20, 0xfb, 0xff, 0xff, 0xff, 0xff, 0x0f,
+	0x44, 0xeb, 0x08, 0x6b, 0x08, 0x3b, 0x04, 0xbb,
+	0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0xff,
+	0xff, 0xff, 0x44, 0xeb, 0x0c, 0x20, 0x0f, 0x52,
+	0x10, 0xd8, 0x00, 0xff, 0x23, 0x72, 0xf5, 0x00,
+	0x82, 0xed, 0x04, 0xcc, 0x44, 0x83, 0x48, 0x44,
+	0x30, 0xb0, 0x30, 0xb0, 0xf7, 0xc4, 0xd5, 0x5c,
+	0x00, 0xbe, 0x29, 0xff, 0xf0, 0xd0, 0xff, 0xff,
+};
+
+/*
+ * A JESD216 (rev 1.0) part no driver knows: 8 MiB, 9 DWORD BFPT, only
+ * 1-1-2 reads, 4K and 64K erase, no page size.
+ */
+static const u8 sfdp_unknown[] = {
+	0x53, 0x46, 0x44, 0x50, 0x00, 0x01, 0x00, 0xff,
+	0x00, 0x00, 0x01, 0x09, 0x10, 0x00, 0x00, 0xff,
+	0xe5, 0x20, 0x81, 0xff, 0xff, 0xff, 0xff, 0x03,
+	0xff, 0x00, 0xff, 0x00, 0x08, 0x3b, 0xff, 0x00,
+	0xee, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0xff,
+	0xff, 0xff, 0x00, 0xff, 0x0c, 0x20, 0x10, 0xd8,
+	0x00, 0xff, 0x00, 0xff,
+};
+
+static struct flash_model w25q128 = {
+	.name = "W25Q128 (vendor driver)",
+	.id = { 0xef, 0x40, 0x18 },
+	.sfdp = flash_model_sfdp_w25q128,
+	.sfdp_size = FLASH_MODEL_SFDP_W25Q128_SIZE,
+	.size = 16 * MiB,
+	.page_size = 256,
+	.reads = {
+		{ 0x3b, SPI_FLASH_IO_1_1_2, 3, 8 },
+		{ 0xbb, SPI_FLASH_IO_1_2_2, 3, 4 },
+		{ 0x6b, SPI_FLASH_IO_1_1_4, 3, 8 },
+		{ 0xeb, SPI_FLASH_IO_1_4_4, 3, 6 },
+	},
+	.erases = {
+		{ 0x52, 3, 32 * KiB },
+	},
+};
+
+static struct flash_model w25q256 = {
+	.name = "W25Q256 (vendor driver, 4-byte reads)",
+	.id = { 0xef, 0x40, 0x19 },
+	.sfdp = sfdp_w25q256,
+	.sfdp_size = sizeof(sfdp_w25q256),
+	.size = 32 * MiB,
+	.page_size = 256,
+	.reads = {
+		{ 0x3b, SPI_FLASH_IO_1_1_2, 3, 8 },
+		{ 0xbb, SPI_FLASH_IO_1_2_2, 3, 4 },
+		{ 0x6b, SPI_FLASH_IO_1_1_4, 3, 8 },
+		{ 0xeb, SPI_FLASH_IO_1_4_4, 3, 6 },
+		{ 0x0c, SPI_FLASH_IO_1_1_1, 4, 8 },
+		{ 0x3c, SPI_FLASH_IO_1_1_2, 4, 8 },
+		{ 0xbc, SPI_FLASH_IO_1_2_2, 4, 4 },
+		{ 0x6c, SPI_FLASH_IO_1_1_4, 4, 8 },
+		{ 0xec, SPI_FLASH_IO_1_4_4, 4, 6 },
+	},
+	.erases = {
+		{ 0x52, 3, 32 * KiB },
+		{ 0x21, 4, 4 * KiB },
+		{ 0x5c, 4, 32 * KiB },
+		{ 0xdc, 4, 64 * KiB },
+	},
+};
+
+static struct flash_model unknown = {
+	.name = "unknown part (SFDP only)",
+	.id = { 0x7f, 0x70, 0x17 },
+	.sfdp = sfdp_unknown,
+	.sfdp_size = sizeof(sfdp_unknown),
+	.size = 8 * MiB,
+	.page_size = 256,
+	.reads = {
+		{ 0x3b, SPI_FLASH_IO_1_1_2, 3, 8 },
+	},
+};
+
+static struct flash_model no_sfdp = {
+	.name = "unknown part without SFDP",
+	.id = { 0x7f, 0x70, 0x16 },
+	.size = 4 * MiB,
+	.page_size = 256,
+};
+
+static void fill_random(struct flash_model *m)
+{
+	u32 i;
+
+	for (i = 0; i < m->size; i++)
+		m->data[i] = rand();
+}
+
+/* Read random pieces, including the end and above 16 MiB, and compare. */
+static void check_reads(struct flash_model *m, const struct spi_flash *flash)
+{
+	static u8 buf[64 * KiB];
+	u32 offsets[16];
+	int i;
+
+	offsets[0] = 0;
+	offsets[1] = m->size - sizeof(buf);
+	for (i = 2; i < ARRAY_SIZE(offsets); i++)
+		offsets[i] = rand() % (m->size - sizeof(buf));
+
+	for (i = 0; i < ARRAY_SIZE(offsets); i++) {
+		size_t len = 1 + rand() % sizeof(buf);
+
+		memset(buf, 0, sizeof(buf));
+		CHECK(spi_flash_read(flash, offsets[i], len, buf) == 0);
+		CHECK(memcmp(buf, m->data + offsets[i], len) == 0);
+	}
+	CHECK(m->errors == 0);
+}
+
+static void report_bandwidth(struct flash_model *m,
+			     const struct spi_flash *flash)
+{
+	static u8 buf[MiB];
+	static const char *const modes[] = {
+		"1-1-1", "1-1-2", "1-2-2", "1-1-4", "1-4-4",
+	};
+	int mode = flash->read_cmd.opcode ? flash->read_cmd.io_mode : 0;
+
+	flash_model_reset_stats(m);
+	CHECK(spi_flash_read(flash, 0, sizeof(buf), buf) == 0);
+	printf("  read opcode %02x %s: %llu cycles for 1 MiB\n",
+	       flash->read_cmd.opcode, modes[mode], m->cycles);
+}
+
+static void check_write_erase(struct flash_model *m,
+			      const struct spi_flash *flash)
+{
+	static u8 buf[3 * KiB], back[3 * KiB];
+	u32 offset = 2 * flash->sector_size;
+	u32 i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = rand();
+
+	CHECK(spi_flash_erase(flash, offset, flash->sector_size) == 0);
+	for (i = 0; i < flash->sector_size; i++)
+		if (m->data[offset + i] != 0xff)
+			break;
+	CHECK(i == flash->sector_size);
+
+	/* Unaligned, across pages */
+	CHECK(spi_flash_write(flash, offset + 100, sizeof(buf), buf) == 0);
+	CHECK(spi_flash_read(flash, offset + 100, sizeof(back), back) == 0);
+	CHECK(memcmp(buf, back, sizeof(buf)) == 0);
+	CHECK(m->errors == 0);
+}
+
+/* Erase commands of the given size the model executed */
+static unsigned long erases_of_size(struct flash_model *m, u32 size)
+{
+	unsigned long n = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(m->erases); i++)
+		if (m->erases[i].opcode && m->erases[i].size == size)
+			n += m->erase_count[i];
+	return n;
+}
+
+static int range_erased(struct flash_model *m, u32 offset, u32 len)
+{
+	u32 i;
+
+	for (i = 0; i < len; i++)
+		if (m->data[offset + i] != 0xff)
+			return 0;
+	return 1;
+}
+
+/*
+ * Erase ranges the block erases fit in, and check that the largest ones
+ * are used, and that blocks erased already aren't erased again. All parts
+ * have 4K and 64K erase, some also 32K.
+ */
+static void check_block_erase(struct flash_model *m,
+			      const struct spi_flash *flash)
+{
+	u32 offset = MiB;
+	u32 len = 64 * KiB + 32 * KiB + 4 * KiB;
+	int has_32k = 0;
+	int i;
+
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES; i++)
+		if (flash->erase_types[i].size_shift == 15)
+			has_32k = 1;
+
+	flash_model_reset_stats(m);
+	CHECK(spi_flash_erase(flash, offset, len) == 0);
+	CHECK(range_erased(m, offset, len));
+	CHECK(erases_of_size(m, 64 * KiB) == 1);
+	CHECK(erases_of_size(m, 32 * KiB) == has_32k);
+	CHECK(erases_of_size(m, 4 * KiB) == (has_32k ? 1 : 9));
+	printf("  erase 100 KiB: %lu transactions\n", m->transactions);
+
+	flash_model_reset_stats(m);
+	CHECK(spi_flash_erase(flash, offset, len) == 0);
+	CHECK(erases_of_size(m, 64 * KiB) + erases_of_size(m, 32 * KiB) +
+	      erases_of_size(m, 4 * KiB) == 0);
+	printf("  erase 100 KiB again: %lu transactions\n", m->transactions);
+
+	/* Only the block with the byte in it needs erasing. */
+	m->data[offset + 64 * KiB + 100] = 0;
+	flash_model_reset_stats(m);
+	CHECK(spi_flash_erase(flash, offset, len) == 0);
+	CHECK(range_erased(m, offset, len));
+	CHECK(erases_of_size(m, 32 * KiB) == has_32k);
+	CHECK(erases_of_size(m, 4 * KiB) == !has_32k);
+	CHECK(erases_of_size(m, 64 * KiB) == 0);
+
+	/* Not 32K aligned: 4K erases up to the 32K boundary */
+	memset(m->data + offset, 0, 2 * len);
+	flash_model_reset_stats(m);
+	CHECK(spi_flash_erase(flash, offset + 4 * KiB, 64 * KiB) == 0);
+	CHECK(range_erased(m, offset + 4 * KiB, 64 * KiB));
+	CHECK(m->data[offset + 4 * KiB - 1] == 0);
+	CHECK(m->data[offset + 68 * KiB] == 0);
+	CHECK(erases_of_size(m, 4 * KiB) == (has_32k ? 8 : 16));
+	CHECK(erases_of_size(m, 32 * KiB) == has_32k);
+	CHECK(erases_of_size(m, 64 * KiB) == 0);
+	CHECK(m->errors == 0);
+}
+
+static void test_part(struct flash_model *m, int expect_sfdp)
+{
+	static const struct {
+		const char *name;
+		u32 modes;
+	} ctrlrs[] = {
+		{ "single I/O controller", 0 },
+		{ "dual I/O controller", DUAL_MODES },
+		{ "quad I/O controller", QUAD_MODES },
+	};
+	struct spi_flash flash;
+	int i;
+
+	printf("%s:\n", m->name);
+	flash_model_add_common(m);
+	flash_model_init(m);
+	fill_random(m);
+
+	for (i = 0; i < ARRAY_SIZE(ctrlrs); i++) {
+		printf(" %s\n", ctrlrs[i].name);
+		flash_model_ctrlr.flash_read_modes = ctrlrs[i].modes;
+
+		if (spi_flash_probe(0, 0, &flash)) {
+			CHECK(!expect_sfdp);
+			printf("  not detected\n");
+			return;
+		}
+		CHECK(expect_sfdp);
+		CHECK(flash.size == m->size);
+		CHECK(flash.read_cmd.opcode != 0);
+
+		check_reads(m, &flash);
+		report_bandwidth(m, &flash);
+	}
+	check_write_erase(m, &flash);
+	check_block_erase(m, &flash);
+}
+
+static void test_parse(void)
+{
+	struct spi_slave spi;
+	struct spi_flash_sfdp sfdp;
+
+	printf("parser:\n");
+	spi_setup_slave(0, 0, &spi);
+
+	flash_model_init(&w25q128);
+	CHECK(spi_flash_sfdp_parse(&spi, &sfdp) == 0);
+	CHECK(sfdp.size == 16 * MiB);
+	CHECK(sfdp.page_size == 256);
+	CHECK(sfdp.addr_modes == SFDP_ADDR_3B);
+	CHECK(sfdp.read_modes == 0x1f);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_4_4].opcode == 0xeb);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_4_4].dummy_cycles == 6);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_2_2].opcode == 0xbb);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_2_2].dummy_cycles == 4);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_1_4].opcode == 0x6b);
+	CHECK(sfdp.read_cmds[SPI_FLASH_IO_1_1_2].dummy_cycles == 8);
+	CHECK(sfdp.erase_types[0].opcode == 0x20);
+	CHECK(sfdp.erase_types[0].size_shift == 12);
+	CHECK(sfdp.erase_types[1].opcode == 0x52);
+	CHECK(sfdp.erase_types[1].size_shift == 15);
+	CHECK(sfdp.erase_types[2].opcode == 0xd8);
+	CHECK(sfdp.erase_types[2].size_shift == 16);
+	CHECK(sfdp.erase_types[3].size_shift == 0);
+	CHECK(sfdp.read_opcodes_4b[SPI_FLASH_IO_1_4_4] == 0);
+
+	flash_model_init(&w25q256);
+	CHECK(spi_flash_sfdp_parse(&spi, &sfdp) == 0);
+	CHECK(sfdp.size == 32 * MiB);
+	CHECK(sfdp.addr_modes == (SFDP_ADDR_3B | SFDP_ADDR_4B));
+	CHECK(sfdp.read_opcodes_4b[SPI_FLASH_IO_1_1_1] == 0x0c);
+	CHECK(sfdp.read_opcodes_4b[SPI_FLASH_IO_1_4_4] == 0xec);
+
+	flash_model_init(&unknown);
+	CHECK(spi_flash_sfdp_parse(&spi, &sfdp) == 0);
+	CHECK(sfdp.size == 8 * MiB);
+	CHECK(sfdp.page_size == 256);
+	CHECK(sfdp.read_modes == (SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_1) |
+				  SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_2)));
+
+	flash_model_init(&no_sfdp);
+	CHECK(spi_flash_sfdp_parse(&spi, &sfdp) != 0);
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_parse();
+	test_part(&w25q128, 1);
+	test_part(&w25q256, 1);
+	test_part(&unknown, 1);
+	test_part(&no_sfdp, 0);
+
+	if (failures) {
+		printf("sfdp: %d checks FAILED\n", failures);
+		return 1;
+	}
+	printf("sfdp: all checks passed\n");
+	return 0;
+}
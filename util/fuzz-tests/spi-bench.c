@@ -0,0 +1,459 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Benchmark for the SPI flash path of a boot
+ *
+ * Builds a CBFS in a spi-flash-model.c part with the timing of a W25Q128
+ * at 50 MHz and runs what a boot does with the flash through the SPI flash
+ * drivers, lib/cbfs.c and lib/region_file.c: probing, CBFS lookups, stage
+ * loads, an MRC cache update and ELOG event writes. The boot device is
+ * cbfs_spi.c, or with BOOT_DEVICE_RW_NOMMAP boot_device_rw_nommap.c for
+ * writes and a memory mapped flash for reads, like on x86. Reports the
+ * transactions, status reads and simulated time of each of them, for
+ * controllers with single, dual and quad I/O reads, and fails if data
+ * read back is wrong or the part saw a bad command.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boot_device.h>
+#include <boot/coreboot_tables.h>
+#include <cbfs.h>
+#include <commonlib/compression.h>
+#include <commonlib/endian.h>
+#include <fmap.h>
+#include <program_loading.h>
+#include <region_file.h>
+#include <symbols.h>
+
+#include "fmap_config.h"
+#include "spi-flash-model.h"
+#include "test-helpers.h"
+
+#define DUAL_MODES	(SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_2) | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_2_2))
+#define QUAD_MODES	(DUAL_MODES | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_1_4) | \
+			 SPI_FLASH_IO_MODE(SPI_FLASH_IO_1_4_4))
+
+/* Flash layout, the COREBOOT region is in include/fmap_config.h. */
+#define ELOG_OFFSET		0x400000
+#define ELOG_SIZE		(4 * KiB)
+#define MRC_OFFSET		0x410000
+#define MRC_SIZE		(64 * KiB)
+#define CBFS_OFFSET		___FMAP__COREBOOT_BASE
+#define CBFS_END		(CONFIG_ROM_SIZE - 64 * KiB) /* bootblock */
+
+#define CBFS_CACHE_SIZE		0x20000
+#define MRC_DATA_SIZE		(24 * KiB)
+#define MRC_BOOTS		10
+#define ELOG_EVENT_SIZE		16
+#define ELOG_BOOTS		100
+#define ELOG_EVENTS_PER_BOOT	3
+
+/* Stubs for what the code under test uses from the rest of coreboot */
+struct lb_record *lb_new_record(struct lb_header *header)
+{
+	return NULL;
+}
+
+int chipset_volatile_group_begin(const struct spi_flash *flash)
+{
+	return 0;
+}
+
+int chipset_volatile_group_end(const struct spi_flash *flash)
+{
+	return 0;
+}
+
+const struct mem_region_device addrspace_32bit =
+	MEM_REGION_DEV_RO_INIT(0, ~0UL);
+
+void prog_segment_loaded(uintptr_t start, size_t size, int flags)
+{
+}
+
+int fmap_locate_area_as_rdev(const char *name, struct region_device *area)
+{
+	return -1;
+}
+
+/* The stages are stored uncompressed. */
+size_t ulz4fn(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	return 0;
+}
+
+size_t ulzman(const void *src, size_t srcn, void *dst, size_t dstn)
+{
+	return 0;
+}
+
+#if defined(BOOT_DEVICE_RW_NOMMAP)
+static struct mem_region_device mapped_flash;
+
+/* Reads of the memory mapped flash don't go through the controller. */
+const struct region_device *boot_device_ro(void)
+{
+	return &mapped_flash.rdev;
+}
+
+#define BOOT_DEVICE "boot_device_rw_nommap.c"
+#else
+/* The linker script provides the cache cbfs_spi.c maps CBFS data to. */
+u8 _cbfs_cache[CBFS_CACHE_SIZE];
+#define STR(x) #x
+#define XSTR(x) STR(x)
+asm(".globl _ecbfs_cache\n"
+    ".set _ecbfs_cache, _cbfs_cache + " XSTR(CBFS_CACHE_SIZE));
+asm(".globl _preram_cbfs_cache\n.set _preram_cbfs_cache, _cbfs_cache\n"
+    ".globl _epreram_cbfs_cache\n.set _epreram_cbfs_cache, _ecbfs_cache\n"
+    ".globl _postram_cbfs_cache\n.set _postram_cbfs_cache, _cbfs_cache\n"
+    ".globl _epostram_cbfs_cache\n.set _epostram_cbfs_cache, _ecbfs_cache");
+
+#define BOOT_DEVICE "cbfs_spi.c"
+#endif
+
+static struct flash_model w25q128 = {
+	.name = "W25Q128",
+	.id = { 0xef, 0x40, 0x18 },
+	.sfdp = flash_model_sfdp_w25q128,
+	.sfdp_size = FLASH_MODEL_SFDP_W25Q128_SIZE,
+	.size = 16 * MiB,
+	.page_size = 256,
+	.reads = {
+		{ 0x3b, SPI_FLASH_IO_1_1_2, 3, 8 },
+		{ 0xbb, SPI_FLASH_IO_1_2_2, 3, 4 },
+		{ 0x6b, SPI_FLASH_IO_1_1_4, 3, 8 },
+		{ 0xeb, SPI_FLASH_IO_1_4_4, 3, 6 },
+	},
+	/* Typical times from the datasheet */
+	.erases = {
+		{ 0x20, 3, 4 * KiB, 45000 },
+		{ 0x52, 3, 32 * KiB, 120000 },
+		{ 0xd8, 3, 64 * KiB, 150000 },
+	},
+	.clock_khz = 50000,
+	.xfer_ns = 1000,
+	.program_us = 700,
+};
+
+struct bench_file {
+	const char *name;
+	u32 type;
+	u32 size;
+	u32 offset;	/* of the data in the flash */
+};
+
+/* Something like the CBFS of an x86 board */
+static struct bench_file files[] = {
+	{ "cbfs master header", CBFS_TYPE_RAW, sizeof(struct cbfs_header) },
+	{ "fallback/romstage", CBFS_TYPE_STAGE, 64 * KiB },
+	{ "cpu_microcode_blob.bin", CBFS_TYPE_MICROCODE, 96 * KiB },
+	{ "fsps.bin", CBFS_TYPE_FSP, 192 * KiB },
+	{ "fallback/postcar", CBFS_TYPE_STAGE, 16 * KiB },
+	{ "fallback/ramstage", CBFS_TYPE_STAGE, 128 * KiB },
+	{ "config", CBFS_TYPE_RAW, 4 * KiB },
+	{ "revision", CBFS_TYPE_RAW, 1 * KiB },
+	{ "cmos_layout.bin", CBFS_COMPONENT_CMOS_LAYOUT, 2 * KiB },
+	{ "fallback/dsdt.aml", CBFS_TYPE_RAW, 16 * KiB },
+	{ "vbt.bin", CBFS_TYPE_RAW, 8 * KiB },
+	{ "pci8086,0406.rom", CBFS_TYPE_OPTIONROM, 64 * KiB },
+	{ "fallback/payload", CBFS_TYPE_PAYLOAD, 256 * KiB },
+};
+
+static u8 stage_buffer[256 * KiB];
+/* Add a file at offset, return where the next one goes. */
+static u32 cbfs_add(u32 offset, const char *name, u32 type, u32 len,
+		    u32 *data_offset)
+{
+	struct cbfs_file *f = (void *)(w25q128.data + offset);
+	u32 hdr = ALIGN_UP(sizeof(*f) + strlen(name) + 1, 16);
+
+	memset(f, 0, hdr);
+	memcpy(f->magic, CBFS_FILE_MAGIC, sizeof(f->magic));
+	write_be32(&f->len, len);
+	write_be32(&f->type, type);
+	write_be32(&f->offset, hdr);
+	strcpy((char *)(f + 1), name);
+	*data_offset = offset + hdr;
+
+	return ALIGN_UP(offset + hdr + len, CBFS_ALIGNMENT);
+}
+
+static void build_cbfs(void)
+{
+	struct cbfs_header *header;
+	struct cbfs_stage *stage;
+	s32 rel_offset;
+	u32 offset = CBFS_OFFSET;
+	u32 empty;
+	size_t i, j;
+
+	for (i = 0; i < ARRAY_SIZE(files); i++) {
+		offset = cbfs_add(offset, files[i].name, files[i].type,
+				  files[i].size, &files[i].offset);
+		for (j = 0; j < files[i].size; j++)
+			w25q128.data[files[i].offset + j] = rand();
+
+		if (files[i].type != CBFS_TYPE_STAGE)
+			continue;
+
+		/* Stage headers are in the byte order of the CPU. */
+		stage = (void *)(w25q128.data + files[i].offset);
+		stage->compression = CBFS_COMPRESS_NONE;
+		stage->load = (uintptr_t)stage_buffer;
+		stage->entry = stage->load;
+		stage->len = files[i].size - sizeof(*stage);
+		stage->memlen = stage->len + 4 * KiB;
+	}
+
+	/* cbfstool fills the free space with an empty file. */
+	cbfs_add(offset, "", CBFS_TYPE_DELETED2, 0, &empty);
+	write_be32(&((struct cbfs_file *)(w25q128.data + offset))->len,
+		   CBFS_END - empty);
+
+	header = (void *)(w25q128.data + files[0].offset);
+	write_be32(&header->magic, CBFS_HEADER_MAGIC);
+	write_be32(&header->version, CBFS_HEADER_VERSION);
+	write_be32(&header->romsize, CBFS_END);
+	write_be32(&header->align, CBFS_ALIGNMENT);
+	write_be32(&header->offset, CBFS_OFFSET);
+
+	rel_offset = files[0].offset -
+		(___FMAP__COREBOOT_BASE + ___FMAP__COREBOOT_SIZE);
+	memcpy(w25q128.data + CONFIG_ROM_SIZE - sizeof(rel_offset), &rel_offset,
+	       sizeof(rel_offset));
+}
+
+static void probe(void)
+{
+	CHECK(boot_device_spi_flash() != NULL);
+}
+
+/* Look every file up, and one that isn't there. */
+static void cbfs_lookups(void)
+{
+	struct cbfsf fh;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(files); i++) {
+		CHECK(cbfs_boot_locate(&fh, files[i].name, NULL) == 0);
+		CHECK(region_device_sz(&fh.data) == files[i].size);
+	}
+	CHECK(cbfs_boot_locate(&fh, "fallback/verstage", NULL) < 0);
+}
+
+static void load_stage(const char *name)
+{
+	struct prog stage = PROG_INIT(PROG_RAMSTAGE, name);
+	struct cbfsf fh;
+	uint32_t type = CBFS_TYPE_STAGE;
+	size_t i;
+
+	memset(stage_buffer, 0, sizeof(stage_buffer));
+	if (cbfs_boot_locate(&fh, name, &type)) {
+		CHECK(!"stage found");
+		return;
+	}
+	cbfs_file_data(prog_rdev(&stage), &fh);
+	CHECK(cbfs_prog_stage_load(&stage) == 0);
+
+	for (i = 0; i < ARRAY_SIZE(files); i++)
+		if (!strcmp(files[i].name, name))
+			CHECK(!memcmp(stage_buffer, w25q128.data +
+				      files[i].offset + sizeof(struct cbfs_stage),
+				      files[i].size - sizeof(struct cbfs_stage)));
+}
+
+static void stage_loads(void)
+{
+	load_stage("fallback/romstage");
+	load_stage("fallback/postcar");
+	load_stage("fallback/ramstage");
+}
+
+/*
+ * Boots with memory training data like mrc_cache.c handles it: read the
+ * latest copy, and write a new one when the training result changed, which
+ * it does every few boots.
+ */
+static void mrc_cache_updates(void)
+{
+	static u8 data[MRC_DATA_SIZE], back[MRC_DATA_SIZE];
+	const struct region region = { .offset = MRC_OFFSET, .size = MRC_SIZE };
+	struct region_device read_rdev, write_rdev, latest;
+	const struct region_device *backing;
+	struct incoherent_rdev irdev;
+	struct region_file cache;
+	int boot;
+	size_t i;
+
+	CHECK(boot_device_ro_subregion(&region, &read_rdev) == 0);
+	CHECK(boot_device_rw_subregion(&region, &write_rdev) == 0);
+	backing = incoherent_rdev_init(&irdev, &region, &read_rdev,
+				       &write_rdev);
+	if (!backing) {
+		CHECK(backing != NULL);
+		return;
+	}
+
+	for (boot = 0; boot < MRC_BOOTS; boot++) {
+		if (boot % 4 == 0)
+			for (i = 0; i < sizeof(data); i++)
+				data[i] = rand();
+
+		CHECK(region_file_init(&cache, backing) == 0);
+		if (region_file_data(&cache, &latest) == 0 &&
+		    region_device_sz(&latest) == sizeof(data) &&
+		    rdev_readat(&latest, back, 0, sizeof(back)) == sizeof(back) &&
+		    !memcmp(data, back, sizeof(data)))
+			continue;
+
+		CHECK(region_file_update_data(&cache, data, sizeof(data)) == 0);
+	}
+}
+
+/*
+ * Boots that add events like elog.c: read the whole log, append the
+ * events one by one, and when it is 3/4 full erase it and write back the
+ * newest quarter.
+ */
+static void elog_updates(void)
+{
+	const struct region region = { .offset = ELOG_OFFSET,
+				       .size = ELOG_SIZE };
+	static u8 log[ELOG_SIZE];
+	struct region_device nv;
+	u8 event[ELOG_EVENT_SIZE];
+	size_t used, keep;
+	int boot, i;
+
+	CHECK(boot_device_rw_subregion(&region, &nv) == 0);
+
+	for (boot = 0; boot < ELOG_BOOTS; boot++) {
+		CHECK(rdev_readat(&nv, log, 0, sizeof(log)) == sizeof(log));
+		for (used = 0; used < sizeof(log) && log[used] != 0xff;
+		     used += ELOG_EVENT_SIZE)
+			;
+
+		if (used >= sizeof(log) * 3 / 4) {
+			keep = sizeof(log) / 4;
+			CHECK(rdev_eraseat(&nv, 0, sizeof(log)) == sizeof(log));
+			CHECK(rdev_writeat(&nv, log + used - keep, 0, keep) ==
+			      keep);
+			used = keep;
+		}
+
+		for (i = 0; i < ELOG_EVENTS_PER_BOOT; i++) {
+			memset(event, boot, sizeof(event));
+			event[0] = 1 + i;
+			CHECK(rdev_writeat(&nv, event, used, sizeof(event)) ==
+			      sizeof(event));
+			used += sizeof(event);
+		}
+	}
+
+	/* The newest event is at the end of the log. */
+	CHECK(rdev_readat(&nv, log, 0, sizeof(log)) == sizeof(log));
+	CHECK(!memcmp(log + used - sizeof(event), event, sizeof(event)));
+}
+
+static void run(const char *name, void (*workload)(void))
+{
+	struct flash_model *m = &w25q128;
+	u64 start = m->now_ns;
+	unsigned long erases = 0;
+	int i;
+
+#if defined(BOOT_DEVICE_RW_NOMMAP)
+	/* CBFS is read through the mapping, which the model doesn't see. */
+	if (workload == cbfs_lookups || workload == stage_loads) {
+		printf("  %-14s %8s\n", name, "n/a (mmap)");
+		return;
+	}
+#endif
+
+	flash_model_reset_stats(m);
+	workload();
+	for (i = 0; i < ARRAY_SIZE(m->erase_count); i++)
+		erases += m->erase_count[i];
+
+	printf("  %-14s %8lu %8lu %7lu %8lu %11.3f %11.3f\n", name,
+	       m->transactions, m->status_reads, erases, m->programs,
+	       (m->now_ns - start) / 1e6, m->busy_ns / 1e6);
+	CHECK(m->errors == 0);
+}
+
+static int bench(const char *ctrlr, u32 modes)
+{
+	flash_model_ctrlr.flash_read_modes = modes;
+
+	printf("%s, %s:\n", ctrlr, BOOT_DEVICE);
+	printf("  %-14s %8s %8s %7s %8s %11s %11s\n", "workload",
+	       "xfers", "status", "erases", "programs", "time ms", "busy ms");
+	run("probe", probe);
+	run("cbfs lookups", cbfs_lookups);
+	run("stage loads", stage_loads);
+	run("mrc cache", mrc_cache_updates);
+	run("elog", elog_updates);
+	printf("  total simulated time %.3f ms\n", w25q128.now_ns / 1e6);
+
+	return failures ? 1 : 0;
+}
+
+int main(void)
+{
+	static const struct {
+		const char *name;
+		u32 modes;
+	} ctrlrs[] = {
+		{ "single I/O controller", 0 },
+		{ "dual I/O controller", DUAL_MODES },
+		{ "quad I/O controller", QUAD_MODES },
+	};
+	int status, ret = 0;
+	size_t i;
+	pid_t pid;
+
+	srand(1);
+	flash_model_add_common(&w25q128);
+	flash_model_init(&w25q128);
+	build_cbfs();
+#if defined(BOOT_DEVICE_RW_NOMMAP)
+	mem_region_device_ro_init(&mapped_flash, w25q128.data, w25q128.size);
+#endif
+
+	/* The boot device code probes once, so each run gets a process. */
+	for (i = 0; i < ARRAY_SIZE(ctrlrs); i++) {
+		fflush(stdout);
+		pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0)
+			exit(bench(ctrlrs[i].name, ctrlrs[i].modes));
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status))
+			ret = 1;
+	}
+
+	printf("spi-bench (%s): %s\n", BOOT_DEVICE, ret ? "FAILED" : "passed");
+	return ret;
+}
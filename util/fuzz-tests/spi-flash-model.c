@@ -0,0 +1,408 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * A transaction lasts from claim_bus() to release_bus(). The bytes sent in
+ * it are collected, reads are answered from them as they come, and program
+ * and erase commands take effect when the transaction ends, like on a real
+ * part when chip select goes high. Commands the part doesn't know, read
+ * commands with the wrong address length or number of dummy cycles, and
+ * commands other than reading the status while the part is busy are
+ * counted as errors, and their data is garbage.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <commonlib/helpers.h>
+#include <delay.h>
+#include <timer.h>
+
+#include "spi-flash-model.h"
+
+#define CMD_WRITE_STATUS	0x01
+#define CMD_PAGE_PROGRAM	0x02
+#define CMD_WRITE_DISABLE	0x04
+#define CMD_READ_STATUS		0x05
+#define CMD_WRITE_ENABLE	0x06
+#define CMD_PAGE_PROGRAM_4B	0x12
+#define CMD_READ_SFDP		0x5a
+#define CMD_READ_ID		0x9f
+
+#define STATUS_WIP		(1 << 0)
+#define STATUS_WEL		(1 << 1)
+
+#define GARBAGE			0xa5
+
+static struct flash_model *model;
+
+/*
+ * Like a W25Q128: 16 MiB, 3-byte addresses, all dual and quad reads,
+ * 4K/32K/64K erase. JESD216B, 16 DWORD BFPT.
+ */
+const u8 flash_model_sfdp_w25q128[FLASH_MODEL_SFDP_W25Q128_SIZE] = {
+	/* SFDP header, 1 parameter header */
+	0x53, 0x46, 0x44, 0x50, 0x06, 0x01, 0x00, 0xff,
+	/* BFPT, 16 DWORDs at 0x10 */
+	0x00, 0x06, 0x01, 0x10, 0x10, 0x00, 0x00, 0xff,
+	0xe5, 0x20, 0xf9, 0xff, 0xff, 0xff, 0xff, 0x07,
+	0x44, 0xeb, 0x08, 0x6b, 0x08, 0x3b, 0x42, 0xbb,
+	0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00,
+	0xff, 0xff, 0x40, 0xeb, 0x0c, 0x20, 0x0f, 0x52,
+	0x10, 0xd8, 0x00, 0x00, 0x36, 0x02, 0xa6, 0x00,
+	0x82, 0xea, 0x14, 0xc4, 0xe9, 0x63, 0x76, 0x33,
+	0x7a, 0x75, 0x7a, 0x75, 0xf7, 0xa2, 0xd5, 0x5c,
+	0x19, 0xf7, 0x4d, 0xff, 0xe9, 0x30, 0xf8, 0x80,
+};
+
+static int bad_transaction;
+
+void flash_model_add_common(struct flash_model *m)
+{
+	static const struct flash_model_read reads[] = {
+		{ 0x03, SPI_FLASH_IO_1_1_1, 3, 0 },
+		{ 0x0b, SPI_FLASH_IO_1_1_1, 3, 8 },
+	};
+	static const struct flash_model_erase erases[] = {
+		{ 0x20, 3, 4 * KiB },
+		{ 0xd8, 3, 64 * KiB },
+	};
+	size_t i, j;
+
+	for (i = 0, j = 0; i < ARRAY_SIZE(m->reads) && j < ARRAY_SIZE(reads);
+	     i++)
+		if (!m->reads[i].opcode)
+			m->reads[i] = reads[j++];
+	for (i = 0, j = 0; i < ARRAY_SIZE(m->erases) && j < ARRAY_SIZE(erases);
+	     i++)
+		if (!m->erases[i].opcode)
+			m->erases[i] = erases[j++];
+}
+
+void flash_model_init(struct flash_model *m)
+{
+	free(m->data);
+	free(m->cmd);
+	m->data = malloc(m->size);
+	m->cmd = malloc(16 + 2 * m->page_size);
+	if (!m->data || !m->cmd) {
+		fprintf(stderr, "flash model: out of memory\n");
+		exit(1);
+	}
+	memset(m->data, 0xff, m->size);
+	m->status = 0;
+	m->now_ns = 0;
+	m->busy_until_ns = 0;
+	flash_model_reset_stats(m);
+	model = m;
+}
+
+void flash_model_reset_stats(struct flash_model *m)
+{
+	m->transactions = 0;
+	m->cycles = 0;
+	m->errors = 0;
+	memset(m->erase_count, 0, sizeof(m->erase_count));
+	m->status_reads = 0;
+	m->programs = 0;
+	m->busy_ns = 0;
+}
+
+/* The timer of the code under test runs on the simulated time. */
+void timer_monotonic_get(struct mono_time *mt)
+{
+	mt->microseconds = model ? model->now_ns / 1000 : 0;
+}
+
+void udelay(unsigned int usecs)
+{
+	if (model)
+		model->now_ns += usecs * 1000ULL;
+}
+
+static void add_cycles(unsigned long long cycles)
+{
+	model->cycles += cycles;
+	if (model->clock_khz)
+		model->now_ns += cycles * 1000000 / model->clock_khz;
+}
+
+static int busy(void)
+{
+	if (model->now_ns >= model->busy_until_ns)
+		model->status &= ~STATUS_WIP;
+	return model->status & STATUS_WIP;
+}
+
+static void start_busy(u32 time_us)
+{
+	model->busy_until_ns = model->now_ns + time_us * 1000ULL;
+	model->busy_ns += time_us * 1000ULL;
+	model->status |= STATUS_WIP;
+}
+
+static const struct flash_model_read *find_read(u8 opcode)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(model->reads); i++)
+		if (model->reads[i].opcode && model->reads[i].opcode == opcode)
+			return &model->reads[i];
+	return NULL;
+}
+
+static const struct flash_model_erase *find_erase(u8 opcode)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(model->erases); i++)
+		if (model->erases[i].opcode && model->erases[i].opcode == opcode)
+			return &model->erases[i];
+	return NULL;
+}
+
+static u32 cmd_addr(int addr_len)
+{
+	u32 addr = 0;
+	int i;
+
+	for (i = 0; i < addr_len; i++)
+		addr = addr << 8 | model->cmd[1 + i];
+	return addr;
+}
+
+static void error(const char *what)
+{
+	if (!bad_transaction)
+		fprintf(stderr, "flash model: %s, opcode %02x, %zu bytes\n",
+			what, model->cmd[0], model->cmd_len);
+	bad_transaction = 1;
+	model->errors++;
+}
+
+/* Byte i of the response in the current transaction */
+static u8 response(size_t i)
+{
+	const struct flash_model_read *r;
+	u32 addr;
+
+	switch (model->cmd[0]) {
+	case CMD_READ_ID:
+		return i < sizeof(model->id) ? model->id[i] : 0;
+	case CMD_READ_STATUS:
+		busy();
+		return model->status;
+	case CMD_READ_SFDP:
+		if (!model->sfdp)
+			return 0xff;
+		if (model->cmd_len != 5) {
+			error("bad SFDP read");
+			return GARBAGE;
+		}
+		addr = cmd_addr(3) + i;
+		return addr < model->sfdp_size ? model->sfdp[addr] : 0xff;
+	}
+
+	r = find_read(model->cmd[0]);
+	if (!r) {
+		error("unknown command");
+		return GARBAGE;
+	}
+	if (r->io_mode != SPI_FLASH_IO_1_1_1) {
+		error("multi I/O read over xfer()");
+		return GARBAGE;
+	}
+	if (model->cmd_len != 1 + r->addr_len + r->dummy_cycles / 8) {
+		error("bad read command length");
+		return GARBAGE;
+	}
+	return model->data[(cmd_addr(r->addr_len) + i) % model->size];
+}
+
+static int model_claim_bus(const struct spi_slave *slave)
+{
+	model->transactions++;
+	model->now_ns += model->xfer_ns;
+	model->cmd_len = 0;
+	model->in_offset = 0;
+	bad_transaction = 0;
+	return 0;
+}
+
+static int model_xfer(const struct spi_slave *slave, const void *dout,
+		      size_t bytesout, void *din, size_t bytesin)
+{
+	u8 *in = din;
+	size_t i;
+
+	if (model->cmd_len + bytesout > 16 + 2 * model->page_size) {
+		error("command too long");
+		return -1;
+	}
+	memcpy(model->cmd + model->cmd_len, dout, bytesout);
+	model->cmd_len += bytesout;
+	add_cycles(8 * (bytesout + bytesin));
+
+	if (model->cmd_len && model->cmd[0] == CMD_READ_STATUS) {
+		if (model->cmd_len == bytesout)
+			model->status_reads++;
+	} else if (busy()) {
+		error("command while busy");
+		memset(in, GARBAGE, bytesin);
+		return 0;
+	}
+
+	for (i = 0; i < bytesin; i++)
+		in[i] = response(model->in_offset++);
+	return 0;
+}
+
+static void page_program(int addr_len)
+{
+	u32 addr = cmd_addr(addr_len);
+	u32 page = ALIGN_DOWN(addr, model->page_size);
+	size_t len = model->cmd_len - 1 - addr_len;
+	size_t i;
+
+	if (model->cmd_len <= 1 + addr_len || len > model->page_size) {
+		error("bad page program");
+		return;
+	}
+	/* Programming wraps around within the page. */
+	for (i = 0; i < len; i++) {
+		u32 offset = (page + (addr - page + i) % model->page_size) %
+			model->size;
+
+		model->data[offset] &= model->cmd[1 + addr_len + i];
+	}
+	model->programs++;
+	start_busy(model->program_us);
+}
+
+static void erase(const struct flash_model_erase *e)
+{
+	u32 addr;
+
+	if (model->cmd_len != 1 + e->addr_len) {
+		error("bad erase");
+		return;
+	}
+	addr = ALIGN_DOWN(cmd_addr(e->addr_len) % model->size, e->size);
+	memset(model->data + addr, 0xff, MIN(e->size, model->size - addr));
+	model->erase_count[e - model->erases]++;
+	start_busy(e->time_us);
+}
+
+static void model_release_bus(const struct spi_slave *slave)
+{
+	const struct flash_model_erase *e;
+	u8 op = model->cmd[0];
+
+	if (!model->cmd_len || bad_transaction)
+		return;
+
+	switch (op) {
+	case CMD_WRITE_ENABLE:
+		model->status |= STATUS_WEL;
+		return;
+	case CMD_WRITE_DISABLE:
+		model->status &= ~STATUS_WEL;
+		return;
+	case CMD_PAGE_PROGRAM:
+	case CMD_PAGE_PROGRAM_4B:
+	case CMD_WRITE_STATUS:
+		break;
+	default:
+		e = find_erase(op);
+		if (!e)
+			return;
+		break;
+	}
+
+	if (!(model->status & STATUS_WEL)) {
+		error("write without write enable");
+		return;
+	}
+	model->status &= ~STATUS_WEL;
+
+	if (op == CMD_PAGE_PROGRAM)
+		page_program(3);
+	else if (op == CMD_PAGE_PROGRAM_4B)
+		page_program(4);
+	else if (op != CMD_WRITE_STATUS)
+		erase(find_erase(op));
+}
+
+static const int addr_lines[] = {
+	[SPI_FLASH_IO_1_1_1] = 1, [SPI_FLASH_IO_1_1_2] = 1,
+	[SPI_FLASH_IO_1_2_2] = 2, [SPI_FLASH_IO_1_1_4] = 1,
+	[SPI_FLASH_IO_1_4_4] = 4,
+};
+
+static const int data_lines[] = {
+	[SPI_FLASH_IO_1_1_1] = 1, [SPI_FLASH_IO_1_1_2] = 2,
+	[SPI_FLASH_IO_1_2_2] = 2, [SPI_FLASH_IO_1_1_4] = 4,
+	[SPI_FLASH_IO_1_4_4] = 4,
+};
+
+static int model_flash_read(const struct spi_slave *slave,
+			    const struct spi_flash_read_cmd *cmd, u32 offset,
+			    size_t len, void *buf)
+{
+	const struct flash_model_read *r = find_read(cmd->opcode);
+	u8 *out = buf;
+	size_t i;
+
+	if (cmd->io_mode >= SPI_FLASH_IO_MODES ||
+	    !(flash_model_ctrlr.flash_read_modes &
+	      SPI_FLASH_IO_MODE(cmd->io_mode)))
+		return -1;
+
+	add_cycles(8 + cmd->addr_len * 8 / addr_lines[cmd->io_mode] +
+		   cmd->dummy_cycles + len * 8 / data_lines[cmd->io_mode]);
+
+	model->cmd[0] = cmd->opcode;
+	model->cmd_len = 1;
+	bad_transaction = 0;
+	if (busy()) {
+		error("command while busy");
+		memset(buf, GARBAGE, len);
+		return 0;
+	}
+	if (!r || r->io_mode != cmd->io_mode || r->addr_len != cmd->addr_len ||
+	    r->dummy_cycles != cmd->dummy_cycles) {
+		error("read command mismatch");
+		memset(buf, GARBAGE, len);
+		return 0;
+	}
+
+	if (cmd->addr_len == 3)
+		offset &= 0xffffff;
+	for (i = 0; i < len; i++)
+		out[i] = model->data[(offset + i) % model->size];
+	return 0;
+}
+
+struct spi_ctrlr flash_model_ctrlr = {
+	.claim_bus = model_claim_bus,
+	.release_bus = model_release_bus,
+	.xfer = model_xfer,
+	.max_xfer_size = SPI_CTRLR_DEFAULT_MAX_XFER_SIZE,
+	.flash_read = model_flash_read,
+};
+
+const struct spi_ctrlr_buses spi_ctrlr_bus_map[] = {
+	{ .ctrlr = &flash_model_ctrlr, .bus_start = 0, .bus_end = 0 },
+};
+
+const size_t spi_ctrlr_bus_map_count = ARRAY_SIZE(spi_ctrlr_bus_map);
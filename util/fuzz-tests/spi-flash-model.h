@@ -0,0 +1,107 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Software model of a SPI flash part behind a SPI controller, for running
+ * src/drivers/spi on the host. The controller is the only one on bus 0.
+ *
+ * The model keeps a simulated time and provides timer_monotonic_get() and
+ * udelay() on it. Each transaction takes the controller overhead plus its
+ * SPI clock cycles, and program and erase commands keep the part busy for
+ * their time. A part with program or erase times needs a clock or an
+ * overhead, otherwise polling the status never sees time pass.
+ */
+
+#ifndef SPI_FLASH_MODEL_H
+#define SPI_FLASH_MODEL_H
+
+#include <spi-generic.h>
+#include <spi_flash.h>
+#include <stdint.h>
+
+#define FLASH_MODEL_MAX_READS	12
+#define FLASH_MODEL_MAX_ERASES	8
+
+/* A read command the part answers. */
+struct flash_model_read {
+	u8 opcode;
+	u8 io_mode;		/* enum spi_flash_io_mode */
+	u8 addr_len;
+	u8 dummy_cycles;
+};
+
+/* An erase command the part answers. */
+struct flash_model_erase {
+	u8 opcode;
+	u8 addr_len;
+	u32 size;
+	u32 time_us;
+};
+
+struct flash_model {
+	/* Configuration */
+	const char *name;
+	u8 id[3];
+	const u8 *sfdp;		/* NULL if the part has no SFDP */
+	size_t sfdp_size;
+	u32 size;
+	u32 page_size;
+	struct flash_model_read reads[FLASH_MODEL_MAX_READS];
+	struct flash_model_erase erases[FLASH_MODEL_MAX_ERASES];
+
+	/* Timing, all 0 for a part that takes no time */
+	u32 clock_khz;		/* SPI clock */
+	u32 xfer_ns;		/* controller overhead per transaction */
+	u32 program_us;		/* page program */
+
+	/* State */
+	u8 *data;
+	u8 status;
+	u8 *cmd;		/* bytes sent in the current transaction */
+	size_t cmd_len;
+	size_t in_offset;	/* bytes read in the current transaction */
+	u64 now_ns;		/* simulated time */
+	u64 busy_until_ns;	/* end of the running program or erase */
+
+	/* Statistics */
+	unsigned long transactions;
+	unsigned long long cycles;	/* SPI clock cycles */
+	unsigned long errors;		/* malformed commands */
+	unsigned long status_reads;
+	unsigned long programs;
+	u64 busy_ns;			/* time spent programming and erasing */
+	unsigned long erase_count[FLASH_MODEL_MAX_ERASES]; /* per erases[] */
+};
+
+/* Add the common commands of all parts: fast read and 4K/64K erase. */
+void flash_model_add_common(struct flash_model *m);
+
+/*
+ * Allocate the array (erased) and make m the part on bus 0. The simulated
+ * time starts at 0.
+ */
+void flash_model_init(struct flash_model *m);
+
+void flash_model_reset_stats(struct flash_model *m);
+
+/*
+ * SFDP of a W25Q128: 16 MiB, 3-byte addresses, all dual and quad reads,
+ * 4K/32K/64K erase
+ */
+#define FLASH_MODEL_SFDP_W25Q128_SIZE	80
+extern const u8 flash_model_sfdp_w25q128[FLASH_MODEL_SFDP_W25Q128_SIZE];
+
+/* The controller of bus 0, flash_read_modes may be changed by tests. */
+extern struct spi_ctrlr flash_model_ctrlr;
+
+#endif /* SPI_FLASH_MODEL_H */
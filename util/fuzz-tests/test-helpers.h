@@ -0,0 +1,88 @@
+/*
+ * This file is part of the coreboot project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * What the host tests share: timing, random rounds and reporting of
+ * failed checks
+ */
+
+#ifndef TEST_HELPERS_H_
+#define TEST_HELPERS_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Seconds on a monotonic clock, for the benchmarks */
+static inline double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Number of random rounds from the first argument, if there is one */
+static inline int test_rounds(int argc, char **argv, int default_rounds)
+{
+	return argc > 1 ? atoi(argv[1]) : default_rounds;
+}
+
+/*
+ * Run fn(arg) in a child process, for code with state that lives until
+ * the end of the stage, and return its exit status or -1.
+ */
+static inline int run_forked(int (*fn)(int), int arg)
+{
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+		exit(fn(arg));
+	if (pid < 0 || waitpid(pid, &status, 0) != pid)
+		return -1;
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Report why the check after op failed, and return -1. */
+static inline int __attribute__((format(printf, 2, 3)))
+check_failed(const char *op, const char *fmt, ...)
+{
+	va_list args;
+
+	fprintf(stderr, "%s: ", op);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+	return -1;
+}
+
+/* Checks that count the failures and go on */
+static int failures __attribute__((unused));
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, \
+			       #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+#endif /* TEST_HELPERS_H_ */
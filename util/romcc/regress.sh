@@ -0,0 +1,291 @@
+#!/bin/sh
+#
+# This file is part of the coreboot project.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# Runs the same tests as test.sh, but in parallel, and compares every
+# test against a baseline file instead of a list of known broken tests.
+# The baseline records whether each test passed, the processor time romcc
+# spent on it and its peak memory use, both from romcc -ftime-report, and
+# the number of compiles. Processor time is used because wall clock time
+# is meaningless with many tests running at once. It still varies by a
+# third between runs of the same compile, and slow runs come in bursts, so
+# all tests run several times over and each test's fastest run counts.
+
+BASEDIR="$(dirname "$0")"
+BUILDDIR="$BASEDIR/build"
+WORKDIR="$BUILDDIR/regress"
+
+# A test is slower when both limits are exceeded, which keeps the
+# tests that only take a few milliseconds from tripping the check.
+# MIN_TIME applies to every compile, as the noise adds up over them.
+# The time of all tests that passed before is held to TOLERANCE alone.
+TOLERANCE=20		# percent
+MIN_TIME=0.02		# seconds per compile
+MIN_MEM=1024		# kB
+RUNS=3
+
+SIMPLE_OPTS='
+	-O
+	-O2
+	-mmmx
+	-msse
+	-mmmx -msse
+	-O -mmmx
+	-O -msse
+	-O -mmmx -msse
+	-O2 -mmmx
+	-O2 -msse
+	-O2 -mmmx -msse
+'
+
+usage () {
+	echo "Usage: regress.sh [-j jobs] [-b baseline] [-t tolerance] [-r runs] [-u] CLASS"
+	echo ""
+	echo "CLASS selects a group of tests to run. It must be one of the following:"
+	echo "  all     - all tests"
+	echo "  simple  - simple tests"
+	echo "  linux   - linux programs whose output is checked against a reference"
+	echo ""
+	echo "-j jobs       number of tests to run at once (default: number of CPUs)"
+	echo "-b baseline   baseline file (default: build/baseline.txt)"
+	echo "-t tolerance  allowed time and memory growth in percent (default: $TOLERANCE)"
+	echo "-r runs       times to run all tests, the fastest counts (default: $RUNS)"
+	echo "-u            write the results to the baseline file"
+	exit 1
+}
+
+# Compile $2 with the options in $1, adding the processor time and
+# peak memory from the time report to TIME and MEM, and count the compile
+# in COMPILES.
+compile () {
+	local ret stats
+
+	# TODO: "timeout" is not POSIX compliant. Use something that is.
+	timeout 60 "$ROMCC" -ftime-report $1 "$2" -o "$3" 2> "$3.err"
+	ret=$?
+	cat "$3.err"
+	stats=$(awk '/^ TOTAL /{ t = $3 } /^ peak memory /{ m = $4 }
+		END { print t + 0, m + 0 }' "$3.err")
+	TIME=$(echo "$TIME $stats" | awk '{ printf "%.3f", $1 + $2 }')
+	MEM=$(echo "$MEM $stats" | awk '{ print ($3 > $1) ? $3 : $1 }')
+	COMPILES=$((COMPILES + 1))
+	return $ret
+}
+
+run_simple_test () {
+	local opts
+
+	compile "" "$1" "$WORKDIR/$2.S" || return 1
+	while read -r opts; do
+		[ -n "$opts" ] || continue
+		compile "$opts" "$1" "$WORKDIR/$2.S" || return 1
+	done <<-EOF
+	$SIMPLE_OPTS
+	EOF
+}
+
+run_linux_test () {
+	compile "" "$1" "$WORKDIR/$2.S" || return 1
+	as --32 "$WORKDIR/$2.S" -o "$WORKDIR/$2.o" || return 1
+	ld -m elf_i386 -T "$BASEDIR/tests/ldscript.ld" \
+		"$WORKDIR/$2.o" -o "$WORKDIR/$2.elf" || return 1
+	timeout 60 "$WORKDIR/$2.elf" > "$WORKDIR/$2.out" || return 1
+
+	diff -u "$BASEDIR/results/${2%.c}.out" "$WORKDIR/$2.out"
+}
+
+# Run a single test in run $1 and write "name status seconds kB compiles"
+# to its result file
+run_one () {
+	local name="$(basename "$2")"
+	local status=fail
+
+	TIME=0
+	MEM=0
+	COMPILES=0
+	if "run_${name%%_*}_test" "$2" "$name" > "$WORKDIR/$name.log" 2>&1; then
+		status=pass
+	fi
+	echo "$name $status $TIME $MEM $COMPILES" > "$WORKDIR/$name.result$1"
+}
+
+# Merge the results of all runs: a test passes if it passed every time,
+# and its fastest run and smallest peak memory count.
+merge () {
+	awk '
+	!($1 in status) {
+		status[$1] = $2
+		time[$1] = $3
+		mem[$1] = $4
+		compiles[$1] = $5
+		next
+	}
+	{
+		if ($2 != "pass")
+			status[$1] = $2
+		if ($3 < time[$1])
+			time[$1] = $3
+		if ($4 < mem[$1])
+			mem[$1] = $4
+	}
+	END {
+		for (name in status)
+			print name, status[name], time[name], mem[name],
+				compiles[name]
+	}' "$@"
+}
+
+# Print one line per test and the totals, and fail on regressions
+compare () {
+	awk -v tolerance="$TOLERANCE" -v min_time="$MIN_TIME" \
+	    -v min_mem="$MIN_MEM" '
+	FILENAME == ARGV[1] {
+		if ($0 !~ /^#/) {
+			base_status[$1] = $2
+			base_time[$1] = $3
+			base_mem[$1] = $4
+		}
+		next
+	}
+	function grew(old, new, slack) {
+		return new > old * (1 + tolerance / 100) && new - old > slack
+	}
+	{
+		compiles = $5 > 0 ? $5 : 1
+		note = ""
+		total++
+		if ($2 == "pass") {
+			passed++
+			result = "passed"
+			if (!($1 in base_status)) {
+				note = " (new)"
+			} else if (base_status[$1] != "pass") {
+				note = " (fixed)"
+				fixed++
+			} else {
+				old_time += base_time[$1]
+				new_time += $3
+				if (grew(base_time[$1], $3,
+					 min_time * compiles)) {
+					note = note sprintf(" (slower: %.3fs -> %.3fs)",
+						base_time[$1], $3)
+					slower++
+				}
+				if (grew(base_mem[$1], $4, min_mem)) {
+					note = note sprintf(" (bigger: %d kB -> %d kB)",
+						base_mem[$1], $4)
+					bigger++
+				}
+			}
+		} else {
+			failed++
+			result = "failed"
+			if (!($1 in base_status)) {
+				note = " (new)"
+			} else if (base_status[$1] != "pass") {
+				note = " (known broken)"
+				broken++
+			} else {
+				note = " (was passing)"
+			}
+		}
+		printf "%-20s %s %8.3fs %8d kB%s\n", $1, result, $3, $4, note
+	}
+	END {
+		printf "\npassed: %d\t(%d newly fixed)\n", passed, fixed
+		printf "failed: %d\t(%d known broken)\n", failed, broken
+		printf "slower: %d\tbigger: %d\t(tolerance %d%%)\n",
+			slower, bigger, tolerance
+		# Over all tests the noise averages out, so no slack here
+		total_slower = grew(old_time, new_time, 0)
+		printf "time:   %.3fs -> %.3fs%s\n", old_time, new_time,
+			total_slower ? " (slower)" : ""
+		printf "total:  %d\n", total
+		exit (failed != broken || slower || bigger || total_slower)
+	}' "$1" "$2"
+}
+
+if [ "$1" = "--run" ]; then
+	run_one "$2" "$3"
+	exit 0
+fi
+
+JOBS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+BASELINE="$BUILDDIR/baseline.txt"
+UPDATE=0
+while getopts "j:b:t:r:u" opt; do
+	case "$opt" in
+	j)	JOBS="$OPTARG" ;;
+	b)	BASELINE="$OPTARG" ;;
+	t)	TOLERANCE="$OPTARG" ;;
+	r)	RUNS="$OPTARG" ;;
+	u)	UPDATE=1 ;;
+	*)	usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -ne 1 ]; then
+	usage
+fi
+
+case "$1" in
+	all)	CLASSES="simple linux" ;;
+	simple)	CLASSES="simple" ;;
+	linux)	CLASSES="linux" ;;
+	*)
+		echo "Invalid test class $1"
+		echo
+		usage
+		;;
+esac
+
+ROMCC="$BUILDDIR/romcc"
+if [ ! -f "$ROMCC" ]; then
+	echo "romcc not found! Please run \"make\"."
+	exit 1
+fi
+export ROMCC BASEDIR WORKDIR
+
+rm -rf "$WORKDIR"
+mkdir -p "$WORKDIR"
+
+for class in $CLASSES; do
+	find "$BASEDIR/tests" -name "${class}_test*.c"
+done | LC_ALL=C sort > "$WORKDIR/tests.txt"
+
+run=1
+while [ $run -le "$RUNS" ]; do
+	echo "Running $1 tests with $JOBS jobs ($run of $RUNS)..."
+	xargs -n 1 -P "$JOBS" sh "$0" --run $run < "$WORKDIR/tests.txt"
+	run=$((run + 1))
+done
+merge "$WORKDIR"/*.result* | LC_ALL=C sort > "$WORKDIR/results.txt"
+
+if [ ! -f "$BASELINE" ]; then
+	echo "No baseline found at $BASELINE, every test is new."
+	echo "# no baseline" > "$WORKDIR/empty.txt"
+	compare "$WORKDIR/empty.txt" "$WORKDIR/results.txt"
+else
+	compare "$BASELINE" "$WORKDIR/results.txt"
+fi
+RET=$?
+
+if [ $UPDATE -eq 1 ]; then
+	{
+		echo "# romcc regression baseline: test status seconds peak-kB compiles"
+		cat "$WORKDIR/results.txt"
+	} > "$BASELINE"
+	echo "Wrote baseline to $BASELINE"
+	exit 0
+fi
+exit $RET
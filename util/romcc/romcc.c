@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -182,6 +183,80 @@ static void xfree(const void *ptr)
 	free((void *)ptr);
 }
 
+/* Objects that are allocated and freed by the million, triples and
+ * interference graph edges, are carved out of large chunks instead of
+ * going through malloc one at a time.  Freed objects are kept on free
+ * lists by their users, and the chunks are only released as a whole.
+ */
+#define ARENA_ALIGN      8
+#define ARENA_CHUNK_SIZE (256*1024)
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+};
+#define ARENA_HEADER_SIZE \
+	((sizeof(struct arena_chunk) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+struct arena {
+	struct arena_chunk *chunks, *current;
+	char *ptr, *end;
+};
+
+static void arena_grow(struct arena *arena, size_t size, const char *name)
+{
+	struct arena_chunk *chunk;
+	/* Reuse the chunks left over from before an arena_reset */
+	chunk = arena->current ? arena->current->next : arena->chunks;
+	if (!chunk || (chunk->size < size)) {
+		size_t chunk_size;
+		chunk_size = ARENA_CHUNK_SIZE - ARENA_HEADER_SIZE;
+		if (chunk_size < size) {
+			chunk_size = size;
+		}
+		chunk = xmalloc(ARENA_HEADER_SIZE + chunk_size, name);
+		chunk->size = chunk_size;
+		if (arena->current) {
+			chunk->next = arena->current->next;
+			arena->current->next = chunk;
+		} else {
+			chunk->next = arena->chunks;
+			arena->chunks = chunk;
+		}
+	}
+	arena->current = chunk;
+	arena->ptr = ((char *)chunk) + ARENA_HEADER_SIZE;
+	arena->end = arena->ptr + chunk->size;
+}
+
+static void *arena_alloc(struct arena *arena, size_t size, const char *name)
+{
+	void *buf;
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (size > (size_t)(arena->end - arena->ptr)) {
+		arena_grow(arena, size, name);
+	}
+	buf = arena->ptr;
+	arena->ptr += size;
+	return buf;
+}
+
+/* Forget everything allocated, but keep the chunks for reuse */
+static void arena_reset(struct arena *arena)
+{
+	arena->current = 0;
+	arena->ptr = 0;
+	arena->end = 0;
+}
+
+static void arena_free(struct arena *arena)
+{
+	struct arena_chunk *chunk, *next;
+	for(chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		xfree(chunk);
+	}
+	memset(arena, 0, sizeof(*arena));
+}
+
 static char *xstrdup(const char *str)
 {
 	char *new;
@@ -1073,6 +1148,23 @@ struct basic_blocks {
 	struct block *first_block, *last_block;
 	int last_vertex;
 };
+/* Compiler phases timed by -ftime-report */
+#define PHASE_OTHER         0
+#define PHASE_PARSE         1
+#define PHASE_JOIN          2
+#define PHASE_SSA           3
+#define PHASE_DEAD_CODE     4
+#define PHASE_SIMPLIFY      5
+#define PHASE_SCC           6
+#define PHASE_INSTRUCTIONS  7
+#define PHASE_LIVENESS      8
+#define PHASE_INTERFERENCE  9
+#define PHASE_COALESCE     10
+#define PHASE_COLOR        11
+#define PHASE_CODEGEN      12
+#define PHASE_VERIFY       13
+#define PHASE_COUNT        14
+
 #define MAX_PP_IF_DEPTH 63
 struct compile_state {
 	struct compiler_state *compiler;
@@ -1116,6 +1208,13 @@ struct compile_state {
 	struct triple *global_pool;
 	struct basic_blocks bb;
 	int functions_joined;
+	/* Triples are recycled by parameter count, see alloc_triple */
+	struct arena triple_arena;
+	struct triple *free_triples[MAX_LHS + MAX_RHS + MAX_MISC + MAX_TARG + 1];
+	/* Processor time spent in each phase, see time_phase */
+	int phase;
+	clock_t phase_start;
+	clock_t phase_time[PHASE_COUNT];
 };
 
 /* visibility global/local */
@@ -1406,6 +1505,7 @@ static void print_dominance_frontiers(struct compile_state *state,
 #define COMPILER_SIMPLIFY_LOGICAL          0x00004000
 #define COMPILER_SIMPLIFY_BITFIELD         0x00008000
 
+#define COMPILER_TIME_REPORT               0x20000000
 #define COMPILER_TRIGRAPHS                 0x40000000
 #define COMPILER_PP_ONLY                   0x80000000
 
@@ -1606,6 +1706,7 @@ static const struct compiler_flag romcc_flags[] = {
 	{ "simplify-bitwise",          COMPILER_SIMPLIFY_BITWISE },
 	{ "simplify-logical",          COMPILER_SIMPLIFY_LOGICAL },
 	{ "simplify-bitfield",         COMPILER_SIMPLIFY_BITFIELD },
+	{ "time-report",               COMPILER_TIME_REPORT },
 	{ 0, 0 },
 };
 static const struct compiler_arg romcc_args[] = {
@@ -1722,6 +1823,73 @@ static void compiler_usage(FILE *fp)
 	fprintf(fp, "-U<macro>\n");
 }
 
+/* Charge the processor time used so far to the current phase and
+ * switch to a new one.  Returns the previous phase so nested phases
+ * can restore it when they are done.
+ */
+static int time_phase(struct compile_state *state, int phase)
+{
+	clock_t now;
+	int old_phase;
+	old_phase = state->phase;
+	if (state->compiler->flags & COMPILER_TIME_REPORT) {
+		now = clock();
+		state->phase_time[old_phase] += now - state->phase_start;
+		state->phase_start = now;
+	}
+	state->phase = phase;
+	return old_phase;
+}
+
+static void print_time_report(struct compile_state *state)
+{
+	static const char *const phase_names[PHASE_COUNT] = {
+		[PHASE_OTHER]        = "other",
+		[PHASE_PARSE]        = "preprocessing and parsing",
+		[PHASE_JOIN]         = "function joining",
+		[PHASE_SSA]          = "basic blocks and ssa form",
+		[PHASE_DEAD_CODE]    = "dead code elimination",
+		[PHASE_SIMPLIFY]     = "simplification",
+		[PHASE_SCC]          = "constant propagation",
+		[PHASE_INSTRUCTIONS] = "instruction selection",
+		[PHASE_LIVENESS]     = "live ranges",
+		[PHASE_INTERFERENCE] = "interference graph",
+		[PHASE_COALESCE]     = "coalescing",
+		[PHASE_COLOR]        = "graph coloring",
+		[PHASE_CODEGEN]      = "code generation",
+		[PHASE_VERIFY]       = "consistency checks",
+	};
+	FILE *fp = state->errout;
+	struct rusage usage;
+	clock_t total;
+	long peak;
+	int i;
+	time_phase(state, state->phase);
+	total = 0;
+	for(i = 0; i < PHASE_COUNT; i++) {
+		total += state->phase_time[i];
+	}
+	fprintf(fp, "\nExecution times (seconds)\n");
+	for(i = 0; i < PHASE_COUNT; i++) {
+		fprintf(fp, " %-26s: %8.3f (%3.0f%%)\n",
+			phase_names[i],
+			(double)state->phase_time[i]/CLOCKS_PER_SEC,
+			total ? (100.0*state->phase_time[i])/total : 0.0);
+	}
+	fprintf(fp, " %-26s: %8.3f\n", "TOTAL",
+		(double)total/CLOCKS_PER_SEC);
+
+	peak = 0;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		peak = usage.ru_maxrss;
+#ifdef __APPLE__
+		/* Darwin reports bytes instead of kilobytes */
+		peak /= 1024;
+#endif
+	}
+	fprintf(fp, " %-26s: %8ld kB\n", "peak memory", peak);
+}
+
 static void do_cleanup(struct compile_state *state)
 {
 	if (state->output) {
@@ -2137,7 +2305,13 @@ static struct triple *alloc_triple(struct compile_state *state,
 	extra_count = (extra_count < min_count)? 0 : extra_count - min_count;
 
 	size = sizeof(*ret) + sizeof(ret->param[0]) * extra_count;
-	ret = xcmalloc(size, "tripple");
+	ret = state->free_triples[extra_count];
+	if (ret) {
+		state->free_triples[extra_count] = ret->next;
+	} else {
+		ret = arena_alloc(&state->triple_arena, size, "tripple");
+	}
+	memset(ret, 0, size);
 	ret->op        = op;
 	ret->lhs       = lhs;
 	ret->rhs       = rhs;
@@ -2970,19 +3144,33 @@ static int find_rhs_use(struct compile_state *state,
 	return -1;
 }
 
-static void free_triple(struct compile_state *state, struct triple *ptr)
+/* Return the memory of a triple to the free lists alloc_triple uses */
+static void xfree_triple(struct compile_state *state, struct triple *ptr)
 {
-	size_t size;
+	size_t size, min_count, extra_count;
 	size = sizeof(*ptr) - sizeof(ptr->param) +
 		(sizeof(ptr->param[0])*TRIPLE_SIZE(ptr));
+	/* The parameter counts never grow after alloc_triple,
+	 * so this is never a bigger free list than the one the
+	 * triple was allocated from.
+	 */
+	min_count = sizeof(ptr->param)/sizeof(ptr->param[0]);
+	extra_count = TRIPLE_SIZE(ptr);
+	extra_count = (extra_count < min_count)? 0 : extra_count - min_count;
+	memset(ptr, -1, size);
+	ptr->next = state->free_triples[extra_count];
+	state->free_triples[extra_count] = ptr;
+}
+
+static void free_triple(struct compile_state *state, struct triple *ptr)
+{
 	ptr->prev->next = ptr->next;
 	ptr->next->prev = ptr->prev;
 	if (ptr->use) {
 		internal_error(state, ptr, "ptr->use != 0");
 	}
 	put_occurance(ptr->occurance);
-	memset(ptr, -1, size);
-	xfree(ptr);
+	xfree_triple(state, ptr);
 }
 
 static void release_triple(struct compile_state *state, struct triple *ptr)
@@ -18201,9 +18389,17 @@ struct lre_hash {
 	struct live_range *right;
 };
 
+/* Up to this many live ranges the interference graph is kept in a bit
+ * matrix (4MB at most) instead of the hash table.
+ */
+#define LRE_MATRIX_MAX_RANGES 8192
 
 struct reg_state {
 	struct lre_hash *hash[LRE_HASH_SIZE];
+	unsigned char *matrix;
+	struct arena edge_arena;
+	struct live_range_edge *free_edges;
+	struct lre_hash *free_hash;
 	struct reg_block *blocks;
 	struct live_range_def *lrd;
 	struct live_range *lr;
@@ -18458,18 +18654,63 @@ static struct lre_hash **lre_probe(struct reg_state *rstate,
 	return ptr;
 }
 
+/* The matrix holds the lower triangle, diagonal included,
+ * of the adjacency matrix of the interference graph.
+ */
+static unsigned char *lre_matrix_byte(struct reg_state *rstate,
+	struct live_range *left, struct live_range *right, unsigned char *mask)
+{
+	size_t i, j, bit;
+	i = left - rstate->lr;
+	j = right - rstate->lr;
+	/* Ensure i <= j */
+	if (i > j) {
+		size_t tmp;
+		tmp = i;
+		i = j;
+		j = tmp;
+	}
+	bit = ((j*(j + 1))/2) + i;
+	*mask = 1 << (bit % CHAR_BIT);
+	return &rstate->matrix[bit / CHAR_BIT];
+}
+
 static int interfere(struct reg_state *rstate,
 	struct live_range *left, struct live_range *right)
 {
 	struct lre_hash **ptr;
+	if (rstate->matrix) {
+		unsigned char *byte, mask;
+		byte = lre_matrix_byte(rstate, left, right, &mask);
+		return !!(*byte & mask);
+	}
 	ptr = lre_probe(rstate, left, right);
 	return ptr && *ptr;
 }
 
+static struct live_range_edge *alloc_live_edge(struct reg_state *rstate)
+{
+	struct live_range_edge *edge;
+	edge = rstate->free_edges;
+	if (edge) {
+		rstate->free_edges = edge->next;
+	} else {
+		edge = arena_alloc(&rstate->edge_arena, sizeof(*edge),
+			"live_range_edge");
+	}
+	return edge;
+}
+
+static void free_live_edge(struct reg_state *rstate, struct live_range_edge *edge)
+{
+	edge->next = rstate->free_edges;
+	edge->node = 0;
+	rstate->free_edges = edge;
+}
+
 static void add_live_edge(struct reg_state *rstate,
 	struct live_range *left, struct live_range *right)
 {
-	/* FIXME the memory allocation overhead is noticeable here... */
 	struct lre_hash **ptr, *new_hash;
 	struct live_range_edge *edge;
 
@@ -18486,27 +18727,43 @@ static void add_live_edge(struct reg_state *rstate,
 		left = right;
 		right = tmp;
 	}
-	ptr = lre_probe(rstate, left, right);
-	if (*ptr) {
-		return;
+	if (rstate->matrix) {
+		unsigned char *byte, mask;
+		byte = lre_matrix_byte(rstate, left, right, &mask);
+		if (*byte & mask) {
+			return;
+		}
+		*byte |= mask;
+	}
+	else {
+		ptr = lre_probe(rstate, left, right);
+		if (*ptr) {
+			return;
+		}
+		new_hash = rstate->free_hash;
+		if (new_hash) {
+			rstate->free_hash = new_hash->next;
+		} else {
+			new_hash = arena_alloc(&rstate->edge_arena,
+				sizeof(*new_hash), "lre_hash");
+		}
+		new_hash->next  = *ptr;
+		new_hash->left  = left;
+		new_hash->right = right;
+		*ptr = new_hash;
 	}
 #if 0
 	fprintf(state->errout, "new_live_edge(%p, %p)\n",
 		left, right);
 #endif
-	new_hash = xmalloc(sizeof(*new_hash), "lre_hash");
-	new_hash->next  = *ptr;
-	new_hash->left  = left;
-	new_hash->right = right;
-	*ptr = new_hash;
 
-	edge = xmalloc(sizeof(*edge), "live_range_edge");
+	edge = alloc_live_edge(rstate);
 	edge->next   = left->edges;
 	edge->node   = right;
 	left->edges  = edge;
 	left->degree += 1;
 
-	edge = xmalloc(sizeof(*edge), "live_range_edge");
+	edge = alloc_live_edge(rstate);
 	edge->next    = right->edges;
 	edge->node    = left;
 	right->edges  = edge;
@@ -18518,20 +18775,33 @@ static void remove_live_edge(struct reg_state *rstate,
 {
 	struct live_range_edge *edge, **ptr;
 	struct lre_hash **hptr, *entry;
-	hptr = lre_probe(rstate, left, right);
-	if (!hptr || !*hptr) {
+	if (left == right) {
 		return;
 	}
-	entry = *hptr;
-	*hptr = entry->next;
-	xfree(entry);
+	if (rstate->matrix) {
+		unsigned char *byte, mask;
+		byte = lre_matrix_byte(rstate, left, right, &mask);
+		if (!(*byte & mask)) {
+			return;
+		}
+		*byte &= ~mask;
+	}
+	else {
+		hptr = lre_probe(rstate, left, right);
+		if (!hptr || !*hptr) {
+			return;
+		}
+		entry = *hptr;
+		*hptr = entry->next;
+		entry->next = rstate->free_hash;
+		rstate->free_hash = entry;
+	}
 
 	for(ptr = &left->edges; *ptr; ptr = &(*ptr)->next) {
 		edge = *ptr;
 		if (edge->node == right) {
 			*ptr = edge->next;
-			memset(edge, 0, sizeof(*edge));
-			xfree(edge);
+			free_live_edge(rstate, edge);
 			right->degree--;
 			break;
 		}
@@ -18540,23 +18810,13 @@ static void remove_live_edge(struct reg_state *rstate,
 		edge = *ptr;
 		if (edge->node == left) {
 			*ptr = edge->next;
-			memset(edge, 0, sizeof(*edge));
-			xfree(edge);
+			free_live_edge(rstate, edge);
 			left->degree--;
 			break;
 		}
 	}
 }
 
-static void remove_live_edges(struct reg_state *rstate, struct live_range *range)
-{
-	struct live_range_edge *edge, *next;
-	for(edge = range->edges; edge; edge = next) {
-		next = edge->next;
-		remove_live_edge(rstate, range, edge->node);
-	}
-}
-
 static void transfer_live_edges(struct reg_state *rstate,
 	struct live_range *dest, struct live_range *src)
 {
@@ -18583,6 +18843,7 @@ static void transfer_live_edges(struct reg_state *rstate,
  * Implement with a hash table && a set of adjcency vectors.
  * The hash table supports constant time implementations of add and interfere.
  * The adjacency vectors support an efficient implementation of neighbors.
+ * When there are few enough live ranges a bit matrix replaces the hash table.
  */
 
 /*
@@ -18847,6 +19108,13 @@ static void initialize_live_ranges(
 	} while(ins != first);
 	rstate->ranges = i;
 
+	if (rstate->ranges <= LRE_MATRIX_MAX_RANGES) {
+		size_t nodes;
+		nodes = rstate->ranges + 1;
+		size = ((nodes*(nodes + 1))/2 + CHAR_BIT - 1)/CHAR_BIT;
+		rstate->matrix = xcmalloc(size, "interference matrix");
+	}
+
 	/* Make a second pass to handle achitecture specific register
 	 * constraints.
 	 */
@@ -20035,15 +20303,34 @@ static void ids_from_rstate(struct compile_state *state,
 static void cleanup_live_edges(struct reg_state *rstate)
 {
 	int i;
-	/* Free the edges on each node */
+	/* Forget the edges on each node, all of their memory
+	 * is released at once below.
+	 */
 	for(i = 1; i <= rstate->ranges; i++) {
-		remove_live_edges(rstate, &rstate->lr[i]);
+		struct live_range *range;
+		range = &rstate->lr[i];
+		if (rstate->matrix) {
+			struct live_range_edge *edge;
+			for(edge = range->edges; edge; edge = edge->next) {
+				unsigned char *byte, mask;
+				byte = lre_matrix_byte(rstate, range, edge->node, &mask);
+				*byte &= ~mask;
+			}
+		}
+		range->edges = 0;
+		range->degree = 0;
 	}
+	memset(rstate->hash, 0, sizeof(rstate->hash));
+	rstate->free_edges = 0;
+	rstate->free_hash = 0;
+	arena_reset(&rstate->edge_arena);
 }
 
 static void cleanup_rstate(struct compile_state *state, struct reg_state *rstate)
 {
 	cleanup_live_edges(rstate);
+	arena_free(&rstate->edge_arena);
+	xfree(rstate->matrix);
 	xfree(rstate->lrd);
 	xfree(rstate->lr);
 
@@ -20053,6 +20340,7 @@ static void cleanup_rstate(struct compile_state *state, struct reg_state *rstate
 	}
 	rstate->defs = 0;
 	rstate->ranges = 0;
+	rstate->matrix = 0;
 	rstate->lrd = 0;
 	rstate->lr = 0;
 	rstate->blocks = 0;
@@ -20080,6 +20368,7 @@ static void allocate_registers(struct compile_state *state)
 		}
 
 		/* Restore ids */
+		time_phase(state, PHASE_LIVENESS);
 		ids_from_rstate(state, &rstate);
 
 		/* Cleanup the temporary data structures */
@@ -20119,6 +20408,7 @@ static void allocate_registers(struct compile_state *state)
 			}
 
 			/* Remove any previous live edge calculations */
+			time_phase(state, PHASE_INTERFERENCE);
 			cleanup_live_edges(&rstate);
 
 			/* Compute the interference graph */
@@ -20135,6 +20425,7 @@ static void allocate_registers(struct compile_state *state)
 					print_interference_ins, &rstate);
 			}
 
+			time_phase(state, PHASE_COALESCE);
 			coalesced = coalesce_live_ranges(state, &rstate);
 
 			if (state->compiler->debug & DEBUG_COALESCING) {
@@ -20158,6 +20449,7 @@ static void allocate_registers(struct compile_state *state)
 		/* Build the groups low and high.  But with the nodes
 		 * first sorted by degree order.
 		 */
+		time_phase(state, PHASE_COLOR);
 		rstate.low_tail  = &rstate.low;
 		rstate.high_tail = &rstate.high;
 		rstate.high = merge_sort_lr(&rstate.lr[1], &rstate.lr[rstate.ranges]);
@@ -20612,7 +20904,7 @@ static struct triple *preserve_lval(
 	if (lnode->val) {
 		old = dup_triple(state, lnode->val);
 		if (lnode->val != lnode->def) {
-			xfree(lnode->val);
+			xfree_triple(state, lnode->val);
 		}
 		lnode->val = 0;
 	} else {
@@ -20638,7 +20930,7 @@ static int lval_changed(struct compile_state *state,
 		changed = 0;
 	}
 	if (old) {
-		xfree(old);
+		xfree_triple(state, old);
 	}
 	return changed;
 
@@ -20789,7 +21081,7 @@ static int compute_lnode_val(struct compile_state *state, struct scc_state *scc,
 
 	/* See if we need to free the scratch value */
 	if (lnode->val != scratch) {
-		xfree(scratch);
+		xfree_triple(state, scratch);
 	}
 
 	return changed;
@@ -21022,7 +21314,7 @@ static void scc_writeback_values(
 				internal_error(state, 0, "constants not equal");
 			}
 			/* Free the lattice nodes */
-			xfree(lnode->val);
+			xfree_triple(state, lnode->val);
 			lnode->val = 0;
 		}
 		ins = ins->next;
@@ -21550,6 +21842,8 @@ static void verify_copy(struct compile_state *state)
 
 static void verify_consistency(struct compile_state *state)
 {
+	int old_phase;
+	old_phase = time_phase(state, PHASE_VERIFY);
 	verify_unknown(state);
 	verify_uses(state);
 	verify_blocks_present(state);
@@ -21563,6 +21857,7 @@ static void verify_consistency(struct compile_state *state)
 	if (state->compiler->debug & DEBUG_VERIFICATION) {
 		fprintf(state->dbgout, "consistency verified\n");
 	}
+	time_phase(state, old_phase);
 }
 #else
 static void verify_consistency(struct compile_state *state) {}
@@ -21571,6 +21866,7 @@ static void verify_consistency(struct compile_state *state) {}
 static void optimize(struct compile_state *state)
 {
 	/* Join all of the functions into one giant function */
+	time_phase(state, PHASE_JOIN);
 	join_functions(state);
 
 	/* Dump what the instruction graph intially looks like */
@@ -21582,6 +21878,7 @@ static void optimize(struct compile_state *state)
 
 	verify_consistency(state);
 	/* Analyze the intermediate code */
+	time_phase(state, PHASE_SSA);
 	state->bb.first = state->first;
 	analyze_basic_blocks(state, &state->bb);
 
@@ -21598,13 +21895,16 @@ static void optimize(struct compile_state *state)
 	verify_consistency(state);
 
 	/* Remove dead code */
+	time_phase(state, PHASE_DEAD_CODE);
 	eliminate_inefectual_code(state);
 	verify_consistency(state);
 
 	/* Do strength reduction and simple constant optimizations */
+	time_phase(state, PHASE_SIMPLIFY);
 	simplify_all(state);
 	verify_consistency(state);
 	/* Propogate constants throughout the code */
+	time_phase(state, PHASE_SCC);
 	scc_transform(state);
 	verify_consistency(state);
 #if DEBUG_ROMCC_WARNINGS
@@ -21614,14 +21914,17 @@ static void optimize(struct compile_state *state)
 	/* Select architecture instructions and an initial partial
 	 * coloring based on architecture constraints.
 	 */
+	time_phase(state, PHASE_INSTRUCTIONS);
 	transform_to_arch_instructions(state);
 	verify_consistency(state);
 
 	/* Remove dead code */
+	time_phase(state, PHASE_DEAD_CODE);
 	eliminate_inefectual_code(state);
 	verify_consistency(state);
 
 	/* Color all of the variables to see if they will fit in registers */
+	time_phase(state, PHASE_INSTRUCTIONS);
 	insert_copies_to_phi(state);
 	verify_consistency(state);
 
@@ -21634,6 +21937,7 @@ static void optimize(struct compile_state *state)
 	/* Remove the optimization information.
 	 * This is more to check for memory consistency than to free memory.
 	 */
+	time_phase(state, PHASE_OTHER);
 	free_basic_blocks(state, &state->bb);
 }
 
@@ -24956,6 +25260,10 @@ static void compile(const char *filename,
 	exit_state = &state;
 	atexit(exit_cleanup);
 
+	/* Start the clock for -ftime-report */
+	state.phase = PHASE_OTHER;
+	state.phase_start = clock();
+
 	/* Prep the preprocessor */
 	state.if_depth = 0;
 	memset(state.if_bytes, 0, sizeof(state.if_bytes));
@@ -25006,6 +25314,7 @@ static void compile(const char *filename,
 	start_scope(&state);
 	register_builtins(&state);
 
+	time_phase(&state, PHASE_PARSE);
 	compile_file(&state, filename, 1);
 
 	while (includes) {
@@ -25016,6 +25325,9 @@ static void compile(const char *filename,
 	/* Stop if all we want is preprocessor output */
 	if (state.compiler->flags & COMPILER_PP_ONLY) {
 		print_preprocessed_tokens(&state);
+		if (state.compiler->flags & COMPILER_TIME_REPORT) {
+			print_time_report(&state);
+		}
 		return;
 	}
 
@@ -25029,7 +25341,11 @@ static void compile(const char *filename,
 	 */
 	optimize(&state);
 
+	time_phase(&state, PHASE_CODEGEN);
 	generate_code(&state);
+	if (state.compiler->flags & COMPILER_TIME_REPORT) {
+		print_time_report(&state);
+	}
 	if (state.compiler->debug) {
 		fprintf(state.errout, "done\n");
 	}
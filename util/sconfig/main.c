@@ -582,6 +582,62 @@ static void walk_device_tree(FILE * fil, struct device *ptr,
 	} while (ptr);
 }
 
+struct index_entry {
+	unsigned int key;
+	int pos;
+	struct device *dev;
+};
+
+static int index_entry_cmp(const void *a, const void *b)
+{
+	const struct index_entry *ea = a, *eb = b;
+
+	if (ea->key != eb->key)
+		return ea->key < eb->key ? -1 : 1;
+	return ea->pos - eb->pos;
+}
+
+/*
+ * Emit a lookup table of all devices on the given bus type, sorted by
+ * key. Devices sharing a key stay in list order, so a binary search for
+ * the first match finds the same device as walking the list would.
+ */
+static void emit_index(FILE *fil, const char *name, int bustype)
+{
+	struct index_entry *entries;
+	struct device *dev;
+	int i, count = 0, pos = 0;
+
+	for (dev = &root; dev; dev = dev->nextdev)
+		if (dev->type == device && !dev->used &&
+		    dev->bustype == bustype)
+			count++;
+
+	entries = calloc(count ? count : 1, sizeof(*entries));
+	count = 0;
+	for (dev = &root; dev; dev = dev->nextdev, pos++) {
+		if (dev->type != device || dev->used || dev->bustype != bustype)
+			continue;
+		if (bustype == PCI)
+			entries[count].key = (dev->path_a << 3) | dev->path_b;
+		else
+			entries[count].key = (dev->path_a << 16) | dev->path_b;
+		entries[count].pos = pos;
+		entries[count].dev = dev;
+		count++;
+	}
+	qsort(entries, count, sizeof(*entries), index_entry_cmp);
+
+	fprintf(fil, "const struct device_index_entry %s[] = {\n",
+		name);
+	for (i = 0; i < count; i++)
+		fprintf(fil, "\t{ .key = 0x%x, .dev = &%s },\n",
+			entries[i].key, entries[i].dev->name);
+	fprintf(fil, "};\n");
+	fprintf(fil, "const size_t %s_count = %d;\n", name, count);
+	free(entries);
+}
+
 static void inherit_subsystem_ids(FILE * file, struct device *dev)
 {
 	struct device *p;
@@ -687,6 +743,11 @@ int main(int argc, char **argv)
 		lastdev->name);
 	walk_device_tree(autogen, &root, pass1, NULL);
 
+	fprintf(autogen, "\n/* lookup tables */\n#if DEVTREE_EARLY\n");
+	emit_index(autogen, "dev_index_pci", PCI);
+	emit_index(autogen, "dev_index_pnp", PNP);
+	fprintf(autogen, "#endif\n");
+
 	fclose(autogen);
 
 	return 0;